@@ -0,0 +1,126 @@
+#define OLC_PGE_APPLICATION
+#include "olcPixelGameEngine.h"
+#include "mapped_graph.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <random>
+
+// Measures mapped_graph on a lattice of side times side nodes (40 world units apart, every node joined to the one on its
+// right and the one below it): building the file, opening it, reading the nodes in a view, going through the lines of the
+// nodes in file order and finding shortest paths across it.
+//
+//   mapped_graph_bench <path> [side = 2000]
+//
+// The file is built unless it is there already, so running it again after dropping the page cache (on Linux, echo 3 >
+// /proc/sys/vm/drop_caches) measures reading a file from disk. Building holds the whole graph in memory first, which
+// takes about 100 bytes per node. The "benchmark" task builds it along with src/mapped_graph.cpp and src/platform.cpp,
+// linked like the app.
+namespace
+{
+  using clock_type = std::chrono::steady_clock;
+
+  double milliseconds_since(clock_type::time_point start)
+  {
+    return std::chrono::duration<double, std::milli>(clock_type::now() - start).count();
+  }
+
+  double median(std::vector<double> values)
+  {
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+  }
+}
+
+int main(int argc, char** argv)
+{
+  if (argc < 2)
+  {
+    std::cout << "usage: mapped_graph_bench <path> [side = 2000]" << '\n';
+    return 1;
+  }
+  std::string path = argv[1];
+  int side = (argc > 2 ? std::atoi(argv[2]) : 2000);
+  constexpr int spacing = 40;
+  std::string error;
+
+  if (not std::filesystem::exists(path))
+  {
+    std::map<int, olc::vi2d> nodes;
+    std::vector<line> lines;
+    for (int y = 0; y < side; y++)
+      for (int x = 0; x < side; x++)
+      {
+        int id = y * side + x + 1;
+        nodes[id] = {x * spacing, y * spacing};
+        if (x + 1 < side) lines.push_back(line(id, id + 1, 1 + id % 99));
+        if (y + 1 < side) lines.push_back(line(id, id + side, 1 + (id * 7) % 99));
+      }
+
+    auto started = clock_type::now();
+    if (not mapped_graph::build(path, nodes, lines, 32 * spacing, error))
+    {
+      std::cout << "Could not build " << path << ": " << error << '\n';
+      return 1;
+    }
+    std::cout << "Built " << nodes.size() << " nodes and " << lines.size() << " lines in " << milliseconds_since(started) << " ms" << '\n';
+  }
+
+  mapped_graph graph;
+  auto started = clock_type::now();
+  if (not graph.open(path, error))
+  {
+    std::cout << "Could not open " << path << ": " << error << '\n';
+    return 1;
+  }
+  std::cout << "Opened " << std::filesystem::file_size(path) / 1048576 << " MiB in " << milliseconds_since(started) << " ms" << '\n';
+  side = int(std::sqrt(double(graph.node_count())));
+  int world_size = side * spacing;
+
+  // Views of 1280 x 820 at random places, the first time and again
+  std::mt19937 random(7);
+  std::vector<double> first_reads = {};
+  std::vector<double> second_reads = {};
+  uint64_t seen = 0;
+  for (int k = 0; k < 20; k++)
+  {
+    olc::vi2d top_left = {int(random() % uint32_t(std::max(1, world_size - 1280))), int(random() % uint32_t(std::max(1, world_size - 820)))};
+    for (std::vector<double>* reads : {&first_reads, &second_reads})
+    {
+      auto view_started = clock_type::now();
+      graph.prefetch(graph.tile_of(top_left), graph.tile_of(top_left + olc::vi2d{1280, 820}));
+      graph.for_each_in_rect(top_left, top_left + olc::vi2d{1280, 820}, [&](uint32_t index, const olc::vi2d&)
+      {
+        graph.for_each_neighbour(index, [&](uint32_t, int, bool) { seen++; });
+      });
+      reads->push_back(milliseconds_since(view_started));
+    }
+  }
+  std::cout << "A view with its lines: " << median(first_reads) << " ms the first time, " << median(second_reads) << " ms again (medians of 20, " << seen / 40 << " lines per view)" << '\n';
+
+  // A tenth of the nodes in file order
+  started = clock_type::now();
+  uint64_t total_length = 0;
+  uint32_t count = uint32_t(graph.node_count() / 10);
+  for (uint32_t index = 0; index < count; index++)
+    graph.for_each_neighbour(index, [&](uint32_t, int length, bool is_outgoing) { if (is_outgoing) total_length += uint64_t(length); });
+  std::cout << "The lines of " << count << " nodes in file order: " << milliseconds_since(started) << " ms (lengths adding up to " << total_length << ")" << '\n';
+
+  for (int steps : {100, 300, 1000})
+  {
+    if (steps >= side) break;
+    int x = int(random() % uint32_t(side - steps));
+    int y = int(random() % uint32_t(side - steps));
+    int64_t from = graph.index_of(y * side + x + 1);
+    int64_t to = graph.index_of((y + steps) * side + x + steps + 1);
+    size_t settled = 0;
+    started = clock_type::now();
+    std::vector<uint32_t> found = graph.shortest_path(uint32_t(from), uint32_t(to), settled);
+    std::cout << "A path " << steps << " steps across both ways: " << found.size() << " nodes, " << settled << " settled in " << milliseconds_since(started) << " ms" << '\n';
+  }
+
+  std::cout << "In memory: " << graph.resident_bytes() / 1048576 << " MiB of the file" << '\n';
+  return 0;
+}
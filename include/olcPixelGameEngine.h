@@ -1117,6 +1117,9 @@ namespace olc
 	private:
 		void UpdateTextEntry();
 		void UpdateConsole();
+		// Fills the inclusive horizontal run sx..ex on row y, writing straight into
+		// the draw target when the pixel mode is NORMAL
+		void DrawSpan(int32_t sx, int32_t ex, int32_t y, Pixel p);
 
 	public:
 
@@ -1984,91 +1987,125 @@ namespace olc
 	}
 
 
+	void PixelGameEngine::DrawSpan(int32_t sx, int32_t ex, int32_t y, Pixel p)
+	{
+		if (!pDrawTarget) return;
+
+		if (nPixelMode != Pixel::NORMAL)
+		{
+			for (int32_t x = sx; x <= ex; x++) Draw(x, y, p);
+			return;
+		}
+
+		// Clip the whole run once instead of bounds checking every pixel
+		if (y < 0 || y >= pDrawTarget->height) return;
+		if (sx < 0) sx = 0;
+		if (ex >= pDrawTarget->width) ex = pDrawTarget->width - 1;
+		if (sx > ex) return;
+
+		// Plain 32-bit fill over contiguous memory, which the compiler turns into wide vector stores
+		uint32_t* dst = reinterpret_cast<uint32_t*>(pDrawTarget->GetData()) + y * pDrawTarget->width + sx;
+		std::fill_n(dst, ex - sx + 1, p.n);
+	}
+
 	void PixelGameEngine::DrawLine(const olc::vi2d& pos1, const olc::vi2d& pos2, Pixel p, uint32_t pattern)
 	{ DrawLine(pos1.x, pos1.y, pos2.x, pos2.y, p, pattern); }
 
 	void PixelGameEngine::DrawLine(int32_t x1, int32_t y1, int32_t x2, int32_t y2, Pixel p, uint32_t pattern)
 	{
-		int x, y, dx, dy, dx1, dy1, px, py, xe, ye, i;
+		if (!pDrawTarget) return;
+
+		int x, y, dx, dy, dx1, dy1, sx, sy, j, jlo, jhi;
 		dx = x2 - x1; dy = y2 - y1;
 
 		auto rol = [&](void) { pattern = (pattern << 1) | (pattern >> 31); return pattern & 1; };
+		// Advances the pattern as if rol() had been called n times
+		auto skip = [&](int n) { n &= 31; if (n) pattern = (pattern << n) | (pattern >> (32 - n)); };
 
-		olc::vi2d p1(x1, y1), p2(x2, y2);
-		//if (!ClipLineToScreen(p1, p2))
-		//	return;
-		x1 = p1.x; y1 = p1.y;
-		x2 = p2.x; y2 = p2.y;
+		// Lines are clipped to the draw target up front, so in NORMAL mode every pixel
+		// that is left can be written straight into the framebuffer
+		const int32_t w = pDrawTarget->width, h = pDrawTarget->height;
+		Pixel* data = pDrawTarget->GetData();
+		auto plot = [&](int px, int py) { if (nPixelMode == Pixel::NORMAL) data[py * w + px] = p; else Draw(px, py, p); };
 
 		// straight lines idea by gurkanctn
 		if (dx == 0) // Line is vertical
 		{
 			if (y2 < y1) std::swap(y1, y2);
-			for (y = y1; y <= y2; y++) if (rol()) Draw(x1, y, p);
+			if (x1 < 0 || x1 >= w) return;
+			if (y1 < 0) { skip(-y1); y1 = 0; }
+			if (y2 >= h) y2 = h - 1;
+			for (y = y1; y <= y2; y++) if (rol()) plot(x1, y);
 			return;
 		}
 
 		if (dy == 0) // Line is horizontal
 		{
 			if (x2 < x1) std::swap(x1, x2);
-			for (x = x1; x <= x2; x++) if (rol()) Draw(x, y1, p);
+			if (y1 < 0 || y1 >= h) return;
+			if (x1 < 0) { skip(-x1); x1 = 0; }
+			if (x2 >= w) x2 = w - 1;
+			for (x = x1; x <= x2; x++) if (rol()) plot(x, y1);
 			return;
 		}
 
 		// Line is Funk-aye
+		// Bresenham is walked in steps j = 0..n along the major axis, starting from the end
+		// with the smaller major coordinate. The minor axis offset after j steps has a closed
+		// form, which lets the visible range of j be found (Liang-Barsky style, but exact to
+		// the pixel) and the walk started in the middle without touching off-screen pixels.
 		dx1 = abs(dx); dy1 = abs(dy);
-		px = 2 * dy1 - dx1;	py = 2 * dx1 - dy1;
-		if (dy1 <= dx1)
-		{
-			if (dx >= 0)
-			{
-				x = x1; y = y1; xe = x2;
-			}
-			else
-			{
-				x = x2; y = y2; xe = x1;
-			}
+		const bool xmajor = dy1 <= dx1;
+		const int64_t n = xmajor ? dx1 : dy1, m = xmajor ? dy1 : dx1;
+		if (xmajor ? dx >= 0 : dy >= 0) { x = x1; y = y1; } else { x = x2; y = y2; }
+		const int s = ((dx < 0 && dy < 0) || (dx > 0 && dy > 0)) ? 1 : -1;
+		sx = xmajor ? 1 : s; sy = xmajor ? s : 1;
 
-			if (rol()) Draw(x, y, p);
+		// Number of minor axis steps taken after j major axis steps
+		auto minor_steps = [&](int64_t j) { return xmajor ? (2 * m * j + n) / (2 * n) : (2 * m * j + n - 1) / (2 * n); };
+		auto px_at = [&](int64_t j) { return x + (xmajor ? j : sx * minor_steps(j)); };
+		auto py_at = [&](int64_t j) { return y + (xmajor ? sy * minor_steps(j) : j); };
+		// Smallest j in [lo, hi + 1] for which the monotonic predicate holds
+		auto first = [](int lo, int hi, auto pred) { hi++; while (lo < hi) { int mid = lo + (hi - lo) / 2; if (pred(mid)) hi = mid; else lo = mid + 1; } return lo; };
 
-			for (i = 0; x < xe; i++)
-			{
-				x = x + 1;
-				if (px < 0)
-					px = px + 2 * dy1;
-				else
-				{
-					if ((dx < 0 && dy < 0) || (dx > 0 && dy > 0)) y = y + 1; else y = y - 1;
-					px = px + 2 * (dy1 - dx1);
-				}
-				if (rol()) Draw(x, y, p);
-			}
+		jlo = 0; jhi = int(n);
+		if (xmajor) { jlo = std::max(jlo, -x); jhi = std::min(jhi, w - 1 - x); }
+		else        { jlo = std::max(jlo, -y); jhi = std::min(jhi, h - 1 - y); }
+		if (jlo > jhi) return;
+
+		if (xmajor)
+		{
+			if (sy > 0) { jlo = first(jlo, jhi, [&](int k) { return py_at(k) >= 0; }); jhi = first(jlo, jhi, [&](int k) { return py_at(k) >= h; }) - 1; }
+			else        { jlo = first(jlo, jhi, [&](int k) { return py_at(k) < h; });  jhi = first(jlo, jhi, [&](int k) { return py_at(k) < 0; }) - 1; }
 		}
 		else
 		{
-			if (dy >= 0)
+			if (sx > 0) { jlo = first(jlo, jhi, [&](int k) { return px_at(k) >= 0; }); jhi = first(jlo, jhi, [&](int k) { return px_at(k) >= w; }) - 1; }
+			else        { jlo = first(jlo, jhi, [&](int k) { return px_at(k) < w; });  jhi = first(jlo, jhi, [&](int k) { return px_at(k) < 0; }) - 1; }
+		}
+		if (jlo > jhi) return;
+
+		// Resume the walk at jlo with the decision variable it would have had
+		skip(jlo);
+		int64_t e = 2 * m * (int64_t(jlo) + 1) - n - 2 * n * minor_steps(jlo);
+		x = int(px_at(jlo)); y = int(py_at(jlo));
+		if (rol()) plot(x, y);
+
+		for (j = jlo; j < jhi; j++)
+		{
+			if (xmajor)
 			{
-				x = x1; y = y1; ye = y2;
+				x += sx;
+				if (e < 0) e += 2 * m;
+				else { y += sy; e += 2 * (m - n); }
 			}
 			else
 			{
-				x = x2; y = y2; ye = y1;
-			}
-
-			if (rol()) Draw(x, y, p);
-
-			for (i = 0; y < ye; i++)
-			{
-				y = y + 1;
-				if (py <= 0)
-					py = py + 2 * dx1;
-				else
-				{
-					if ((dx < 0 && dy < 0) || (dx > 0 && dy > 0)) x = x + 1; else x = x - 1;
-					py = py + 2 * (dx1 - dy1);
-				}
-				if (rol()) Draw(x, y, p);
+				y += sy;
+				if (e <= 0) e += 2 * m;
+				else { x += sx; e += 2 * (m - n); }
 			}
+			if (rol()) plot(x, y);
 		}
 	}
 
@@ -2127,8 +2164,7 @@ namespace olc
 
 			auto drawline = [&](int sx, int ex, int y)
 			{
-				for (int x = sx; x <= ex; x++)
-					Draw(x, y, p);
+				DrawSpan(sx, ex, y, p);
 			};
 
 			while (y0 >= x0)
@@ -2234,9 +2270,8 @@ namespace olc
 		if (y2 < 0) y2 = 0;
 		if (y2 >= (int32_t)GetDrawTargetHeight()) y2 = (int32_t)GetDrawTargetHeight();
 
-		for (int i = x; i < x2; i++)
-			for (int j = y; j < y2; j++)
-				Draw(i, j, p);
+		for (int j = y; j < y2; j++)
+			DrawSpan(x, x2 - 1, j, p);
 	}
 
 	void PixelGameEngine::DrawTriangle(const olc::vi2d& pos1, const olc::vi2d& pos2, const olc::vi2d& pos3, Pixel p)
@@ -2255,7 +2290,7 @@ namespace olc
 	// https://www.avrfreaks.net/sites/default/files/triangles.c
 	void PixelGameEngine::FillTriangle(int32_t x1, int32_t y1, int32_t x2, int32_t y2, int32_t x3, int32_t y3, Pixel p)
 	{
-		auto drawline = [&](int sx, int ex, int ny) { for (int i = sx; i <= ex; i++) Draw(i, ny, p); };
+		auto drawline = [&](int sx, int ex, int ny) { DrawSpan(sx, ex, ny, p); };
 
 		int t1x, t2x, y, minx, maxx, t1xp, t2xp;
 		bool changed1 = false;
@@ -1,6 +1,34 @@
 #define OLC_PGE_APPLICATION
 #include "olcPixelGameEngine.h"
+#include "autosave.h"
+#include "camera.h"
+#include "edge_list_import.h"
+#include "edit_journal.h"
+#include "force_layout.h"
+#include "graph_export.h"
+#include "graph_file.h"
+#include "layered_layout.h"
+#include "line.h"
+#include "mapped_graph.h"
+#include "parallel.h"
+#include "path_search.h"
+#include "platform.h"
+#include "png_writer.h"
+#include "segment_bvh.h"
+#include "spatial_hash.h"
+#include "spectral_layout.h"
+#include "state_dump.h"
+#include "stress_layout.h"
+#include "svg_canvas.h"
+#include "tiled_canvas.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
 #include <map>
+#include <memory>
+#include <numeric>
 #include <queue>
 
 enum mode
@@ -17,43 +45,114 @@ enum arrow_head_size
   LARGE
 };
 
-struct line
+// How much of the graph gets painted, depending on how big the nodes are on screen
+enum detail_level
 {
-  int from;
-  int to;
-  int length;
+  FULL_DETAIL, // Everything
+  REDUCED_DETAIL, // No labels and no arrow heads
+  MINIMAL_DETAIL // Nodes are single pixels, lines are plain lines
+};
+
+// How the nodes to select are being outlined in MOVE mode
+enum selection_shape
+{
+  NO_SELECTION,
+  BOX_SELECTION,
+  LASSO_SELECTION
+};
 
-  line(int from, int to, int length)
+// Where the graph gets painted: onto the screen, a band of rows of an exported image (both through a tiled_canvas) or an
+// SVG document (through an svg_canvas)
+template<typename canvas_type>
+struct paint_target
+{
+  canvas_type& canvas;
+  camera view;
+  olc::vi2d size; // In pixels
+  bool interactive; // Whether hovering and the selection are shown, which they aren't in exported images
+
+  // Whether the rectangle spanned by the two corners, grown by the margin, is at least partially inside
+  bool contains(const olc::vi2d& top_left, const olc::vi2d& bottom_right, int margin) const
   {
-    this->from = from;
-    this->to = to;
-    this->length = length;
+    return bottom_right.x + margin >= 0 and bottom_right.y + margin >= 0 and top_left.x - margin < size.x and top_left.y - margin < size.y;
   }
 };
 
 class PGE_graph_visualiser : public olc::PixelGameEngine
 {
 public:
-  PGE_graph_visualiser() { sAppName = "PGE Graph Visualiser"; }
+  // The file (a graph file or an edge list) is opened right away if one is given; Ctrl+S saves to it as a graph file
+  explicit PGE_graph_visualiser(const std::string& file_path = {}) : file_path(file_path.empty() ? "graph.pgeg" : file_path), open_on_start(not file_path.empty())
+  {
+    sAppName = "PGE Graph Visualiser";
+  }
 
 private:
+  std::string file_path; // Where Ctrl+O opens the graph from; Ctrl+S saves it there with the extension .pgeg
+  bool open_on_start;
   int UI_section_height = 92;
   int radius = 10;
   int selected_node = 0;
+  int selected_line = -1; // Index into lines, -1 if none
+  std::vector<int> selected_nodes = {}; // Sorted IDs of the nodes picked with box/lasso selection in MOVE mode
+  selection_shape selecting = NO_SELECTION;
+  std::vector<olc::vi2d> selection_outline = {}; // In world coordinates; the two corners of the box or the points of the lasso
   int line_length = 1;
   int start = 0;
   int end = 0;
   float arrow_head_length = 20.0f; // Large => 25.0f
   float arrow_head_angle = 0.26f; // In radians; large => 0.35f
+  float reduced_detail_radius = 8.0f; // On screen node radius (in pixels) below which labels and arrow heads are left out
+  float minimal_detail_radius = 3.0f; // On screen node radius (in pixels) below which nodes are single pixels
+  int poster_size = 20000; // Pixels along the longer side of the images exported with Ctrl+P
+  int poster_band_height = 256; // Rows of such an image painted at a time (by each thread)
+  int mapped_tile_size = 1024; // World units along the side of the tiles of the mapped graphs written with Ctrl+M
+  int mapped_node_budget = 200'000; // Nodes in view above which a mapped graph is shown as tiles shaded by how full they are
   bool graph_has_changed = false;
   arrow_head_size arrow_head_size = SMALL;
   mode mode = MOVE;
   std::vector<line> lines = {};
-  std::map<int, olc::vi2d> nodes = {}; // The key serves as the ID of the node
+  std::map<int, olc::vi2d> nodes = {}; // The key serves as the ID of the node; positions are in world coordinates
+  spatial_hash node_grid = spatial_hash(2 * radius); // Has to be kept in sync with nodes, used to find nodes by position
+  segment_bvh line_tree; // Used to find lines by position; invalidated whenever lines change, refitted when nodes move
   std::vector<int> path = {};
+  // The graph itself is recorded into this and rasterised in parallel, the UI is drawn directly
+  tiled_canvas canvas;
+  camera view;
+  force_layout layout; // Steps in the background while it is turned on
+  size_t reported_levels = 0; // How many of the layout's finished levels have been reported
+  stress_layout stress; // The layout which keeps to the line lengths
+  layered_layout layers; // The layout which makes every line point downwards
+  spectral_layout spectral; // The quick first placement, force_layout takes over from it; only one of them runs at a time
+  edge_list_import importer; // Replaces the graph once it is done
+  std::string importing_path = {}; // The file the importer is reading
+  // Every edit since the graph was last opened or saved, kept in <name>.journal next to the file; edits that never got
+  // saved are replayed on the next start
+  edit_journal journal;
+  std::vector<edit_journal::edit> unreplayed_edits = {}; // From the journal, replayed once the graph they were made to is open
+  uint64_t graph_version = 0; // Goes up with every change to the nodes or lines
+  uint64_t edit_version = 0; // The same without the changes made by the layouts, which only look at the graph again once it goes up
+  uint64_t structure_version = 0; // The same for changes to which nodes and lines there are, nodes moving left out
+  autosave autosaver; // Writes the graph to <name>.autosave.pgeg every so often, which the journal then starts from
+  std::vector<edit_journal::edit> edits_since_snapshot = {}; // Made while the autosave is being written, so not in it
+  state_dump dumper; // Writes everything to <name>.dump-<time>.json for debugging when D is pressed
+  // A graph too big for memory, used in place from its file and shown instead of nodes and lines while it is open. It can
+  // be looked at and searched for paths, but not edited.
+  mapped_graph mapped;
+  path_search searcher; // Finds paths through the mapped graph in the background
+  olc::vi2d prefetched_first = {0, 0}; // The corners of the rectangle of tiles of the mapped graph last read ahead
+  olc::vi2d prefetched_last = {-1, -1};
+  bool nodes_dragged = false; // Whether the nodes being held have moved, only then does letting go of them get journaled
+  int panning_button = -1; // The mouse button currently dragging the view around, -1 if none
+  olc::vi2d last_mouse_position = {0, 0};
 
 public:
-  bool OnUserCreate() override { return true; }
+  bool OnUserCreate() override
+  {
+    canvas.init(*this);
+    start_session();
+    return true;
+  }
 
   bool OnUserUpdate(float elapsed_time) override
   {
@@ -61,12 +160,24 @@ public:
     {
       Clear(olc::BLACK);
 
+      handle_file_keys();
       handle_mode_change_with_keys();
+      handle_camera();
+      // Before the input, so a node being dragged ends up under the mouse rather than where the layout pushed it
+      run_layout();
+      run_import();
+      run_path_search();
       handle_input();
 
       if (graph_has_changed) reset_graph();
 
-      paint_lines();
+      // The lines are culled through the line tree, which is rebuilt here unless a layout moves everything every frame
+      bool laying_out = layout.is_running() or stress.is_running() or layers.is_running() or spectral.is_running();
+      if (not line_tree.is_built() and not laying_out) line_tree.build(lines, nodes);
+
+      paint_target<tiled_canvas> screen = {canvas, view, {ScreenWidth(), ScreenHeight()}, true};
+      if (mapped.is_open()) paint_mapped_lines(screen);
+      else paint_lines(screen);
 
       if (mode == PATH)
       {
@@ -74,17 +185,19 @@ public:
         paint_path();
       }
 
-      paint_nodes();
+      if (mapped.is_open()) paint_mapped_nodes(screen);
+      else paint_nodes(screen);
+      paint_selection();
+
+      canvas.flush(GetDrawTarget());
 
       paint_UI();
     }
 
-    if (GetKey(olc::D).bPressed)
-    {
-      std::cout << "Nodes:" << '\n';
-      for (const auto& node : nodes) std::cout << node.first << ' ' << node.second << '\n';
-      std::cout << '\n';
-    }
+    run_autosave();
+
+    if (GetKey(olc::D).bPressed) dump_state();
+    run_state_dump();
 
     return true;
   }
@@ -94,35 +207,680 @@ public:
 
 
 private:
+  // Picks up the edits of the last session if it ended without saving them (by crashing, say): the graph they were made to
+  // is opened and they are replayed on top of it. Otherwise the file given (if any) is opened.
+  void start_session()
+  {
+    std::string path = std::filesystem::path(file_path).replace_extension(".journal").string();
+    std::string base;
+    std::string error;
+    if (not journal.open(path, base, unreplayed_edits, error)) std::cout << "Could not open the edit journal " << path << ": " << error << '\n';
+
+    if (not unreplayed_edits.empty())
+    {
+      std::cout << "Recovering " << unreplayed_edits.size() << " unsaved edits from " << path << '\n';
+      if (base.empty()) replay_edits();
+      else open_graph(base);
+      return;
+    }
+
+    journal.restart({});
+    if (open_on_start) open_graph(file_path);
+  }
+
+  void handle_file_keys()
+  {
+    if (not GetKey(olc::CTRL).bHeld) return;
+
+    if (GetKey(olc::O).bPressed) open_graph(file_path);
+    // A mapped graph is only looked at, there is nothing in memory to save or export
+    else if (mapped.is_open()) return;
+    else if (GetKey(olc::S).bPressed) save_graph();
+    else if (GetKey(olc::M).bPressed) save_mapped_graph();
+    else if (GetKey(olc::E).bPressed) export_graph();
+    else if (GetKey(olc::P).bPressed) export_image();
+    else if (GetKey(olc::G).bPressed) export_svg(not GetKey(olc::SHIFT).bHeld);
+  }
+
+  // An edge list that was opened doesn't get overwritten, the graph file goes next to it
+  void save_graph()
+  {
+    std::string path = std::filesystem::path(file_path).replace_extension(".pgeg").string();
+    auto started = std::chrono::steady_clock::now();
+    std::string error;
+    if (not graph_file::save(path, nodes, lines, error))
+    {
+      std::cout << "Could not save " << path << ": " << error << '\n';
+      return;
+    }
+
+    journal.restart(path);
+    autosaver.mark_saved(graph_version);
+    edits_since_snapshot.clear();
+    float milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - started).count();
+    std::cout << "Saved " << nodes.size() << " nodes and " << lines.size() << " lines to " << path << " in " << milliseconds << " ms" << '\n';
+  }
+
+  // Writes the graph next to the file as <name>.pgem, a mapped graph file, which opens like any other but is used in place
+  // from disk instead of being loaded. Meant for graphs bigger than memory, which have to be written that way by something
+  // else, but any graph can be.
+  void save_mapped_graph()
+  {
+    std::string path = std::filesystem::path(file_path).replace_extension(".pgem").string();
+    auto started = std::chrono::steady_clock::now();
+    std::string error;
+    if (not mapped_graph::build(path, nodes, lines, mapped_tile_size, error))
+    {
+      std::cout << "Could not save " << path << ": " << error << '\n';
+      return;
+    }
+
+    float milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - started).count();
+    std::cout << "Saved " << nodes.size() << " nodes and " << lines.size() << " lines to " << path << " as a mapped graph in " << milliseconds << " ms" << '\n';
+  }
+
+  // For other tools: writes the graph next to the file as <name>.dot and <name>.graphml
+  void export_graph()
+  {
+    std::filesystem::path path = file_path;
+    std::string dot_path = path.replace_extension(".dot").string();
+    std::string graphml_path = path.replace_extension(".graphml").string();
+
+    auto started = std::chrono::steady_clock::now();
+    std::string error;
+    if (not graph_export::write_dot(dot_path, nodes, lines, error) or not graph_export::write_graphml(graphml_path, nodes, lines, error))
+    {
+      std::cout << "Could not export the graph: " << error << '\n';
+      return;
+    }
+
+    float milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - started).count();
+    std::cout << "Exported " << nodes.size() << " nodes and " << lines.size() << " lines to " << dot_path << " and " << graphml_path << " in " << milliseconds << " ms" << '\n';
+  }
+
+  // Paints the whole graph into <name>.png, poster_size pixels along its longer side (unless that would zoom in further than
+  // the view can). The image is painted in bands of rows, as many at once as there are threads, and the bands go to the PNG
+  // encoder one after the other, so only those few bands are ever held in memory however big the image is.
+  void export_image()
+  {
+    if (nodes.empty()) return;
+
+    std::string path = std::filesystem::path(file_path).replace_extension(".png").string();
+    auto started = std::chrono::steady_clock::now();
+
+    olc::vi2d top_left;
+    olc::vi2d extent;
+    graph_bounds(top_left, extent);
+    camera poster_view;
+    poster_view.zoom = std::min(float(poster_size) / float(std::max(extent.x, extent.y)), view.max_zoom);
+    poster_view.offset = olc::vf2d(top_left);
+    int width = std::max(1, int(std::ceil(float(extent.x) * poster_view.zoom)));
+    int height = std::max(1, int(std::ceil(float(extent.y) * poster_view.zoom)));
+
+    png_writer png;
+    std::string error;
+    if (not png.open(path, width, height, error))
+    {
+      std::cout << "Could not export " << path << ": " << error << '\n';
+      return;
+    }
+
+    // Every thread paints its own band with its own canvas; the line tree they cull with has to be there beforehand
+    if (not line_tree.is_built()) line_tree.build(lines, nodes);
+    int thread_count = int(std::max(1u, std::thread::hardware_concurrency()));
+    int band_count = (height + poster_band_height - 1) / poster_band_height;
+    std::vector<std::unique_ptr<olc::Sprite>> bands = {};
+    std::vector<tiled_canvas> band_canvases(size_t(std::min(thread_count, band_count)), canvas);
+    for (auto& band_canvas : band_canvases)
+    {
+      bands.push_back(std::make_unique<olc::Sprite>(width, poster_band_height));
+      band_canvas.thread_count = 1;
+    }
+
+    for (int first = 0; first < band_count; first += int(bands.size()))
+    {
+      int count = std::min(int(bands.size()), band_count - first);
+      parallel_for(thread_count, count, 1, [&](int slot, int)
+      {
+        olc::Sprite& band = *bands[slot];
+        std::fill(band.GetData(), band.GetData() + size_t(width) * size_t(poster_band_height), olc::BLACK);
+
+        paint_target<tiled_canvas> target = {band_canvases[slot], poster_view, {width, poster_band_height}, false};
+        target.view.offset.y += float((first + slot) * poster_band_height) / poster_view.zoom;
+        paint_lines(target);
+        paint_nodes(target);
+        target.canvas.flush(&band);
+      });
+      for (int slot = 0; slot < count; slot++) png.write_rows(*bands[slot], std::min(poster_band_height, height - (first + slot) * poster_band_height));
+    }
+
+    if (not png.close(error))
+    {
+      std::cout << "Could not export " << path << ": " << error << '\n';
+      return;
+    }
+
+    float milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - started).count();
+    std::cout << "Exported a " << width << " x " << height << " image of the graph to " << path << " in " << milliseconds << " ms" << '\n';
+  }
+
+  // Writes the graph as SVG, painted like on screen but without hovering or the selection: the whole graph at a zoom of 1
+  // to <name>.svg with Ctrl+G, or just what is in view below the UI to <name>.view.svg with Ctrl+Shift+G. Everything outside
+  // of that is culled like on screen.
+  void export_svg(bool whole_graph)
+  {
+    if (nodes.empty()) return;
+
+    std::string path = std::filesystem::path(file_path).replace_extension(whole_graph ? ".svg" : ".view.svg").string();
+    auto started = std::chrono::steady_clock::now();
+
+    camera svg_view = view;
+    olc::vi2d size = {ScreenWidth(), ScreenHeight() - UI_section_height};
+    svg_view.offset.y += float(UI_section_height) / view.zoom;
+    if (whole_graph)
+    {
+      olc::vi2d top_left;
+      graph_bounds(top_left, size);
+      svg_view = {};
+      svg_view.offset = olc::vf2d(top_left);
+    }
+
+    svg_canvas svg;
+    std::string error;
+    if (not svg.open(path, size, olc::BLACK, error))
+    {
+      std::cout << "Could not export " << path << ": " << error << '\n';
+      return;
+    }
+    if (not line_tree.is_built()) line_tree.build(lines, nodes);
+    paint_target<svg_canvas> target = {svg, svg_view, size, false};
+    paint_lines(target);
+    paint_nodes(target);
+    if (not svg.close(error))
+    {
+      std::cout << "Could not export " << path << ": " << error << '\n';
+      return;
+    }
+
+    float milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - started).count();
+    std::cout << "Exported " << (whole_graph ? "the graph" : "the view") << " to " << path << " in " << milliseconds << " ms" << '\n';
+  }
+
+  // The world rectangle the whole graph takes up, with room for the circles of the outermost nodes (there has to be one)
+  void graph_bounds(olc::vi2d& top_left, olc::vi2d& extent)
+  {
+    olc::vi2d smallest = nodes.begin()->second;
+    olc::vi2d largest = smallest;
+    for (const auto& [id, position] : nodes)
+    {
+      smallest = smallest.min(position);
+      largest = largest.max(position);
+    }
+    int margin = 2 * radius;
+    top_left = smallest - olc::vi2d{margin, margin};
+    extent = largest - smallest + olc::vi2d{2 * margin, 2 * margin};
+  }
+
+  // Replaces the graph with the one in the file, unless it can't be loaded. Anything but a graph file is imported as an
+  // edge list in the background, which replaces the graph once it is done.
+  void open_graph(const std::string& path)
+  {
+    if (importer.is_running()) return;
+    if (mapped_graph::is_mapped_graph(path))
+    {
+      open_mapped_graph(path);
+      return;
+    }
+    if (not graph_file::is_graph_file(path))
+    {
+      importing_path = path;
+      importer.start(path);
+      return;
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    std::string error;
+    if (not graph_file::load(path, nodes, lines, error))
+    {
+      std::cout << "Could not open " << path << ": " << error << '\n';
+      // Recovered edits go onto the graph there is rather than nowhere
+      if (not unreplayed_edits.empty()) replay_edits();
+      return;
+    }
+
+    close_mapped_graph();
+    graph_replaced(path);
+    float milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - started).count();
+    std::cout << "Opened " << nodes.size() << " nodes and " << lines.size() << " lines from " << path << " in " << milliseconds << " ms" << '\n';
+  }
+
+  void run_import()
+  {
+    if (not importer.update(nodes, lines)) return;
+
+    if (not importer.error().empty())
+    {
+      std::cout << "Could not import " << importing_path << ": " << importer.error() << '\n';
+      // Recovered edits go onto the graph there is rather than nowhere
+      if (not unreplayed_edits.empty()) replay_edits();
+      return;
+    }
+
+    close_mapped_graph();
+    graph_replaced(importing_path);
+    std::cout << "Imported " << nodes.size() << " nodes and " << lines.size() << " lines from " << importing_path << " in " << importer.milliseconds() << " ms";
+    std::cout << " (" << importer.skipped_count() << " text lines skipped, " << importer.dropped_count() << " duplicate lines or loops dropped)" << '\n';
+  }
+
+  // Only the file's header is read (and checked), the rest of it is read and checked as it comes into view. The graph in
+  // memory makes way for it.
+  void open_mapped_graph(const std::string& path)
+  {
+    close_mapped_graph();
+
+    auto started = std::chrono::steady_clock::now();
+    std::string error;
+    if (not mapped.open(path, error))
+    {
+      std::cout << "Could not open " << path << ": " << error << '\n';
+      if (not unreplayed_edits.empty()) replay_edits();
+      return;
+    }
+
+    nodes.clear();
+    lines.clear();
+    lines.shrink_to_fit();
+    graph_replaced(path);
+    view.reset();
+    view.offset = olc::vf2d(mapped.origin());
+    float milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - started).count();
+    std::cout << "Opened the mapped graph " << path << " with " << mapped.node_count() << " nodes and " << mapped.line_count() << " lines in " << milliseconds << " ms" << '\n';
+  }
+
+  // The search has to be done with the file before it goes
+  void close_mapped_graph()
+  {
+    searcher.stop();
+    mapped.close();
+    prefetched_first = {0, 0};
+    prefetched_last = {-1, -1};
+  }
+
+  void run_path_search()
+  {
+    if (not searcher.update()) return;
+
+    path.clear();
+    for (uint32_t index : searcher.path()) path.push_back(mapped.id(index));
+    if (path.empty()) std::cout << "No path from " << start << " to " << end;
+    else std::cout << "Found a path of " << path.size() << " nodes from " << start << " to " << end;
+    std::cout << " in " << searcher.milliseconds() << " ms, settling " << searcher.settled_count() << " nodes" << '\n';
+  }
+
+  // Nothing picked or computed for the old graph applies to the new one, which is as it is in the file at the path
+  void graph_replaced(const std::string& path)
+  {
+    layout.stop();
+    stress.stop();
+    layers.stop();
+    spectral.stop();
+    selected_node = 0;
+    selected_line = -1;
+    selected_nodes.clear();
+    selecting = NO_SELECTION;
+    selection_outline.clear();
+    start = 0;
+    end = 0;
+
+    node_grid.clear();
+    for (const auto& [id, position] : nodes) node_grid.insert(id, position);
+    line_tree.invalidate();
+    graph_has_changed = true;
+    graph_version++;
+    edit_version++;
+    structure_version++;
+    edits_since_snapshot.clear();
+
+    // The edits recovered from the journal were made to this graph, otherwise the journal starts over from it
+    if (not unreplayed_edits.empty()) replay_edits();
+    else
+    {
+      journal.restart(path);
+      autosaver.mark_saved(graph_version);
+    }
+  }
+
+  void replay_edits()
+  {
+    for (const auto& edit : unreplayed_edits) apply_edit(edit);
+    unreplayed_edits.clear();
+    line_tree.invalidate();
+    graph_has_changed = true;
+    graph_version++;
+    edit_version++;
+    structure_version++;
+  }
+
+  // For debugging: the graph and everything else goes to a JSON file named after the time, in the background
+  void dump_state()
+  {
+    if (dumper.is_running()) return;
+
+    auto now = std::chrono::system_clock::now();
+    std::time_t time = std::chrono::system_clock::to_time_t(now);
+    std::tm local = platform::local_time(time);
+    char time_text[32] = {};
+    size_t length = std::strftime(time_text, sizeof(time_text), "%Y%m%d-%H%M%S", &local);
+    int milliseconds = int(std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count() % 1000);
+    std::snprintf(time_text + length, sizeof(time_text) - length, "-%03d", milliseconds);
+
+    std::string name = std::filesystem::path(file_path).stem().string() + ".dump-" + time_text + ".json";
+    dumper.start(nodes, lines, graph_version, structure_version, current_state(), (std::filesystem::path(file_path).parent_path() / name).string());
+  }
+
+  void run_state_dump()
+  {
+    if (not dumper.update(nodes, lines, graph_version, structure_version)) return;
+
+    if (not dumper.error().empty())
+    {
+      std::cout << "Could not dump the state to " << dumper.path() << ": " << dumper.error() << '\n';
+      return;
+    }
+    std::cout << "Dumped the state to " << dumper.path() << " in " << dumper.milliseconds() << " ms" << '\n';
+  }
+
+  state_dump::app_state current_state()
+  {
+    state_dump::app_state state;
+    constexpr const char* mode_names[] = {"MOVE", "NODE", "LINE", "PATH"};
+    state.mode = mode_names[mode];
+    state.camera_offset = view.offset;
+    state.camera_zoom = view.zoom;
+    state.selected_node = selected_node;
+    state.selected_line = selected_line;
+    state.selected_nodes = selected_nodes;
+    state.start = start;
+    state.end = end;
+    state.path = path;
+
+    if (layout.is_running()) state.running.push_back("force_layout");
+    if (stress.is_running()) state.running.push_back("stress_layout");
+    if (layers.is_running()) state.running.push_back("layered_layout");
+    if (spectral.is_running()) state.running.push_back("spectral_layout");
+    if (importer.is_running()) state.running.push_back("edge_list_import");
+    if (autosaver.is_saving()) state.running.push_back("autosave");
+    if (searcher.is_running()) state.running.push_back("path_search");
+
+    // A map node carries 32 bytes of links and colour on top of its element
+    state.figures.emplace_back("frame_milliseconds", double(GetElapsedTime()) * 1000.0);
+    state.figures.emplace_back("frames_per_second", double(GetFPS()));
+    state.figures.emplace_back("node_bytes", double(nodes.size() * (sizeof(std::pair<const int, olc::vi2d>) + 32)));
+    state.figures.emplace_back("line_bytes", double(lines.capacity() * sizeof(line)));
+    if (mapped.is_open())
+    {
+      state.figures.emplace_back("mapped_node_count", double(mapped.node_count()));
+      state.figures.emplace_back("mapped_line_count", double(mapped.line_count()));
+      state.figures.emplace_back("mapped_resident_bytes", double(mapped.resident_bytes()));
+    }
+    return state;
+  }
+
+  // Every edit made by hand goes through here
+  void record(const edit_journal::edit& edit)
+  {
+    journal.append(edit);
+    if (autosaver.is_saving()) edits_since_snapshot.push_back(edit);
+    graph_version++;
+    edit_version++;
+    // The nodes have been moved (through move_nodes()) before that is recorded
+    if (edit.type != edit_journal::MOVE_NODE) structure_version++;
+  }
+
+  // Once an autosave is in place the journal starts over from it, keeping only the edits made after its snapshot
+  void run_autosave()
+  {
+    std::string path = std::filesystem::path(file_path).replace_extension(".autosave.pgeg").string();
+    if (not autosaver.update(nodes, lines, graph_version, structure_version, path)) return;
+
+    if (not autosaver.error().empty())
+    {
+      std::cout << "Could not autosave to " << path << ": " << autosaver.error() << '\n';
+      edits_since_snapshot.clear();
+      return;
+    }
+
+    journal.restart(autosaver.path());
+    for (const auto& edit : edits_since_snapshot) journal.append(edit);
+    edits_since_snapshot.clear();
+    std::cout << "Autosaved " << autosaver.node_count() << " nodes and " << autosaver.line_count() << " lines to " << autosaver.path() << " in " << autosaver.milliseconds() << " ms" << '\n';
+  }
+
+  // Makes an edit from the journal again, skipping it if it doesn't fit the graph (anymore)
+  void apply_edit(const edit_journal::edit& edit)
+  {
+    auto line_between = [&](int from, int to) { return std::find_if(lines.begin(), lines.end(), [&](const line& line) { return line.from == from and line.to == to; }); };
+
+    switch (edit.type)
+    {
+      case edit_journal::CREATE_NODE:
+        if (edit.a <= 0 or nodes.count(edit.a) != 0) break;
+        nodes[edit.a] = {edit.b, edit.c};
+        node_grid.insert(edit.a, nodes[edit.a]);
+        break;
+      case edit_journal::DELETE_NODE: delete_nodes({edit.a}); break;
+      case edit_journal::MOVE_NODE:
+        if (nodes.count(edit.a) != 0) move_nodes({edit.a}, olc::vi2d{edit.b, edit.c} - nodes[edit.a]);
+        break;
+      case edit_journal::ADD_LINE:
+        if (nodes.count(edit.a) == 0 or nodes.count(edit.b) == 0 or line_between(edit.a, edit.b) != lines.end() or line_between(edit.b, edit.a) != lines.end()) break;
+        lines.push_back(line(edit.a, edit.b, edit.c));
+        break;
+      case edit_journal::DELETE_LINE:
+        std::erase_if(lines, [&](const line& line) { return line.from == edit.a and line.to == edit.b; });
+        break;
+      case edit_journal::SET_LINE_LENGTH:
+        if (auto found = line_between(edit.a, edit.b); found != lines.end()) found->length = edit.c;
+        break;
+      case edit_journal::CLEAR_GRAPH:
+        lines.clear();
+        nodes.clear();
+        node_grid.clear();
+        break;
+      case edit_journal::CLEAR_LINES: lines.clear(); break;
+    }
+  }
+
   void handle_mode_change_with_keys()
   {
-    if (GetKey(olc::M).bPressed) mode = MOVE;
+    // Ctrl+M saves a mapped graph instead
+    if (GetKey(olc::M).bPressed and not GetKey(olc::CTRL).bHeld) mode = MOVE;
     else if (GetKey(olc::N).bPressed) mode = NODE;
     else if (GetKey(olc::L).bPressed) mode = LINE;
-    else if (GetKey(olc::P).bPressed) mode = PATH;
+    // Ctrl+P exports an image instead
+    else if (GetKey(olc::P).bPressed and not GetKey(olc::CTRL).bHeld) mode = PATH;
+  }
+
+  void handle_camera()
+  {
+    // Zooming in and out around the mouse
+    if (GetMouseY() > UI_section_height)
+    {
+      if (GetMouseWheel() > 0) view.zoom_at(GetMousePos(), 1.1f);
+      else if (GetMouseWheel() < 0) view.zoom_at(GetMousePos(), 1.0f / 1.1f);
+    }
+
+    // Panning by dragging with the middle mouse button (MOVE mode also pans when dragging empty space, see handle_input())
+    if (GetMouse(2).bPressed and GetMouseY() > UI_section_height) panning_button = 2;
+
+    if (panning_button != -1)
+    {
+      if (GetMouse(panning_button).bHeld) view.pan(GetMousePos() - last_mouse_position);
+      else panning_button = -1;
+    }
+
+    last_mouse_position = GetMousePos();
+
+    if (GetKey(olc::HOME).bPressed) view.reset();
+  }
+
+  void run_layout()
+  {
+    // A mapped graph stays where its file has it
+    if (mapped.is_open()) return;
+
+    if (GetKey(olc::F).bPressed)
+    {
+      stress.stop();
+      layers.stop();
+      spectral.stop();
+      if (layout.is_running()) layout.stop();
+      else layout.start();
+    }
+    // Ctrl+S saves the graph instead
+    else if (GetKey(olc::S).bPressed and not GetKey(olc::CTRL).bHeld)
+    {
+      layout.stop();
+      layers.stop();
+      spectral.stop();
+      if (stress.is_running()) stress.stop();
+      else stress.start();
+    }
+    else if (GetKey(olc::H).bPressed)
+    {
+      layout.stop();
+      stress.stop();
+      spectral.stop();
+      if (layers.is_running()) layers.stop();
+      else layers.start();
+    }
+    // Ctrl+E exports the graph instead
+    else if (GetKey(olc::E).bPressed and not GetKey(olc::CTRL).bHeld)
+    {
+      layout.stop();
+      stress.stop();
+      layers.stop();
+      if (spectral.is_running()) spectral.stop();
+      else spectral.start();
+    }
+
+    bool anything_moved = false;
+    auto node_moved = [&](int id, const olc::vi2d& from, const olc::vi2d& to)
+    {
+      node_grid.move(id, from, to);
+      autosaver.moved(id, to);
+      dumper.moved(id, to);
+      anything_moved = true;
+    };
+    bool layering = layers.is_running();
+    bool placing = spectral.is_running();
+    layout.update(nodes, lines, edit_version, node_moved);
+    stress.update(nodes, lines, edit_version, node_moved);
+    layers.update(nodes, lines, edit_version, node_moved);
+    spectral.update(nodes, lines, node_moved);
+
+    // The spectral placement only gets the rough shape right, the forces take it from there
+    if (placing and not spectral.is_running())
+    {
+      std::cout << "Spectral layout: " << spectral.milliseconds() << " ms" << '\n';
+      layout.start();
+    }
+
+    // Everything moves at once, so rebuilding the line tree on the next pick is cheaper than refitting it node by node
+    if (anything_moved)
+    {
+      line_tree.invalidate();
+      graph_version++;
+    }
+
+    // Reporting how long every level took as soon as it is done (the reports start over with every run)
+    const auto& reports = layout.level_reports();
+    if (reports.size() < reported_levels) reported_levels = 0;
+    for (; reported_levels < reports.size(); reported_levels++)
+    {
+      const auto& report = reports[reported_levels];
+      std::cout << "Layout level " << report.level << ": " << report.node_count << " nodes, " << report.line_count << " lines, " << report.steps << " steps, " << report.milliseconds << " ms" << '\n';
+    }
+    if (layering and not layers.is_running()) std::cout << "Layered layout: " << layers.crossing_count() << " crossings" << '\n';
   }
 
   void handle_input()
   {
+    if (mapped.is_open())
+    {
+      handle_mapped_input();
+      return;
+    }
+
+    // Lines can only be selected in LINE mode, multiple nodes only in MOVE mode
+    if (mode != LINE) selected_line = -1;
+    if (mode != MOVE)
+    {
+      selected_nodes.clear();
+      selecting = NO_SELECTION;
+    }
+
     if (mode == MOVE)
     {
       // The node which the mouse is hovering over is being selected
       if (GetMouse(0).bPressed)
       {
-        for (const auto& node : nodes) if (is_mouse_in_circle(node.second)) selected_node = node.first;
+        selected_node = node_under_mouse();
+
+        // Grabbing a node outside of the selection drops the selection
+        if (selected_node != 0 and not is_node_selected(selected_node)) selected_nodes.clear();
+
+        if (selected_node == 0 and GetMouseY() > UI_section_height)
+        {
+          // Outlining the nodes to select, a box with Shift and a lasso with Ctrl
+          if (GetKey(olc::SHIFT).bHeld or GetKey(olc::CTRL).bHeld)
+          {
+            selecting = (GetKey(olc::SHIFT).bHeld ? BOX_SELECTION : LASSO_SELECTION);
+            selection_outline = {mouse_world_position(), mouse_world_position()};
+          }
+          // Grabbing empty space drags the view around instead (and drops the selection)
+          else
+          {
+            selected_nodes.clear();
+            panning_button = 0;
+          }
+        }
+      }
+      // Growing the outline
+      else if (GetMouse(0).bHeld and selecting != NO_SELECTION)
+      {
+        if (selecting == BOX_SELECTION) selection_outline.back() = mouse_world_position();
+        // The lasso gets a new point whenever the mouse has moved a few pixels away from the last one
+        else if ((GetMousePos() - view.world_to_screen(selection_outline.back())).mag2() >= 16) selection_outline.push_back(mouse_world_position());
       }
-      // Moving the node around
+      // Moving the node (or the whole selection if it is part of it) around
       else if (GetMouse(0).bHeld and selected_node != 0)
       {
-        nodes[selected_node] = {GetMouseX(), GetMouseY()};
+        olc::vi2d delta = mouse_world_position() - nodes[selected_node];
+        if (delta != olc::vi2d{0, 0}) nodes_dragged = true;
 
-        if (nodes[selected_node].x < radius) nodes[selected_node].x = radius;
-        if (nodes[selected_node].y < UI_section_height + radius) nodes[selected_node].y = UI_section_height + radius;
-        if (nodes[selected_node].x > ScreenWidth() - radius) nodes[selected_node].x = ScreenWidth() - radius;
-        if (nodes[selected_node].y > ScreenHeight() - radius) nodes[selected_node].y = ScreenHeight() - radius;
+        if (is_node_selected(selected_node)) move_nodes(selected_nodes, delta);
+        else move_nodes({selected_node}, delta);
       }
       // Releasing the node from our iron grip
-      else if (GetMouse(0).bReleased) selected_node = 0;
+      else if (GetMouse(0).bReleased)
+      {
+        if (selecting != NO_SELECTION) select_outlined_nodes();
+        // Only where the nodes ended up goes into the journal
+        else if (selected_node != 0 and nodes_dragged)
+        {
+          for (const int& id : (is_node_selected(selected_node) ? selected_nodes : std::vector<int>{selected_node})) record({edit_journal::MOVE_NODE, id, nodes[id].x, nodes[id].y});
+        }
+        selected_node = 0;
+        nodes_dragged = false;
+      }
+
+      // If user presses delete or backspace they delete the selected nodes
+      if ((GetKey(olc::BACK).bPressed or GetKey(olc::DEL).bPressed) and not selected_nodes.empty())
+      {
+        for (const int& id : selected_nodes) record({edit_journal::DELETE_NODE, id});
+        delete_nodes(selected_nodes);
+      }
     }
     else if (mode == NODE)
     {
@@ -130,15 +888,15 @@ private:
       if (GetMouseY() > UI_section_height and GetMouse(0).bPressed)
       {
         // Only create a new node if it does not overlap with any existing one
-        for (const auto& node : nodes)
-        {
-          // Giving the mouse a bit of a deadzone around it just to be safe
-          // Not creating a node if the mouse overlaps with an existing node (hence the early return)
-          if (do_circles_overlap(node.second, {GetMouseX() + 2, GetMouseY() + 2})) return;
-        }
+        // Giving the mouse a bit of a deadzone around it just to be safe
+        // Not creating a node if the mouse overlaps with an existing node (hence the early return)
+        if (node_overlapping(mouse_world_position() + olc::vi2d{2, 2}) != 0) return;
 
         // Creating a new node
-        nodes[generate_node_ID()] = {GetMouseX(), GetMouseY()};
+        int id = generate_node_ID();
+        nodes[id] = mouse_world_position();
+        node_grid.insert(id, nodes[id]);
+        record({edit_journal::CREATE_NODE, id, nodes[id].x, nodes[id].y});
 
         graph_has_changed = true;
       }
@@ -146,34 +904,24 @@ private:
       else if (GetMouse(1).bPressed)
       {
         // Finding the node
-        for (const auto& node : nodes)
-        {
-          if (do_circles_overlap(node.second, {GetMouseX(), GetMouseY()}))
-          {
-            // Deleting all lines associated with said node
-            // Using an iterator because only an iterator allows one to delete an element
-            for (std::vector<line>::iterator line = lines.begin(); line < lines.end(); line++)
-            {
-              if (line->from == node.first or line->to == node.first)
-              {
-                lines.erase(line);
-                line--;
-              }
-            }
+        int id = node_overlapping(mouse_world_position());
 
-            // Deleting the node
-            nodes.erase(node.first);
-            graph_has_changed = true;
-            break;
-          }
+        // Deleting the node and all lines associated with it
+        if (id != 0)
+        {
+          record({edit_journal::DELETE_NODE, id});
+          delete_nodes({id});
         }
       }
 
       // If user presses delete or backspace they delete all nodes and lines
       if (GetKey(olc::BACK).bPressed or GetKey(olc::DEL).bPressed)
       {
+        record({edit_journal::CLEAR_GRAPH});
         lines.clear();
         nodes.clear();
+        node_grid.clear();
+        line_tree.invalidate();
         graph_has_changed = true;
       }
     }
@@ -181,29 +929,21 @@ private:
     {
       if (GetMouse(0).bPressed)
       {
-        // Select a node but only if none have already been selected
+        // Select a node but only if none have already been selected, otherwise the line under the mouse (if any)
         if (selected_node == 0)
         {
-          bool ANodeHasBeenSelected = false;
-
-          for (const auto& node : nodes)
-          {
-            if (not is_mouse_in_circle(node.second)) continue;
-
-            selected_node = node.first;
-            ANodeHasBeenSelected = true;
-            break;
-          }
+          selected_node = node_under_mouse();
 
-          if (not ANodeHasBeenSelected) selected_node = 0;
+          // Clicks onto the UI (e.g. the line length arrows) keep the selected line
+          if (GetMouseY() > UI_section_height) selected_line = (selected_node == 0 ? line_under_mouse() : -1);
         }
         // Create a new line but only if that line doesn't exist yet
         else
         {
-          for (const auto& node : nodes)
-          {
-            if (not is_mouse_in_circle(node.second)) continue;
+          int target = node_under_mouse();
 
+          if (target != 0)
+          {
             // TODO: I don't like the fact that we need to create a bool here; try implementing without it
             // ~ But then again, we do do that when painting the arrow heads
             bool line_exists_already = false;
@@ -212,7 +952,7 @@ private:
             for (const auto& aLine : lines)
             {
               // Ignore the line if it already exists
-              if ((aLine.from == node.first and aLine.to == selected_node) or (aLine.from == selected_node and aLine.to == node.first))
+              if ((aLine.from == target and aLine.to == selected_node) or (aLine.from == selected_node and aLine.to == target))
               {
                 line_exists_already = true;
                 break;
@@ -221,7 +961,9 @@ private:
 
             if (not line_exists_already)
             {
-              lines.push_back(line(selected_node, node.first, line_length));
+              lines.push_back(line(selected_node, target, line_length));
+              record({edit_journal::ADD_LINE, selected_node, target, line_length});
+              line_tree.invalidate();
               graph_has_changed = true;
             }
           }
@@ -232,22 +974,24 @@ private:
       // Delete a line with right click
       else if (GetMouse(1).bPressed)
       {
-        // Only delete a line if a node has been selected
-        if (selected_node != 0)
+        // Either the selected line
+        if (selected_line != -1) delete_selected_line();
+        // Or the line between the selected node and the one under the mouse
+        else if (selected_node != 0)
         {
-          for (const auto& node : nodes)
-          {
-            if (not is_mouse_in_circle(node.second)) continue;
+          int target = node_under_mouse();
 
-            // Using an iterator because it allows for element deletion
-            for (std::vector<line>::iterator line = lines.begin(); line < lines.end(); line++)
-            {
-              if (not (line->from == selected_node and line->to == node.first)) continue;
+          auto erased = std::erase_if(lines, [&](const line& line)
+          {
+            if (target == 0 or not (line.from == selected_node and line.to == target)) return false;
 
-              lines.erase(line);
-              line--;
-              graph_has_changed = true;
-            }
+            record({edit_journal::DELETE_LINE, line.from, line.to});
+            return true;
+          });
+          if (erased != 0)
+          {
+            line_tree.invalidate();
+            graph_has_changed = true;
           }
 
           selected_node = 0;
@@ -263,27 +1007,25 @@ private:
         decrement_line_length();
       }
 
-      // If user presses delete or backspace they delete all lines
-      if (GetKey(olc::BACK).bPressed or GetKey(olc::DEL).bPressed) lines.clear();
+      // If user presses delete or backspace they delete the selected line, or all lines if none is selected
+      if (GetKey(olc::BACK).bPressed or GetKey(olc::DEL).bPressed)
+      {
+        if (selected_line != -1) delete_selected_line();
+        else
+        {
+          record({edit_journal::CLEAR_LINES});
+          lines.clear();
+          line_tree.invalidate();
+          graph_has_changed = true;
+        }
+      }
     }
     else if (mode == PATH)
     {
       // Select a node to be the start
       if (GetMouse(0).bPressed and GetMouseY() > UI_section_height)
       {
-        bool new_node_has_been_selected = false;
-
-        for (const auto& node : nodes)
-        {
-          if (is_mouse_in_circle(node.second))
-          {
-            start = node.first;
-            new_node_has_been_selected = true;
-            break;
-          }
-        }
-
-        if (not new_node_has_been_selected) start = 0;
+        start = node_under_mouse();
 
         graph_has_changed = true;
       }
@@ -291,19 +1033,7 @@ private:
       // Select a node to be the end
       if (GetMouse(1).bPressed and GetMouseY() > UI_section_height)
       {
-        bool new_node_has_been_selected = false;
-
-        for (const auto& node : nodes)
-        {
-          if (is_mouse_in_circle(node.second))
-          {
-            end = node.first;
-            new_node_has_been_selected = true;
-            break;
-          }
-        }
-
-        if (not new_node_has_been_selected) end = 0;
+        end = node_under_mouse();
 
         graph_has_changed = true;
       }
@@ -323,6 +1053,45 @@ private:
     }
   }
 
+  // A mapped graph can't be edited: MOVE mode drags the view around and PATH mode finds paths, the other modes fall back to
+  // MOVE
+  void handle_mapped_input()
+  {
+    if (mode == NODE or mode == LINE) mode = MOVE;
+
+    if (mode == MOVE)
+    {
+      if (GetMouse(0).bPressed and GetMouseY() > UI_section_height) panning_button = 0;
+      return;
+    }
+
+    // Picking another start or end drops the search for the old ones
+    if (GetMouse(0).bPressed and GetMouseY() > UI_section_height)
+    {
+      searcher.stop();
+      start = mapped_node_under_mouse();
+      graph_has_changed = true;
+    }
+    if (GetMouse(1).bPressed and GetMouseY() > UI_section_height)
+    {
+      searcher.stop();
+      end = mapped_node_under_mouse();
+      graph_has_changed = true;
+    }
+
+    if (GetKey(olc::ENTER).bPressed and start != 0 and end != 0)
+    {
+      searcher.start(mapped, uint32_t(mapped.index_of(start)), uint32_t(mapped.index_of(end)));
+    }
+
+    if (GetKey(olc::BACK).bPressed or GetKey(olc::DEL).bPressed)
+    {
+      searcher.stop();
+      start = 0;
+      end = 0;
+    }
+  }
+
   void reset_graph()
   {
     path.clear();
@@ -347,10 +1116,22 @@ private:
 
       if (selected_node == 0)
       {
-        DrawStringProp({10, 29}, "Left Mouse: hold to move a node around", olc::GREY, 2);
+        DrawStringProp({10, 29}, (selected_nodes.empty() ? "Left Mouse: hold to move a node around" : "Left Mouse: hold to move the selected nodes"), olc::GREY, 2);
         DrawStringProp({10, 29}, "Left Mouse:", olc::MAGENTA, 2);
       }
-      else DrawStringProp({10, 29}, "Release to place node", olc::GREY, 2);
+      else DrawStringProp({10, 29}, (is_node_selected(selected_node) ? "Release to place nodes" : "Release to place node"), olc::GREY, 2);
+
+      DrawStringProp({10, 48}, "Shift + Left Mouse: box select, Ctrl + Left Mouse: lasso select", olc::GREY, 2);
+      DrawStringProp({10, 48}, "Shift + Left Mouse", olc::MAGENTA, 2);
+      DrawStringProp({390, 48}, "Ctrl + Left Mouse", olc::MAGENTA, 2);
+
+      if (not selected_nodes.empty())
+      {
+        DrawStringProp({10, 67}, "Backspace/Delete: delete the selected nodes", olc::GREY, 2);
+        DrawStringProp({10, 67}, "Backspace", olc::MAGENTA, 2);
+        DrawStringProp({158, 67}, "Delete", olc::MAGENTA, 2);
+        DrawStringProp({1080, 29}, "Selected: " + std::to_string(selected_nodes.size()), olc::GREY, 2);
+      }
     }
     // UI for NODE
     else if (mode == NODE)
@@ -372,9 +1153,16 @@ private:
       DrawString({187, 10}, "[ ]", olc::WHITE, 2);
       DrawStringProp({285, 10}, "- Line", olc::GREY, 2);
 
-      if (selected_node == 0)
+      if (selected_line != -1)
+      {
+        DrawStringProp({10, 29}, "Left Mouse: select a node or another line", olc::GREY, 2);
+        DrawStringProp({10, 29}, "Left Mouse:", olc::MAGENTA, 2);
+        DrawStringProp({10, 48}, "Right Mouse: delete the selected line", olc::GREY, 2);
+        DrawStringProp({10, 48}, "Right Mouse", olc::MAGENTA, 2);
+      }
+      else if (selected_node == 0)
       {
-        DrawStringProp({10, 29}, "Left Mouse: select a node", olc::GREY, 2);
+        DrawStringProp({10, 29}, "Left Mouse: select a node or a line", olc::GREY, 2);
         DrawStringProp({10, 29}, "Left Mouse:", olc::MAGENTA, 2);
       }
       else
@@ -385,14 +1173,16 @@ private:
         DrawStringProp({10, 48}, "Right Mouse", olc::MAGENTA, 2);
       }
 
-      DrawStringProp({10, 67}, "Backspace/Delete: delete all lines", olc::GREY, 2);
+      DrawStringProp({10, 67}, (selected_line != -1 ? "Backspace/Delete: delete the selected line" : "Backspace/Delete: delete all lines"), olc::GREY, 2);
       DrawStringProp({10, 67}, "Backspace", olc::MAGENTA, 2);
       DrawStringProp({158, 67}, "Delete", olc::MAGENTA, 2);
 
       int distance = 450;
       // Adjust line length
       DrawStringProp({460, 67}, "Line length:", olc::GREY, 2);
-      DrawString({600, 67}, "<" + (line_length < 10 ? '0' + std::to_string(line_length) : std::to_string(line_length)) + ">", olc::GREY, 2);
+      // Shows (and edits) the length of the selected line if there is one
+      int shown_length = (selected_line != -1 ? lines[selected_line].length : line_length);
+      DrawString({600, 67}, "<" + (shown_length < 10 ? '0' + std::to_string(shown_length) : std::to_string(shown_length)) + ">", olc::GREY, 2);
       DrawString({600, 67}, "<", olc::MAGENTA, 2);
       DrawString({648, 67}, ">", olc::MAGENTA, 2);
 
@@ -463,6 +1253,59 @@ private:
       DrawStringProp({590, 29}, "Enter", olc::MAGENTA, 2);
     }
 
+    // Camera controls and zoom level, the same in every mode
+    DrawStringProp({430, 10}, "Wheel: zoom, Middle Mouse: pan, Home: reset view", olc::GREY, 2);
+    DrawStringProp({430, 10}, "Wheel", olc::MAGENTA, 2);
+    DrawStringProp({582, 10}, "Middle Mouse", olc::MAGENTA, 2);
+    DrawStringProp({804, 10}, "Home", olc::MAGENTA, 2);
+    DrawStringProp({1080, 10}, "Zoom: " + std::to_string(int(std::round(view.zoom * 100.0f))) + "%", olc::GREY, 2);
+    // How much of the edge list has been read
+    if (importer.is_running())
+    {
+      DrawStringProp({1080, 67}, "Import", olc::GREY, 2);
+      DrawRect(1174, 68, 92, 13, olc::GREY);
+      FillRect(1176, 70, int(89.0f * importer.progress()), 10, olc::MAGENTA);
+    }
+    // A mapped graph can't be laid out
+    else if (mapped.is_open()) DrawStringProp({1080, 67}, (searcher.is_running() ? "Searching path" : "Mapped graph"), olc::GREY, 2);
+    // A multilevel layout can be stopped on any level, the nodes are shown where their coarser versions are until then
+    else if (stress.is_running())
+    {
+      DrawStringProp({1080, 67}, "S: stop layout", olc::GREY, 2);
+      DrawStringProp({1080, 67}, "S", olc::MAGENTA, 2);
+    }
+    else if (layers.is_running())
+    {
+      DrawStringProp({1080, 67}, "H: stop layout", olc::GREY, 2);
+      DrawStringProp({1080, 67}, "H", olc::MAGENTA, 2);
+    }
+    else if (spectral.is_running())
+    {
+      DrawStringProp({1080, 67}, "E: stop layout", olc::GREY, 2);
+      DrawStringProp({1080, 67}, "E", olc::MAGENTA, 2);
+    }
+    else if (layout.is_running())
+    {
+      if (layout.current_level() > 0) DrawStringProp({1080, 67}, "F: stop, level " + std::to_string(layout.current_level()), olc::GREY, 2);
+      else DrawStringProp({1080, 67}, "F: stop layout", olc::GREY, 2);
+      DrawStringProp({1080, 67}, "F", olc::MAGENTA, 2);
+    }
+    // F lays the graph out by forces, S by the line lengths, H in layers, E by eigenvectors
+    else
+    {
+      DrawStringProp({1080, 67}, "F S H E: layout", olc::GREY, 2);
+      DrawStringProp({1080, 67}, "F", olc::MAGENTA, 2);
+      DrawStringProp({1102, 67}, "S", olc::MAGENTA, 2);
+      DrawStringProp({1124, 67}, "H", olc::MAGENTA, 2);
+      DrawStringProp({1146, 67}, "E", olc::MAGENTA, 2);
+    }
+    switch (current_detail_level())
+    {
+      case FULL_DETAIL: DrawStringProp({1080, 48}, "Detail: full", olc::GREY, 2); break;
+      case REDUCED_DETAIL: DrawStringProp({1080, 48}, "Detail: reduced", olc::GREY, 2); break;
+      case MINIMAL_DETAIL: DrawStringProp({1080, 48}, "Detail: minimal", olc::GREY, 2); break;
+    }
+
     // Hover on 'M'
     if (mode != MOVE and is_mouse_in_rect({103, 7}, {18, 19}))
     {
@@ -489,145 +1332,356 @@ private:
     }
   }
 
-  void paint_lines()
+  template<typename canvas_type>
+  void paint_lines(const paint_target<canvas_type>& target)
   {
-    for (const auto& line : lines)
+    float screen_radius = float(radius) * target.view.zoom;
+    detail_level detail_level = detail_level_at(target.view.zoom);
+
+    // Only the lines whose bounds reach into the screen (grown by the margin below) are looked at, painted in their order.
+    // Without a line tree, which isn't rebuilt while a layout moves everything every frame, all of them are.
+    std::vector<int> candidates = {};
+    if (line_tree.is_built())
+    {
+      olc::vf2d margin = olc::vf2d(25.0f, 25.0f) / target.view.zoom;
+      line_tree.for_each_in_rect(target.view.offset - margin, target.view.offset + olc::vf2d(target.size) / target.view.zoom + margin, [&](int i) { candidates.push_back(i); });
+      std::sort(candidates.begin(), candidates.end());
+    }
+    else
+    {
+      candidates.resize(lines.size());
+      std::iota(candidates.begin(), candidates.end(), 0);
+    }
+
+    for (int i : candidates)
     {
+      const line& line = lines[i];
+      // Only looked up (at() rather than []), exported images are painted from several threads at once
+      olc::vi2d from = target.view.world_to_screen(nodes.at(line.from));
+      olc::vi2d to = target.view.world_to_screen(nodes.at(line.to));
+
+      // Lines which are nowhere near the screen aren't painted at all (the margin leaves room for the distance label)
+      if (not target.contains(from.min(to), from.max(to), 24)) continue;
+
+      // The selected line stands out in the same colour as a selected node
+      olc::Pixel colour = (target.interactive and i == selected_line ? olc::MAGENTA : olc::CYAN);
+
       // Paints the lines
-      DrawLine(nodes[line.from].x, nodes[line.from].y, nodes[line.to].x, nodes[line.to].y, olc::CYAN);
+      target.canvas.draw_line(from, to, colour);
+
+      if (detail_level != FULL_DETAIL) continue;
 
       // Paints the little triangles to indicate line direction
 
       // Distance between source and target (also indicates direcion by sign (+/-))
-      olc::vf2d direction = nodes[line.from] - nodes[line.to];
-
-      // Calculating the tip of the triangle that touches the node (position + (direction * (radius / length)))
-      olc::vi2d one = nodes[line.to] + (direction * (radius / direction.mag()));
-
-      // This is the point further down the line (literally)
-      olc::vi2d two = nodes[line.to] + (direction * ((radius + 15) / direction.mag()));
-
-      // These are the positions to the left/right of the line, forming a complete triangle
-      /* x1/y1 are the start of the line, x2/y2 are the end of the line where the head of the arrow should be
-        L1 is the length from x1/y1 to x2/y2
-        L2 is the length of the arrow head
-        a is the angle
-
-        Formula:
-        x3 = x2 + L2/L1 * [(x1 - x2) * cos(a) + (y1 - y2) * sin(a)]
-        y3 = y2 + L2/L1 * [(y1 - y2) * cos(a) - (x1 - x2) * sin(a)]
-        x4 = x2 + L2/L1 * [(x1 - x2) * cos(a) - (y1 - y2) * sin(a)]
-        x4 = x2 + L2/L1 * [(y1 - y2) * cos(a) + (x1 - x2) * sin(a)]
-
-        Source: https://math.stackexchange.com/questions/1314006/drawing-an-arrow */
-      // * The cast to int is only there to stop the compiler from complaining about narrowing conversion from float to int
-      olc::vi2d three = {
-        int(
-          float(one.x)
-          +
-          (
-            (arrow_head_length / direction.mag())
-            *
+      olc::vf2d direction = from - to;
+
+      // When zoomed far out both ends can land on the same pixel, which leaves no direction to point the arrow in
+      if (direction.mag() >= 1.0f)
+      {
+        // Calculating the tip of the triangle that touches the node (position + (direction * (radius / length)))
+        olc::vi2d one = to + (direction * (screen_radius / direction.mag()));
+
+        // This is the point further down the line (literally)
+        olc::vi2d two = to + (direction * ((screen_radius + 15.0f * target.view.zoom) / direction.mag()));
+
+        // These are the positions to the left/right of the line, forming a complete triangle
+        /* x1/y1 are the start of the line, x2/y2 are the end of the line where the head of the arrow should be
+          L1 is the length from x1/y1 to x2/y2
+          L2 is the length of the arrow head
+          a is the angle
+
+          Formula:
+          x3 = x2 + L2/L1 * [(x1 - x2) * cos(a) + (y1 - y2) * sin(a)]
+          y3 = y2 + L2/L1 * [(y1 - y2) * cos(a) - (x1 - x2) * sin(a)]
+          x4 = x2 + L2/L1 * [(x1 - x2) * cos(a) - (y1 - y2) * sin(a)]
+          x4 = x2 + L2/L1 * [(y1 - y2) * cos(a) + (x1 - x2) * sin(a)]
+
+          Source: https://math.stackexchange.com/questions/1314006/drawing-an-arrow */
+        // * The cast to int is only there to stop the compiler from complaining about narrowing conversion from float to int
+        float screen_arrow_head_length = arrow_head_length * target.view.zoom;
+        olc::vi2d three = {
+          int(
+            float(one.x)
+            +
             (
-              float(nodes[line.from].x - nodes[line.to].x) * cos(arrow_head_angle)
-              +
-              float(nodes[line.from].y - nodes[line.to].y) * sin(arrow_head_angle)
+              (screen_arrow_head_length / direction.mag())
+              *
+              (
+                float(from.x - to.x) * cos(arrow_head_angle)
+                +
+                float(from.y - to.y) * sin(arrow_head_angle)
+              )
             )
-          )
-        ),
-        int(
-          float(one.y)
-          +
-          (
-            (arrow_head_length / direction.mag())
-            *
+          ),
+          int(
+            float(one.y)
+            +
             (
-              float(nodes[line.from].y - nodes[line.to].y) * cos(arrow_head_angle)
-              -
-              float(nodes[line.from].x - nodes[line.to].x) * sin(arrow_head_angle)
+              (screen_arrow_head_length / direction.mag())
+              *
+              (
+                float(from.y - to.y) * cos(arrow_head_angle)
+                -
+                float(from.x - to.x) * sin(arrow_head_angle)
+              )
             )
           )
-        )
-      };
-      olc::vi2d four = {
-        int(
-          float(one.x)
-          +
-          (
-            (arrow_head_length / direction.mag())
-            *
+        };
+        olc::vi2d four = {
+          int(
+            float(one.x)
+            +
             (
-              float(nodes[line.from].x - nodes[line.to].x) * cos(arrow_head_angle)
-              -
-              float(nodes[line.from].y - nodes[line.to].y) * sin(arrow_head_angle)
+              (screen_arrow_head_length / direction.mag())
+              *
+              (
+                float(from.x - to.x) * cos(arrow_head_angle)
+                -
+                float(from.y - to.y) * sin(arrow_head_angle)
+              )
             )
-          )
-        ),
-        int(
-          float(one.y)
-          +
-          (
-            (arrow_head_length / direction.mag())
-            *
+          ),
+          int(
+            float(one.y)
+            +
             (
-              float(nodes[line.from].y - nodes[line.to].y) * cos(arrow_head_angle)
-              +
-              float(nodes[line.from].x - nodes[line.to].x) * sin(arrow_head_angle)
+              (screen_arrow_head_length / direction.mag())
+              *
+              (
+                float(from.y - to.y) * cos(arrow_head_angle)
+                +
+                float(from.x - to.x) * sin(arrow_head_angle)
+              )
             )
           )
-        )
-      };
+        };
 
-      FillTriangle(one, two, three, olc::CYAN);
-      FillTriangle(one, two, four, olc::CYAN);
+        target.canvas.fill_triangle(one, two, three, colour);
+        target.canvas.fill_triangle(one, two, four, colour);
+      }
 
       // Paints the distance onto the middle of the line
-      DrawStringProp((nodes[line.from].x + nodes[line.to].x) / 2 - 8, (nodes[line.from].y + nodes[line.to].y) / 2 - 8, std::to_string(line.length), olc::WHITE, 2);
+      target.canvas.draw_string_prop((from.x + to.x) / 2 - 8, (from.y + to.y) / 2 - 8, std::to_string(line.length), olc::WHITE, 2);
     }
   }
 
-  void paint_nodes()
+  template<typename canvas_type>
+  void paint_nodes(const paint_target<canvas_type>& target)
   {
-    int hovered_node = 0;
-
-    for (const auto& node : nodes)
+    // A node gets an outline on hover execpt in NODE mode
+    int hovered_node = (target.interactive and mode != NODE ? node_under_mouse() : 0);
+    int screen_radius = int(float(radius) * target.view.zoom);
+    detail_level detail_level = detail_level_at(target.view.zoom);
+
+    // Only the nodes in and around the screen are looked at, in the order of their IDs like the map has them
+    std::vector<std::pair<int, olc::vi2d>> candidates = {};
+    olc::vf2d margin = olc::vf2d(float(screen_radius + 7), float(screen_radius + 7)) / target.view.zoom;
+    olc::vf2d top_left = target.view.offset - margin;
+    olc::vf2d bottom_right = target.view.offset + olc::vf2d(target.size) / target.view.zoom + margin;
+    node_grid.for_each_in_rect(olc::vi2d(int(std::floor(top_left.x)), int(std::floor(top_left.y))), olc::vi2d(int(std::ceil(bottom_right.x)), int(std::ceil(bottom_right.y))), [&](int id, const olc::vi2d& position) { candidates.push_back({id, position}); });
+    std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    for (const auto& node : candidates)
     {
-      // Node color changes if it is the selected node that is being moved around
-      FillCircle(node.second.x, node.second.y, radius, (node.first == selected_node ? olc::MAGENTA : olc::Pixel(255, 128, 0)));
-      // Draws the number
-      DrawStringProp((node.first < 10 ? olc::vi2d{node.second.x - 3, node.second.y - 3} : olc::vi2d{node.second.x - 7, node.second.y - 3}), std::to_string(node.first), olc::BLACK, 1);
+      olc::vi2d position = target.view.world_to_screen(node.second);
+
+      // Nodes outside of the screen are skipped (but can't be hovered anyway)
+      if (not target.contains(position, position, screen_radius + 6)) continue;
 
-      // A node gets an outline on hover execpt in NODE mode
-      if (mode != NODE and is_mouse_in_circle(node.second)) hovered_node = node.first;
+      // Node color changes if it is the selected node that is being moved around or part of the selection
+      olc::Pixel colour = (target.interactive and (node.first == selected_node or is_node_selected(node.first)) ? olc::MAGENTA : olc::Pixel(255, 128, 0));
+
+      if (detail_level == MINIMAL_DETAIL)
+      {
+        target.canvas.draw(position.x, position.y, colour);
+        continue;
+      }
+
+      target.canvas.fill_circle(position.x, position.y, screen_radius, colour);
+
+      if (detail_level != FULL_DETAIL) continue;
+
+      // Draws the number
+      target.canvas.draw_string_prop((node.first < 10 ? olc::vi2d{position.x - 3, position.y - 3} : olc::vi2d{position.x - 7, position.y - 3}), std::to_string(node.first), olc::BLACK, 1);
     }
 
     if (hovered_node != 0)
     {
-      DrawCircle(nodes[hovered_node].x, nodes[hovered_node].y, radius + 4, olc::BLACK);
-      DrawCircle(nodes[hovered_node].x, nodes[hovered_node].y, radius + 5, olc::MAGENTA);
-      DrawCircle(nodes[hovered_node].x, nodes[hovered_node].y, radius + 6, olc::BLACK);
+      olc::vi2d position = target.view.world_to_screen(nodes[hovered_node]);
+      target.canvas.draw_circle(position.x, position.y, screen_radius + 4, olc::BLACK);
+      target.canvas.draw_circle(position.x, position.y, screen_radius + 5, olc::MAGENTA);
+      target.canvas.draw_circle(position.x, position.y, screen_radius + 6, olc::BLACK);
+    }
+  }
+
+  // The outline of the box/lasso while it is being drawn
+  void paint_selection()
+  {
+    if (selecting == BOX_SELECTION)
+    {
+      olc::vi2d corner1 = view.world_to_screen(selection_outline.front());
+      olc::vi2d corner2 = view.world_to_screen(selection_outline.back());
+      canvas.draw_line(corner1, {corner2.x, corner1.y}, olc::WHITE);
+      canvas.draw_line({corner2.x, corner1.y}, corner2, olc::WHITE);
+      canvas.draw_line(corner2, {corner1.x, corner2.y}, olc::WHITE);
+      canvas.draw_line({corner1.x, corner2.y}, corner1, olc::WHITE);
+    }
+    else if (selecting == LASSO_SELECTION)
+    {
+      // Closed from the last point back to the first, since that's what the selection is going to be
+      for (size_t i = 0; i < selection_outline.size(); i++)
+      {
+        const olc::vi2d& next = selection_outline[(i + 1) % selection_outline.size()];
+        canvas.draw_line(view.world_to_screen(selection_outline[i]), view.world_to_screen(next), olc::WHITE);
+      }
     }
   }
 
   void paint_start_and_end()
   {
+    // The labels sit just above the node, however big it is on screen
+    int lift = int(float(radius) * view.zoom) - radius;
+
     // Draws start
     if (start != 0)
     {
-      FillRect(nodes[start].x - 38, nodes[start].y - 28, 74, 16, olc::BLACK);
-      DrawStringProp(nodes[start].x - 37, nodes[start].y - 27, "Start", olc::GREEN, 2);
+      olc::vi2d position = view.world_to_screen(position_of(start));
+      canvas.fill_rect(position.x - 38, position.y - 28 - lift, 74, 16, olc::BLACK);
+      canvas.draw_string_prop(position.x - 37, position.y - 27 - lift, "Start", olc::GREEN, 2);
     }
 
     // Draws end
     if (end != 0)
     {
-      FillRect(nodes[end].x - 23, nodes[end].y - 28, 44, 16, olc::BLACK);
-      DrawStringProp(nodes[end].x - 22, nodes[end].y - 27, "End", olc::GREEN, 2);
+      olc::vi2d position = view.world_to_screen(position_of(end));
+      canvas.fill_rect(position.x - 23, position.y - 28 - lift, 44, 16, olc::BLACK);
+      canvas.draw_string_prop(position.x - 22, position.y - 27 - lift, "End", olc::GREEN, 2);
     }
   }
 
   void paint_path()
   {
+    for (size_t i = 1; i < path.size(); i++) canvas.draw_line(view.world_to_screen(position_of(path[i - 1])), view.world_to_screen(position_of(path[i])), olc::MAGENTA);
+  }
+
+  // The tiles of the mapped graph (the corners of a rectangle of them, clamped to its grid) with nodes which can show up
+  // on the target, and how many nodes they hold between them; only the table of tiles is read for that
+  void mapped_tiles_in_view(const paint_target<tiled_canvas>& target, olc::vi2d& first, olc::vi2d& last, uint64_t& node_count)
+  {
+    olc::vi2d margin = {2 * radius, 2 * radius};
+    first = mapped.tile_of(target.view.screen_to_world({0, 0}) - margin).max({0, 0});
+    last = mapped.tile_of(target.view.screen_to_world(target.size) + margin).min({mapped.columns() - 1, mapped.rows() - 1});
+
+    node_count = 0;
+    for (int row = first.y; row <= last.y; row++)
+      for (int column = first.x; column <= last.x; column++) node_count += mapped.tile(column, row).count;
+  }
+
+  // The lines of the mapped graph, as plain lines, from the nodes in view. Those between two nodes in view are painted once,
+  // from the node they go out of; lines crossing the view with both ends outside of it are left out.
+  void paint_mapped_lines(const paint_target<tiled_canvas>& target)
+  {
+    olc::vi2d first;
+    olc::vi2d last;
+    uint64_t node_count = 0;
+    mapped_tiles_in_view(target, first, last, node_count);
+    if (node_count > uint64_t(mapped_node_budget)) return;
+
+    // Reading ahead a tile further all around, so the tiles panned into next are in memory already
+    if (first != prefetched_first or last != prefetched_last)
+    {
+      mapped.prefetch(first - olc::vi2d{1, 1}, last + olc::vi2d{1, 1});
+      prefetched_first = first;
+      prefetched_last = last;
+    }
+
+    auto is_in_view = [&](const olc::vi2d& tile) { return tile.x >= first.x and tile.y >= first.y and tile.x <= last.x and tile.y <= last.y; };
+    for (int row = first.y; row <= last.y; row++)
+      for (int column = first.x; column <= last.x; column++)
+      {
+        mapped_graph::tile_range range = mapped.tile(column, row);
+        for (uint64_t i = range.first; i < range.first + range.count; i++)
+        {
+          olc::vi2d from = mapped.position(uint32_t(i));
+          mapped.for_each_neighbour(uint32_t(i), [&](uint32_t neighbour, int, bool is_outgoing)
+          {
+            olc::vi2d to = mapped.position(neighbour);
+            if (not is_outgoing and is_in_view(mapped.tile_of(to))) return;
+            target.canvas.draw_line(target.view.world_to_screen(from), target.view.world_to_screen(to), olc::CYAN);
+          });
+        }
+      }
+  }
+
+  // The nodes of the mapped graph in view, or the tiles in view shaded by how many nodes they hold if there are too many
+  void paint_mapped_nodes(const paint_target<tiled_canvas>& target)
+  {
+    olc::vi2d first;
+    olc::vi2d last;
+    uint64_t node_count = 0;
+    mapped_tiles_in_view(target, first, last, node_count);
+
+    if (node_count > uint64_t(mapped_node_budget))
+    {
+      uint64_t fullest = 1;
+      for (int row = first.y; row <= last.y; row++)
+        for (int column = first.x; column <= last.x; column++) fullest = std::max(fullest, mapped.tile(column, row).count);
+
+      for (int row = first.y; row <= last.y; row++)
+        for (int column = first.x; column <= last.x; column++)
+        {
+          uint64_t count = mapped.tile(column, row).count;
+          if (count == 0) continue;
+
+          olc::vi2d top_left = target.view.world_to_screen(mapped.origin() + olc::vi2d{column, row} * mapped.tile_size());
+          olc::vi2d bottom_right = target.view.world_to_screen(mapped.origin() + olc::vi2d{column + 1, row + 1} * mapped.tile_size());
+          float share = float(count) / float(fullest);
+          olc::Pixel colour = olc::Pixel(uint8_t(255.0f * share), uint8_t(128.0f * share), 0);
+          target.canvas.fill_rect(top_left.x, top_left.y, std::max(1, bottom_right.x - top_left.x), std::max(1, bottom_right.y - top_left.y), colour);
+        }
+      return;
+    }
+
+    int screen_radius = int(float(radius) * target.view.zoom);
+    detail_level detail_level = detail_level_at(target.view.zoom);
+    for (int row = first.y; row <= last.y; row++)
+      for (int column = first.x; column <= last.x; column++)
+      {
+        mapped_graph::tile_range range = mapped.tile(column, row);
+        for (uint64_t i = range.first; i < range.first + range.count; i++)
+        {
+          olc::vi2d position = target.view.world_to_screen(mapped.position(uint32_t(i)));
+          if (not target.contains(position, position, screen_radius)) continue;
+
+          if (detail_level == MINIMAL_DETAIL)
+          {
+            target.canvas.draw(position.x, position.y, olc::Pixel(255, 128, 0));
+            continue;
+          }
+
+          target.canvas.fill_circle(position.x, position.y, screen_radius, olc::Pixel(255, 128, 0));
+
+          if (detail_level != FULL_DETAIL) continue;
+
+          int id = mapped.id(uint32_t(i));
+          target.canvas.draw_string_prop((id < 10 ? olc::vi2d{position.x - 3, position.y - 3} : olc::vi2d{position.x - 7, position.y - 3}), std::to_string(id), olc::BLACK, 1);
+        }
+      }
+  }
+
+  // Where the node with the ID is, in the mapped graph while one is open
+  olc::vi2d position_of(int id)
+  {
+    if (mapped.is_open()) return mapped.position(uint32_t(mapped.index_of(id)));
+    return nodes[id];
+  }
+
+  // The node of the mapped graph under the mouse (the one closest to it should they overlap), 0 if there is none
+  int mapped_node_under_mouse()
+  {
+    int64_t index = mapped.nearest_within(mouse_world_position(), radius * radius - 1);
+    return (index == -1 ? 0 : mapped.id(uint32_t(index)));
   }
 
   // Finds the smallest missing number in this sequence of numbers (node IDs) otherwise a new ID is created
@@ -646,32 +1700,197 @@ private:
     return nodes.size() + 1;
   }
 
+  // Both change the length of the selected line if there is one, otherwise the length new lines get. A line already at
+  // the longest or shortest length is left alone, which isn't an edit.
   void increment_line_length()
   {
-    if (line_length < 99) line_length++;
+    int& length = (selected_line != -1 ? lines[selected_line].length : line_length);
+    if (length >= 99) return;
+    length++;
+    if (selected_line != -1) journal_line_length();
   }
 
   void decrement_line_length()
   {
-    if (line_length > 1) line_length--;
+    int& length = (selected_line != -1 ? lines[selected_line].length : line_length);
+    if (length <= 1) return;
+    length--;
+    if (selected_line != -1) journal_line_length();
+  }
+
+  void journal_line_length()
+  {
+    const line& line = lines[selected_line];
+    record({edit_journal::SET_LINE_LENGTH, line.from, line.to, line.length});
+    graph_has_changed = true;
+  }
+
+  bool is_node_selected(const int& id)
+  {
+    return std::binary_search(selected_nodes.begin(), selected_nodes.end(), id);
+  }
+
+  // Selects every node within the box/lasso, the grid narrows that down to the nodes within the bounds of the outline
+  void select_outlined_nodes()
+  {
+    olc::vi2d top_left = selection_outline.front();
+    olc::vi2d bottom_right = selection_outline.front();
+    for (const auto& point : selection_outline)
+    {
+      top_left = top_left.min(point);
+      bottom_right = bottom_right.max(point);
+    }
+
+    selected_nodes.clear();
+    node_grid.for_each_in_rect(top_left, bottom_right, [&](int id, const olc::vi2d& position)
+    {
+      if (selecting == BOX_SELECTION or is_inside_lasso(position)) selected_nodes.push_back(id);
+    });
+    std::sort(selected_nodes.begin(), selected_nodes.end());
+
+    selecting = NO_SELECTION;
+    selection_outline.clear();
+  }
+
+  // Even-odd rule: the point is inside if a ray going right from it crosses the edges of the lasso an odd number of times
+  bool is_inside_lasso(const olc::vi2d& point)
+  {
+    bool inside = false;
+
+    for (size_t i = 0, j = selection_outline.size() - 1; i < selection_outline.size(); j = i++)
+    {
+      const olc::vi2d& a = selection_outline[i];
+      const olc::vi2d& b = selection_outline[j];
+      if ((a.y > point.y) == (b.y > point.y)) continue;
+
+      // Whether the point lies left of where the edge crosses its row, multiplied out to stay in integers
+      int64_t left = int64_t(point.x - a.x) * (b.y - a.y);
+      int64_t right = int64_t(point.y - a.y) * (b.x - a.x);
+      if (b.y > a.y ? left < right : left > right) inside = not inside;
+    }
+
+    return inside;
+  }
+
+  // Moves the nodes by the same amount, keeping the grid and the line tree in sync
+  void move_nodes(const std::vector<int>& ids, const olc::vi2d& delta)
+  {
+    if (delta == olc::vi2d{0, 0}) return;
+
+    for (const int& id : ids)
+    {
+      olc::vi2d& position = nodes[id];
+      node_grid.move(id, position, position + delta);
+      position += delta;
+      autosaver.moved(id, position);
+      dumper.moved(id, position);
+      line_tree.refit_node(id, nodes);
+    }
+    // Every step of a drag counts, not just where the nodes end up once they are let go of (which is what gets recorded)
+    graph_version++;
+    edit_version++;
+  }
+
+  // Deletes the nodes (IDs sorted) along with every line coming/going from/to them in a single pass over the lines
+  void delete_nodes(std::vector<int> ids)
+  {
+    auto is_deleted = [&](const int& id) { return std::binary_search(ids.begin(), ids.end(), id); };
+
+    std::erase_if(lines, [&](const line& line) { return is_deleted(line.from) or is_deleted(line.to); });
+
+    for (const int& id : ids)
+    {
+      auto node = nodes.find(id);
+      if (node == nodes.end()) continue;
+
+      node_grid.erase(id, node->second);
+      nodes.erase(node);
+    }
+
+    std::erase_if(selected_nodes, is_deleted);
+    if (is_deleted(start)) start = 0;
+    if (is_deleted(end)) end = 0;
+
+    line_tree.invalidate();
+    graph_has_changed = true;
+  }
+
+  void delete_selected_line()
+  {
+    record({edit_journal::DELETE_LINE, lines[selected_line].from, lines[selected_line].to});
+    lines.erase(lines.begin() + selected_line);
+    selected_line = -1;
+    line_tree.invalidate();
+    graph_has_changed = true;
+  }
+
+  // Squared distances in integers; no pow() and no floating point needed to compare against a squared radius
+  int64_t squared_distance(const int& x1, const int& y1, const int& x2, const int& y2)
+  {
+    int64_t dx = x1 - x2;
+    int64_t dy = y1 - y2;
+    return dx * dx + dy * dy;
   }
 
   bool do_circles_overlap(const olc::vi2d& circle1, const olc::vi2d& circle2)
   {
-    return fabs(pow((circle1.x - circle2.x), 2) + pow((circle1.y - circle2.y), 2)) <= pow(2 * radius, 2);
+    return squared_distance(circle1.x, circle1.y, circle2.x, circle2.y) <= int64_t(4) * radius * radius;
   }
   bool do_circles_overlap(const int& x1, const int& y1, const int& x2, const int& y2)
   {
-    return fabs(pow((x1 - x2), 2) + pow((y1 - y2), 2)) <= pow(2 * radius, 2);
+    return squared_distance(x1, y1, x2, y2) <= int64_t(4) * radius * radius;
+  }
+
+  // The node under the mouse (the one closest to it should they overlap), 0 if there is none
+  int node_under_mouse()
+  {
+    // Strictly inside of the circle, same as is_mouse_in_circle()
+    return node_grid.nearest_within(mouse_world_position(), radius * radius - 1);
+  }
+
+  // The node closest to the position which would overlap with a node placed there, 0 if there is none
+  int node_overlapping(const olc::vi2d& position)
+  {
+    // Same as do_circles_overlap()
+    return node_grid.nearest_within(position, 4 * radius * radius);
   }
 
+  // The line closest to the mouse within a few pixels on screen, -1 if there is none
+  int line_under_mouse()
+  {
+    if (not line_tree.is_built()) line_tree.build(lines, nodes);
+    return line_tree.nearest(olc::vf2d(mouse_world_position()), 6.0f / view.zoom);
+  }
+
+  // Circles are in world coordinates, so the mouse is too
   bool is_mouse_in_circle(const olc::vi2d& circle)
   {
-    return fabs(pow((circle.x - GetMouseX()), 2) + pow((circle.y - GetMouseY()), 2)) < pow(radius, 2);
+    olc::vi2d mouse = mouse_world_position();
+    return squared_distance(circle.x, circle.y, mouse.x, mouse.y) < int64_t(radius) * radius;
   }
   bool is_mouse_in_circle(const int& x, const int& y)
   {
-    return fabs(pow((x - GetMouseX()), 2) + pow((y - GetMouseY()), 2)) < pow(radius, 2);
+    olc::vi2d mouse = mouse_world_position();
+    return squared_distance(x, y, mouse.x, mouse.y) < int64_t(radius) * radius;
+  }
+
+  detail_level current_detail_level()
+  {
+    return detail_level_at(view.zoom);
+  }
+
+  detail_level detail_level_at(float zoom)
+  {
+    float screen_radius = float(radius) * zoom;
+
+    if (screen_radius < minimal_detail_radius) return MINIMAL_DETAIL;
+    if (screen_radius < reduced_detail_radius) return REDUCED_DETAIL;
+    return FULL_DETAIL;
+  }
+
+  olc::vi2d mouse_world_position()
+  {
+    return view.screen_to_world(GetMousePos());
   }
 
   bool is_mouse_in_rect(const olc::vi2d& position, const olc::vi2d& dimensions)
@@ -686,9 +1905,9 @@ private:
   }
 };
 
-int main()
+int main(int argc, char** argv)
 {
-  PGE_graph_visualiser instance;
+  PGE_graph_visualiser instance(argc > 1 ? argv[1] : "");
 
   if (instance.Construct(1'280, 820, 1, 1)) instance.Start();
 
@@ -0,0 +1,125 @@
+#include "autosave.h"
+#include "platform.h"
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+
+namespace
+{
+  // Directories are synced too, which makes a rename within them last
+  bool sync_to_disk(const std::string& path, std::string& error)
+  {
+    if (platform::sync_path(path)) return true;
+    error = std::strerror(errno);
+    return false;
+  }
+}
+
+autosave::~autosave()
+{
+  if (worker.joinable()) worker.join();
+}
+
+bool autosave::update(const std::map<int, olc::vi2d>& nodes, const std::vector<line>& lines, uint64_t version, uint64_t structure_version, const std::string& path)
+{
+  if (worker.joinable())
+  {
+    if (not done) return false;
+
+    worker.join();
+    if (not dropped)
+    {
+      // A failed save is tried again after the interval, not every frame
+      if (failure.empty()) saved_version = snapshot.version();
+      saved_at = std::chrono::steady_clock::now();
+      return true;
+    }
+  }
+
+  if (version == saved_version)
+  {
+    snapshot.release();
+    return false;
+  }
+
+  if (not snapshot.is_copying())
+  {
+    if (std::chrono::duration<float>(std::chrono::steady_clock::now() - saved_at).count() < interval) return false;
+    snapshot.start(nodes, lines, version, structure_version);
+  }
+  if (not snapshot.copy_some(nodes, lines, version, structure_version, copy_budget)) return false;
+
+  dropped = false;
+  done = false;
+  save_path = path;
+  worker = std::thread([this]()
+  {
+    write();
+    done = true;
+  });
+  return false;
+}
+
+void autosave::moved(int id, const olc::vi2d& to)
+{
+  // A snapshot being written belongs to the worker, and is of the graph as it was
+  if (not worker.joinable()) snapshot.moved(id, to);
+}
+
+void autosave::mark_saved(uint64_t version)
+{
+  saved_version = version;
+  saved_at = std::chrono::steady_clock::now();
+  if (worker.joinable()) dropped = true;
+  else snapshot.release();
+}
+
+bool autosave::is_saving() const
+{
+  return worker.joinable() and not dropped;
+}
+
+const std::string& autosave::error() const
+{
+  return failure;
+}
+
+size_t autosave::node_count() const
+{
+  return saved_nodes;
+}
+
+size_t autosave::line_count() const
+{
+  return saved_lines;
+}
+
+const std::string& autosave::path() const
+{
+  return save_path;
+}
+
+float autosave::milliseconds() const
+{
+  return computed_milliseconds;
+}
+
+void autosave::write()
+{
+  auto started = std::chrono::steady_clock::now();
+  failure.clear();
+  saved_nodes = snapshot.nodes().size();
+  saved_lines = snapshot.lines().size();
+
+  std::string temporary_path = save_path + ".tmp";
+  std::string directory = std::filesystem::path(save_path).parent_path().string();
+  if (graph_file::save(temporary_path, snapshot.nodes(), snapshot.lines(), failure) and sync_to_disk(temporary_path, failure))
+  {
+    if (not platform::replace_file(temporary_path, save_path)) failure = std::strerror(errno);
+    else sync_to_disk(directory.empty() ? "." : directory, failure);
+  }
+
+  // The snapshot can be as big as the graph, it isn't kept around until the next save
+  snapshot.release();
+  computed_milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - started).count();
+}
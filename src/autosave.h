@@ -0,0 +1,71 @@
+#pragma once
+
+#include "olcPixelGameEngine.h"
+#include "graph_snapshot.h"
+#include "line.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Saves the graph every so often without holding up the frames. Once the graph has changed (its version is not the saved
+// one) and the interval is over, a graph_snapshot of it is taken a little every frame, which makes starting a save cost the
+// same however big the graph is. Nodes moving in the meantime are handed on to it with moved(), so a save gets done while
+// a layout is running too.
+//
+// A complete snapshot is written to <path>.tmp on a background thread, synced to disk and then renamed over the path, so
+// the file at the path is always a whole save, the last one or the one before it.
+class autosave
+{
+public:
+  float interval = 60.0f; // Seconds from a save to the next one, if the graph has changed in between
+  float copy_budget = 0.5f; // Milliseconds per frame spent on taking the snapshot
+
+  ~autosave();
+
+  // Called once per frame with the graph at its current versions (see graph_snapshot). Returns true once a save is done,
+  // having written the graph to the path unless it failed (see error()).
+  bool update(const std::map<int, olc::vi2d>& nodes, const std::vector<line>& lines, uint64_t version, uint64_t structure_version, const std::string& path);
+
+  // Has to be called for every node moving
+  void moved(int id, const olc::vi2d& to);
+
+  // The graph at the version is in a file already (it was opened or saved), so there is nothing to save until it changes.
+  // A save under way is dropped: it is of an older graph.
+  void mark_saved(uint64_t version);
+
+  // Whether the snapshot is complete and being written
+  bool is_saving() const;
+
+  // As of the last save handed over by update(): what went wrong (empty if nothing did), how big the graph was, where it
+  // went and how long writing it took
+  const std::string& error() const;
+  size_t node_count() const;
+  size_t line_count() const;
+  const std::string& path() const;
+  float milliseconds() const;
+
+private:
+  uint64_t saved_version = 0;
+  std::chrono::steady_clock::time_point saved_at = std::chrono::steady_clock::now();
+
+  // Owned by the worker while a save is being written
+  graph_snapshot snapshot;
+
+  bool dropped = false; // Whether the result of the save being written is of no use anymore
+  std::thread worker;
+  std::atomic<bool> done = false;
+
+  // Everything below is owned by the worker too
+  std::string save_path = {};
+  std::string failure = {};
+  size_t saved_nodes = 0;
+  size_t saved_lines = 0;
+  float computed_milliseconds = 0.0f;
+
+  void write();
+};
@@ -0,0 +1,55 @@
+#include "buffered_writer.h"
+#include "platform.h"
+#include <cerrno>
+
+buffered_writer::~buffered_writer()
+{
+  if (descriptor != -1) platform::close_file(descriptor);
+}
+
+bool buffered_writer::open(const std::string& path, std::string& error)
+{
+  descriptor = platform::open_file(path, platform::WRITE);
+  if (descriptor == -1)
+  {
+    error = std::strerror(errno);
+    return false;
+  }
+
+  used = 0;
+  first_error = 0;
+  return true;
+}
+
+bool buffered_writer::close(std::string& error)
+{
+  flush();
+  if (not platform::close_file(descriptor) and first_error == 0) first_error = errno;
+  descriptor = -1;
+
+  if (first_error == 0) return true;
+  error = std::strerror(first_error);
+  return false;
+}
+
+void buffered_writer::flush()
+{
+  write_out(buffer.data(), used);
+  used = 0;
+}
+
+void buffered_writer::write_out(const char* data, size_t size)
+{
+  // A write may stop short of what it was given (or be interrupted), so it is repeated until everything is out
+  while (size > 0 and first_error == 0)
+  {
+    int64_t written = platform::write_file(descriptor, data, size);
+    if (written == -1)
+    {
+      if (errno != EINTR) first_error = errno;
+      continue;
+    }
+    data += written;
+    size -= size_t(written);
+  }
+}
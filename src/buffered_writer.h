@@ -0,0 +1,64 @@
+#pragma once
+
+#include <charconv>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Writes text to a file through a big buffer, numbers being formatted with std::to_chars straight into it, so writing
+// millions of elements costs no allocations and only a few system calls. Once something fails, everything after it is
+// dropped and close() reports the first error.
+class buffered_writer
+{
+public:
+  explicit buffered_writer(size_t capacity = size_t(1) << 20) : buffer(capacity) {}
+  buffered_writer(const buffered_writer&) = delete;
+  buffered_writer& operator=(const buffered_writer&) = delete;
+  ~buffered_writer();
+
+  // Creates (or truncates) the file
+  bool open(const std::string& path, std::string& error);
+  // Writes out what is left in the buffer and closes the file, returns false if anything went wrong along the way
+  bool close(std::string& error);
+
+  buffered_writer& operator<<(std::string_view text)
+  {
+    if (text.size() > buffer.size() - used) flush();
+    if (text.size() > buffer.size()) write_out(text.data(), text.size());
+    else
+    {
+      std::memcpy(buffer.data() + used, text.data(), text.size());
+      used += text.size();
+    }
+    return *this;
+  }
+
+  buffered_writer& operator<<(char c)
+  {
+    if (used == buffer.size()) flush();
+    buffer[used++] = c;
+    return *this;
+  }
+
+  // Integers and floating point numbers, the latter in their shortest form that reads back the same
+  template<typename number_type> requires std::is_arithmetic_v<number_type>
+  buffered_writer& operator<<(number_type number)
+  {
+    // Enough for any 64 bit integer or double
+    constexpr size_t longest = 32;
+    if (buffer.size() - used < longest) flush();
+    used = size_t(std::to_chars(buffer.data() + used, buffer.data() + buffer.size(), number).ptr - buffer.data());
+    return *this;
+  }
+
+private:
+  std::vector<char> buffer;
+  size_t used = 0;
+  int descriptor = -1;
+  int first_error = 0; // errno of the first failed call, 0 if none failed
+
+  void flush();
+  void write_out(const char* data, size_t size);
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "olcPixelGameEngine.h"
+#include <algorithm>
+#include <cmath>
+
+// Maps between world coordinates, which is where the nodes live, and screen pixels
+struct camera
+{
+  olc::vf2d offset = {0.0f, 0.0f}; // The world position shown in the top left corner of the screen
+  float zoom = 1.0f; // Screen pixels per world unit
+  float min_zoom = 0.02f;
+  float max_zoom = 8.0f;
+
+  olc::vi2d world_to_screen(const olc::vi2d& world) const
+  {
+    return {int(std::floor((float(world.x) - offset.x) * zoom)), int(std::floor((float(world.y) - offset.y) * zoom))};
+  }
+
+  olc::vi2d screen_to_world(const olc::vi2d& screen) const
+  {
+    return {int(std::round(float(screen.x) / zoom + offset.x)), int(std::round(float(screen.y) / zoom + offset.y))};
+  }
+
+  // Moves the view by a distance given in screen pixels (dragging the world along with the mouse)
+  void pan(const olc::vi2d& screen_delta)
+  {
+    offset -= olc::vf2d(screen_delta) / zoom;
+  }
+
+  // Zooms by the factor while keeping whatever is under the given screen position in place
+  void zoom_at(const olc::vi2d& screen, float factor)
+  {
+    olc::vf2d anchor = olc::vf2d(screen) / zoom + offset;
+    zoom = std::clamp(zoom * factor, min_zoom, max_zoom);
+    offset = anchor - olc::vf2d(screen) / zoom;
+  }
+
+  void reset()
+  {
+    offset = {0.0f, 0.0f};
+    zoom = 1.0f;
+  }
+};
@@ -0,0 +1,188 @@
+#include "compressed_lines.h"
+#include "parallel.h"
+#include <algorithm>
+
+namespace
+{
+  // Nodes handled by a thread at a time
+  constexpr int chunk_size = 4096;
+
+  // Varints hold 32 bits at most, which takes 5 bytes
+  constexpr int longest_varint = 5;
+
+  uint32_t zigzag(int value)
+  {
+    return (uint32_t(value) << 1) ^ uint32_t(value >> 31);
+  }
+
+  int varint_size(uint32_t value)
+  {
+    int size = 1;
+    for (; value >= 0x80; value >>= 7) size++;
+    return size;
+  }
+
+  uint8_t* write_varint(uint8_t* at, uint32_t value)
+  {
+    for (; value >= 0x80; value >>= 7) *at++ = uint8_t(value | 0x80);
+    *at++ = uint8_t(value);
+    return at;
+  }
+}
+
+compressed_lines::compressed_lines(std::vector<int> node_ids, const std::vector<line>& lines, bool both_ends, int thread_count)
+  : ids(std::move(node_ids))
+{
+  int count = node_count();
+
+  // IDs 1 to n (what the app hands out) are their own index plus 1, others are looked up; -1 for IDs of no node
+  bool dense = (ids.empty() or ids.back() == count);
+  auto index_of = [&](int id)
+  {
+    if (dense) return (id >= 1 and id <= count ? id - 1 : -1);
+    auto found = std::lower_bound(ids.begin(), ids.end(), id);
+    return (found != ids.end() and *found == id ? int(found - ids.begin()) : -1);
+  };
+
+  // The lines bucketed by their first end (and their other one), then sorted within the buckets by the end they go to
+  std::vector<int64_t> line_offsets(size_t(count) + 1, 0);
+  for (const line& line : lines)
+  {
+    int from = index_of(line.from);
+    int to = index_of(line.to);
+    if (from == -1 or to == -1) continue;
+
+    line_offsets[from + 1]++;
+    if (both_ends and to != from) line_offsets[to + 1]++;
+    lines_stored++;
+  }
+  for (int i = 0; i < count; i++) line_offsets[i + 1] += line_offsets[i];
+
+  std::vector<std::pair<int, int>> bucketed(size_t(line_offsets[count]));
+  std::vector<int64_t> filled(line_offsets.begin(), line_offsets.end() - 1);
+  for (const line& line : lines)
+  {
+    int from = index_of(line.from);
+    int to = index_of(line.to);
+    if (from == -1 or to == -1) continue;
+
+    bucketed[filled[from]++] = {to, line.length};
+    if (both_ends and to != from) bucketed[filled[to]++] = {from, line.length};
+  }
+
+  // Sorting the buckets and finding out how many bytes every node needs go together, then every node is written into its
+  // part of the stream
+  offsets.assign(size_t(count) + 1, 0);
+  parallel_for(thread_count, count, chunk_size, [&](int first, int last)
+  {
+    for (int from = first; from < last; from++)
+    {
+      auto begin = bucketed.begin() + line_offsets[from];
+      auto end = bucketed.begin() + line_offsets[from + 1];
+      std::sort(begin, end);
+
+      uint64_t size = uint64_t(varint_size(uint32_t(end - begin)));
+      int previous = from;
+      for (auto entry = begin; entry != end; entry++)
+      {
+        size += uint64_t(varint_size(entry == begin ? zigzag(entry->first - from) : uint32_t(entry->first - previous))) + 1;
+        previous = entry->first;
+      }
+      offsets[from + 1] = size;
+    }
+  });
+  for (int i = 0; i < count; i++) offsets[i + 1] += offsets[i];
+
+  stream.resize(offsets.back());
+  parallel_for(thread_count, count, chunk_size, [&](int first, int last)
+  {
+    for (int from = first; from < last; from++)
+    {
+      uint8_t* at = stream.data() + offsets[from];
+      auto begin = bucketed.begin() + line_offsets[from];
+      auto end = bucketed.begin() + line_offsets[from + 1];
+
+      at = write_varint(at, uint32_t(end - begin));
+      int previous = from;
+      for (auto entry = begin; entry != end; entry++)
+      {
+        at = write_varint(at, entry == begin ? zigzag(entry->first - from) : uint32_t(entry->first - previous));
+        *at++ = uint8_t(std::clamp(entry->second, 0, 255));
+        previous = entry->first;
+      }
+    }
+  });
+}
+
+bool compressed_lines::assign(std::vector<int> node_ids, const uint8_t* data, size_t size, int64_t line_count, std::string& error)
+{
+  int count = int(node_ids.size());
+  std::vector<uint64_t> node_offsets(size_t(count) + 1, 0);
+  int64_t found_lines = 0;
+
+  // Every varint has to end within the stream and be at most 5 bytes long, every other end has to be one of the nodes
+  size_t at = 0;
+  auto read_checked = [&](uint32_t& value)
+  {
+    value = 0;
+    for (int k = 0; k < longest_varint; k++)
+    {
+      if (at == size) return false;
+      uint8_t byte = data[at++];
+      value |= uint32_t(byte & 0x7F) << (7 * k);
+      if (not (byte & 0x80)) return true;
+    }
+    return false;
+  };
+
+  for (int from = 0; from < count; from++)
+  {
+    node_offsets[from] = at;
+    uint32_t lines_of_node = 0;
+    if (not read_checked(lines_of_node) or lines_of_node > size - at)
+    {
+      error = "the lines of node " + std::to_string(from) + " are cut off";
+      return false;
+    }
+
+    int64_t to = from;
+    for (uint32_t k = 0; k < lines_of_node; k++)
+    {
+      uint32_t distance = 0;
+      if (not read_checked(distance) or at == size)
+      {
+        error = "the lines of node " + std::to_string(from) + " are cut off";
+        return false;
+      }
+      to = (k == 0 ? from + int64_t(unzigzag(distance)) : to + int64_t(distance));
+      uint8_t length = data[at++];
+      if (to < 0 or to >= count or length < 1 or length > 99)
+      {
+        error = "line " + std::to_string(k) + " of node " + std::to_string(from) + " is invalid";
+        return false;
+      }
+    }
+    found_lines += lines_of_node;
+  }
+  node_offsets[count] = at;
+
+  if (at != size or found_lines != line_count)
+  {
+    error = "the lines don't add up to the line count";
+    return false;
+  }
+
+  ids = std::move(node_ids);
+  offsets = std::move(node_offsets);
+  stream.assign(data, data + size);
+  lines_stored = line_count;
+  return true;
+}
+
+std::vector<line> compressed_lines::to_lines() const
+{
+  std::vector<line> lines = {};
+  lines.reserve(size_t(lines_stored));
+  for_each_line([&](int from, int to, int length) { lines.emplace_back(ids[from], ids[to], length); });
+  return lines;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "line.h"
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A read only, compressed copy of the lines for huge graphs: the nodes are numbered 0 to n - 1 in the order of their IDs
+// and every node's outgoing lines are stored one after the other, sorted by their other end. Per node there is the number
+// of its lines followed by, for every line, the distance to the other end (from the node itself for the first line, where
+// it can be negative and is zigzag coded, from the previous line's end after that) as a varint and the length as a single
+// byte (lengths only go up to 99). Graphs whose nodes are numbered along their structure mostly get one byte per distance,
+// i.e. about 2 to 3 bytes per line instead of the 12 of a line.
+//
+// The same stream of bytes is what graph files store, offsets to every node's part of it are kept on top of that in memory
+// so the lines of any node can be gone through directly. Besides being the codec of graph files, it is what the layouts
+// keep the lines in while they run, stored at both ends for those that need every neighbour of a node.
+class compressed_lines
+{
+public:
+  compressed_lines() = default;
+
+  // The IDs of the nodes have to be ascending; lines that don't join two of them are left out. With both_ends, every line
+  // is also stored at its other end (loops only once), so going through the lines of a node gives all of its neighbours
+  // whichever way the lines point. line_count() counts every line once either way.
+  compressed_lines(std::vector<int> node_ids, const std::vector<line>& lines, bool both_ends = false, int thread_count = std::max(1u, std::thread::hardware_concurrency()));
+
+  // Takes over a stream of bytes (as stored in a graph file) for the nodes with the IDs, checking it on the way: returns
+  // false and describes what is wrong with it in error if it doesn't hold line_count lines between the nodes
+  bool assign(std::vector<int> node_ids, const uint8_t* data, size_t size, int64_t line_count, std::string& error);
+
+  int node_count() const { return int(ids.size()); }
+  int64_t line_count() const { return lines_stored; }
+  int id_of(int index) const { return ids[index]; }
+  const std::vector<uint8_t>& bytes() const { return stream; }
+
+  // Goes through the lines of a node one at a time, for walks that stop in between and pick up again later
+  class line_cursor
+  {
+  public:
+    line_cursor(const uint8_t* at, int index) : at(at), to(index) { remaining = read_varint(this->at); }
+
+    // The other end (by index) and length of the next line, false once there are none left
+    bool next(int& other_end, int& length)
+    {
+      if (remaining == 0) return false;
+      uint32_t distance = read_varint(at);
+      to = (first ? to + unzigzag(distance) : to + int(distance));
+      first = false;
+      remaining--;
+      other_end = to;
+      length = int(*at++);
+      return true;
+    }
+
+  private:
+    const uint8_t* at;
+    uint32_t remaining = 0;
+    int to;
+    bool first = true;
+  };
+
+  line_cursor lines_of(int index) const { return line_cursor(stream.data() + offsets[index], index); }
+  int line_count_of(int index) const
+  {
+    const uint8_t* at = stream.data() + offsets[index];
+    return int(read_varint(at));
+  }
+
+  // Calls function(to, length) for every line of the node (by index, as are the other ends), sorted by the other end
+  template<typename function_type>
+  void for_each_line_of(int index, function_type&& function) const
+  {
+    line_cursor cursor = lines_of(index);
+    int to = 0;
+    int length = 0;
+    while (cursor.next(to, length)) function(to, length);
+  }
+
+  // Calls function(from, to, length) for every line (twice if stored at both ends), in the order of their first and then
+  // their other end
+  template<typename function_type>
+  void for_each_line(function_type&& function) const
+  {
+    for (int from = 0; from < node_count(); from++) for_each_line_of(from, [&](int to, int length) { function(from, to, length); });
+  }
+
+  // The lines as the app holds them, with node IDs
+  std::vector<line> to_lines() const;
+
+  static uint32_t read_varint(const uint8_t*& at)
+  {
+    uint32_t value = *at & 0x7F;
+    for (int shift = 7; *at++ & 0x80; shift += 7) value |= uint32_t(*at & 0x7F) << shift;
+    return value;
+  }
+
+private:
+  std::vector<int> ids = {}; // The IDs of the nodes, ascending
+  std::vector<uint64_t> offsets = {}; // Where every node's lines start in the stream
+  std::vector<uint8_t> stream = {};
+  int64_t lines_stored = 0;
+
+  static int unzigzag(uint32_t value) { return int(value >> 1) ^ -int(value & 1); }
+};
@@ -0,0 +1,369 @@
+#include "edge_list_import.h"
+#include "mapped_file.h"
+#include "parallel.h"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <numbers>
+
+namespace
+{
+  // Bytes of text parsed by a thread at a time, the progress moves on chunk by chunk
+  constexpr size_t chunk_bytes = size_t(1) << 22;
+
+  // Nodes handled by a thread at a time
+  constexpr int chunk_size = 4096;
+
+  // The longest line the app allows
+  constexpr int32_t max_length = 99;
+
+  bool is_separator(char c)
+  {
+    return c == ' ' or c == '\t' or c == ',' or c == ';' or c == '\r';
+  }
+
+  const char* skip_separators(const char* position, const char* end)
+  {
+    while (position != end and is_separator(*position)) position++;
+    return position;
+  }
+}
+
+edge_list_import::~edge_list_import()
+{
+  cancelled = true;
+  if (worker.joinable()) worker.join();
+}
+
+void edge_list_import::start(const std::string& path)
+{
+  if (running) return;
+
+  this->path = path;
+  failure.clear();
+  skipped = 0;
+  dropped = 0;
+  parsed_bytes = 0;
+  total_bytes = 0;
+  done = false;
+  running = true;
+  worker = std::thread([this]()
+  {
+    import();
+    done = true;
+  });
+}
+
+bool edge_list_import::is_running() const
+{
+  return running;
+}
+
+float edge_list_import::progress() const
+{
+  size_t total = total_bytes;
+  return (total == 0 ? 0.0f : float(double(parsed_bytes) / double(total)));
+}
+
+bool edge_list_import::update(std::map<int, olc::vi2d>& nodes, std::vector<line>& lines)
+{
+  if (not worker.joinable() or not done) return false;
+
+  worker.join();
+  running = false;
+  if (failure.empty())
+  {
+    nodes.swap(imported_nodes);
+    lines.swap(imported_lines);
+  }
+  imported_nodes = {};
+  imported_lines = {};
+  return true;
+}
+
+const std::string& edge_list_import::error() const
+{
+  return failure;
+}
+
+int64_t edge_list_import::skipped_count() const
+{
+  return skipped;
+}
+
+int64_t edge_list_import::dropped_count() const
+{
+  return dropped;
+}
+
+float edge_list_import::milliseconds() const
+{
+  return computed_milliseconds;
+}
+
+void edge_list_import::import()
+{
+  auto started = std::chrono::steady_clock::now();
+  auto finish = [&]() { computed_milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - started).count(); };
+
+  mapped_file file;
+  if (not file.open(path, failure)) return finish();
+  total_bytes = file.size();
+
+  // Every chunk ends right after a newline (or at the end of the file), so no text line is split between two of them
+  std::vector<chunk> chunks = {};
+  for (size_t first = 0; first < file.size();)
+  {
+    size_t last = std::min(file.size(), first + chunk_bytes);
+    if (last < file.size())
+    {
+      const void* newline = std::memchr(file.data() + last - 1, '\n', file.size() - last + 1);
+      last = (newline == nullptr ? file.size() : size_t(static_cast<const char*>(newline) - file.data()) + 1);
+    }
+    chunks.push_back({first, last});
+    first = last;
+  }
+
+  parallel_for(thread_count, int(chunks.size()), 1, [&](int first, int last)
+  {
+    for (int i = first; i < last and not cancelled; i++)
+    {
+      parse(file.data(), chunks[i]);
+      parsed_bytes += chunks[i].last - chunks[i].first;
+    }
+  });
+  if (cancelled)
+  {
+    failure = "cancelled";
+    return finish();
+  }
+  for (const chunk& chunk : chunks) skipped += chunk.skipped;
+
+  std::vector<int32_t> froms = {};
+  std::vector<int32_t> tos = {};
+  std::vector<int32_t> lengths = {};
+  int node_count = 0;
+  if (not gather_lines(chunks, froms, tos, lengths, node_count)) return finish();
+
+  std::vector<char> kept = find_first_lines(froms, tos, node_count);
+  size_t kept_count = size_t(std::count(kept.begin(), kept.end(), 1));
+  dropped = int64_t(froms.size() - kept_count);
+  imported_lines.reserve(kept_count);
+  for (size_t i = 0; i < froms.size(); i++)
+    if (kept[i]) imported_lines.emplace_back(froms[i], tos[i], lengths[i]);
+
+  place_nodes(node_count);
+  finish();
+}
+
+void edge_list_import::parse(const char* text, chunk& chunk) const
+{
+  const char* position = text + chunk.first;
+  const char* end = text + chunk.last;
+
+  // A guess of 16 bytes per text line keeps the vectors from growing too often
+  size_t expected = (chunk.last - chunk.first) / 16;
+  chunk.froms.reserve(expected);
+  chunk.tos.reserve(expected);
+  chunk.lengths.reserve(expected);
+
+  while (position < end)
+  {
+    const char* line_end = static_cast<const char*>(std::memchr(position, '\n', size_t(end - position)));
+    if (line_end == nullptr) line_end = end;
+
+    const char* at = skip_separators(position, line_end);
+    position = line_end + 1;
+    if (at == line_end or *at == '#' or *at == '%') continue;
+
+    int64_t from = 0;
+    int64_t to = 0;
+    double weight = 1.0;
+    auto [after_from, from_error] = std::from_chars(at, line_end, from);
+    bool parsed = (from_error == std::errc() and after_from != line_end and is_separator(*after_from));
+    if (parsed)
+    {
+      auto [after_to, to_error] = std::from_chars(skip_separators(after_from, line_end), line_end, to);
+      parsed = (to_error == std::errc());
+      at = skip_separators(after_to, line_end);
+    }
+    // The weight is optional, anything after it is ignored
+    if (parsed and at != line_end) parsed = (std::from_chars(at, line_end, weight).ec == std::errc());
+    if (not parsed)
+    {
+      chunk.skipped++;
+      continue;
+    }
+
+    chunk.froms.push_back(from);
+    chunk.tos.push_back(to);
+    // Also turns NaN into 1
+    chunk.lengths.push_back(weight >= 1.0 ? int32_t(std::min(std::round(weight), double(max_length))) : 1);
+    chunk.smallest_id = std::min({chunk.smallest_id, from, to});
+    chunk.largest_id = std::max({chunk.largest_id, from, to});
+  }
+}
+
+// Puts the lines of all chunks together, numbering the nodes 1 to n in the order of the IDs in the file
+bool edge_list_import::gather_lines(std::vector<chunk>& chunks, std::vector<int32_t>& froms, std::vector<int32_t>& tos, std::vector<int32_t>& lengths, int& node_count)
+{
+  std::vector<size_t> offsets(chunks.size() + 1, 0);
+  int64_t smallest = INT64_MAX;
+  int64_t largest = INT64_MIN;
+  for (size_t i = 0; i < chunks.size(); i++)
+  {
+    offsets[i + 1] = offsets[i] + chunks[i].froms.size();
+    smallest = std::min(smallest, chunks[i].smallest_id);
+    largest = std::max(largest, chunks[i].largest_id);
+  }
+  size_t line_count = offsets.back();
+  if (line_count > size_t(INT_MAX))
+  {
+    failure = "more lines than the app can hold";
+    return false;
+  }
+  if (line_count == 0) return true;
+
+  froms.resize(line_count);
+  tos.resize(line_count);
+  lengths.resize(line_count);
+  int chunk_count = int(chunks.size());
+
+  // IDs close together are numbered through a table with an entry for every ID between the smallest and the largest one,
+  // which is only a few times as big as the lines themselves; other IDs are sorted and looked up. IDs spanning all of
+  // int64_t make the range wrap around to 0, which has to go the second way too.
+  uint64_t range = uint64_t(largest) - uint64_t(smallest) + 1;
+  if (range != 0 and range <= 4 * uint64_t(line_count) + 1024)
+  {
+    std::vector<int32_t> numbers(range, 0);
+    parallel_for(thread_count, chunk_count, 1, [&](int first, int last)
+    {
+      for (int i = first; i < last; i++)
+        for (size_t j = 0; j < chunks[i].froms.size(); j++)
+        {
+          std::atomic_ref<int32_t>(numbers[chunks[i].froms[j] - smallest]).store(1, std::memory_order_relaxed);
+          std::atomic_ref<int32_t>(numbers[chunks[i].tos[j] - smallest]).store(1, std::memory_order_relaxed);
+        }
+    });
+
+    int64_t count = 0;
+    for (int32_t& number : numbers)
+      if (number != 0) number = int32_t(++count);
+    if (count > INT_MAX)
+    {
+      failure = "more nodes than the app can hold";
+      return false;
+    }
+    node_count = int(count);
+
+    parallel_for(thread_count, chunk_count, 1, [&](int first, int last)
+    {
+      for (int i = first; i < last; i++)
+      {
+        for (size_t j = 0; j < chunks[i].froms.size(); j++)
+        {
+          froms[offsets[i] + j] = numbers[chunks[i].froms[j] - smallest];
+          tos[offsets[i] + j] = numbers[chunks[i].tos[j] - smallest];
+        }
+        std::copy(chunks[i].lengths.begin(), chunks[i].lengths.end(), lengths.begin() + offsets[i]);
+        chunks[i] = {};
+      }
+    });
+    return true;
+  }
+
+  // Every chunk sorts its own IDs first, so the final sort mostly merges
+  std::vector<std::vector<int64_t>> chunk_ids(chunks.size());
+  parallel_for(thread_count, chunk_count, 1, [&](int first, int last)
+  {
+    for (int i = first; i < last; i++)
+    {
+      std::vector<int64_t>& ids = chunk_ids[i];
+      ids.reserve(2 * chunks[i].froms.size());
+      ids.insert(ids.end(), chunks[i].froms.begin(), chunks[i].froms.end());
+      ids.insert(ids.end(), chunks[i].tos.begin(), chunks[i].tos.end());
+      std::sort(ids.begin(), ids.end());
+      ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    }
+  });
+
+  std::vector<int64_t> ids = {};
+  for (auto& sorted : chunk_ids)
+  {
+    size_t middle = ids.size();
+    ids.insert(ids.end(), sorted.begin(), sorted.end());
+    std::inplace_merge(ids.begin(), ids.begin() + ptrdiff_t(middle), ids.end());
+    sorted = {};
+  }
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+  if (ids.size() > size_t(INT_MAX))
+  {
+    failure = "more nodes than the app can hold";
+    return false;
+  }
+  node_count = int(ids.size());
+
+  parallel_for(thread_count, chunk_count, 1, [&](int first, int last)
+  {
+    auto number_of = [&](int64_t id) { return int32_t(std::lower_bound(ids.begin(), ids.end(), id) - ids.begin()) + 1; };
+    for (int i = first; i < last; i++)
+    {
+      for (size_t j = 0; j < chunks[i].froms.size(); j++)
+      {
+        froms[offsets[i] + j] = number_of(chunks[i].froms[j]);
+        tos[offsets[i] + j] = number_of(chunks[i].tos[j]);
+      }
+      std::copy(chunks[i].lengths.begin(), chunks[i].lengths.end(), lengths.begin() + offsets[i]);
+      chunks[i] = {};
+    }
+  });
+  return true;
+}
+
+// Which lines to keep: the first one between every two nodes, leaving out lines from a node to itself. The lines are
+// bucketed by their lower end (keeping the order of the file within a bucket), so only the lines within a bucket have to be
+// compared.
+std::vector<char> edge_list_import::find_first_lines(const std::vector<int32_t>& froms, const std::vector<int32_t>& tos, int node_count) const
+{
+  int line_count = int(froms.size());
+  std::vector<int> offsets(size_t(node_count) + 2, 0);
+  for (int i = 0; i < line_count; i++)
+    if (froms[i] != tos[i]) offsets[std::min(froms[i], tos[i]) + 1]++;
+  for (int node = 0; node <= node_count; node++) offsets[node + 1] += offsets[node];
+
+  // The higher end goes along with every line, so sorting a bucket doesn't have to look the lines up
+  std::vector<std::pair<int32_t, int>> bucketed(offsets.back());
+  std::vector<int> filled(offsets.begin(), offsets.end() - 1);
+  for (int i = 0; i < line_count; i++)
+    if (froms[i] != tos[i]) bucketed[filled[std::min(froms[i], tos[i])]++] = {std::max(froms[i], tos[i]), i};
+
+  std::vector<char> kept(line_count, 0);
+  parallel_for(thread_count, node_count + 1, chunk_size, [&](int first, int last)
+  {
+    for (int node = first; node < last; node++)
+    {
+      auto begin = bucketed.begin() + offsets[node];
+      auto end = bucketed.begin() + offsets[node + 1];
+      std::sort(begin, end);
+      for (auto i = begin; i != end; i++)
+        if (i == begin or i->first != (i - 1)->first) kept[i->second] = 1;
+    }
+  });
+  return kept;
+}
+
+// A sunflower spiral around the origin: every node gets about node_spacing squared of room, the lower IDs in the middle
+void edge_list_import::place_nodes(int node_count)
+{
+  const float golden_angle = std::numbers::pi_v<float> * (3.0f - std::sqrt(5.0f));
+  for (int i = 0; i < node_count; i++)
+  {
+    float distance = node_spacing * std::sqrt(float(i) / std::numbers::pi_v<float>);
+    float angle = golden_angle * float(i);
+    olc::vi2d position = {int(std::round(distance * std::cos(angle))), int(std::round(distance * std::sin(angle)))};
+    imported_nodes.emplace_hint(imported_nodes.end(), i + 1, position);
+  }
+}
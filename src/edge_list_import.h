@@ -0,0 +1,84 @@
+#pragma once
+
+#include "olcPixelGameEngine.h"
+#include "line.h"
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Imports a text edge list (SNAP, CSV and the like): one line per text line, "from to" or "from to weight", separated by
+// spaces, tabs, commas or semicolons. Text lines starting with # or % are comments, anything else that doesn't parse (a CSV
+// header for instance) is skipped and counted.
+//
+// The file is mapped and split into chunks ending on newlines, which the threads parse with std::from_chars. The IDs in
+// the file can be any integers; they are numbered 1 to n in ascending order, through a lookup table if they lie close
+// together (as they usually do) and by sorting them otherwise. The weights become the line lengths, rounded into the 1 to
+// 99 the app allows. Like in the app, there is at most one line between two nodes, whichever way it points: the first one
+// in the file is kept and the others are dropped, as are lines from a node to itself. Edge lists have no positions, so
+// the nodes are put on a sunflower spiral for a layout to take over from.
+//
+// The import runs on a background thread; update() hands the graph over once it is done.
+class edge_list_import
+{
+public:
+  float node_spacing = 40.0f; // World units between the placeholder positions of neighbouring nodes
+  int thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+  ~edge_list_import();
+
+  void start(const std::string& path);
+  bool is_running() const;
+
+  // How much of the file has been parsed so far, from 0 to 1
+  float progress() const;
+
+  // Called once per frame. Returns true once the import is done, having replaced the nodes and lines with the imported
+  // ones unless it failed (see error()).
+  bool update(std::map<int, olc::vi2d>& nodes, std::vector<line>& lines);
+
+  // As of the last import handed over by update(): what went wrong (empty if nothing did), the text lines that couldn't be
+  // parsed, the lines dropped as duplicates or loops and how long it took
+  const std::string& error() const;
+  int64_t skipped_count() const;
+  int64_t dropped_count() const;
+  float milliseconds() const;
+
+private:
+  // What a thread made of one chunk of the file
+  struct chunk
+  {
+    size_t first = 0; // Byte range within the file
+    size_t last = 0;
+    std::vector<int64_t> froms = {};
+    std::vector<int64_t> tos = {};
+    std::vector<int32_t> lengths = {};
+    int64_t skipped = 0;
+    int64_t smallest_id = INT64_MAX;
+    int64_t largest_id = INT64_MIN;
+  };
+
+  bool running = false;
+  std::thread worker;
+  std::atomic<bool> done = false;
+  std::atomic<bool> cancelled = false;
+  std::atomic<size_t> parsed_bytes = 0;
+  std::atomic<size_t> total_bytes = 0;
+
+  // Everything below is owned by the worker while the import is running
+  std::string path = {};
+  std::map<int, olc::vi2d> imported_nodes = {};
+  std::vector<line> imported_lines = {};
+  std::string failure = {};
+  int64_t skipped = 0;
+  int64_t dropped = 0;
+  float computed_milliseconds = 0.0f;
+
+  void import();
+  void parse(const char* text, chunk& chunk) const;
+  bool gather_lines(std::vector<chunk>& chunks, std::vector<int32_t>& froms, std::vector<int32_t>& tos, std::vector<int32_t>& lengths, int& node_count);
+  std::vector<char> find_first_lines(const std::vector<int32_t>& froms, const std::vector<int32_t>& tos, int node_count) const;
+  void place_nodes(int node_count);
+};
@@ -0,0 +1,172 @@
+#include "edit_journal.h"
+#include "platform.h"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace
+{
+  constexpr char magic[8] = {'P', 'G', 'E', 'J', 'O', 'U', 'R', 'N'};
+  constexpr uint32_t version = 1;
+
+  // An edit as it is stored: the edit followed by its checksum
+  constexpr size_t record_size = sizeof(edit_journal::edit) + sizeof(uint32_t);
+  static_assert(sizeof(edit_journal::edit) == 16);
+
+  // FNV-1a
+  uint32_t checksum(const char* data, size_t size)
+  {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++) hash = (hash ^ uint8_t(data[i])) * 16777619u;
+    return hash;
+  }
+}
+
+edit_journal::~edit_journal()
+{
+  if (not writer.joinable()) return;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_one();
+  writer.join();
+  platform::close_file(descriptor);
+}
+
+bool edit_journal::open(const std::string& path, std::string& base, std::vector<edit>& edits, std::string& error)
+{
+  base.clear();
+  edits.clear();
+
+  // What is in the journal so far, up to the first record that is torn or not there at all
+  size_t intact_size = 0;
+  std::ifstream file(path, std::ios::binary);
+  std::vector<char> content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  uint32_t header[2] = {};
+  if (content.size() >= sizeof(magic) + sizeof(header) and std::equal(std::begin(magic), std::end(magic), content.begin()))
+  {
+    std::memcpy(header, content.data() + sizeof(magic), sizeof(header));
+    size_t records_start = sizeof(magic) + sizeof(header) + header[1];
+    if (header[0] == version and records_start <= content.size())
+    {
+      base.assign(content.data() + sizeof(magic) + sizeof(header), header[1]);
+      intact_size = records_start;
+      for (; intact_size + record_size <= content.size(); intact_size += record_size)
+      {
+        uint32_t stored = 0;
+        std::memcpy(&stored, content.data() + intact_size + sizeof(edit), sizeof(stored));
+        if (stored != checksum(content.data() + intact_size, sizeof(edit))) break;
+
+        edit edit;
+        std::memcpy(&edit, content.data() + intact_size, sizeof(edit));
+        edits.push_back(edit);
+      }
+    }
+  }
+
+  // Appending only ever writes at the end, which is where the intact part ends after cutting off the rest
+  descriptor = platform::open_file(path, platform::APPEND);
+  if (descriptor == -1 or not platform::resize_file(descriptor, intact_size))
+  {
+    error = std::strerror(errno);
+    if (descriptor != -1) platform::close_file(descriptor);
+    descriptor = -1;
+    return false;
+  }
+  // A journal that had nothing intact in it gets its header for the empty graph, until restart() says otherwise
+  if (intact_size == 0) restart({});
+
+  writer = std::thread([this]() { write_out(); });
+  return true;
+}
+
+void edit_journal::restart(const std::string& base)
+{
+  if (descriptor == -1) return;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.clear();
+    restarting = true;
+    restart_base = base;
+  }
+  wake.notify_one();
+}
+
+void edit_journal::append(const edit& edit)
+{
+  if (descriptor == -1) return;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.push_back(edit);
+  }
+  wake.notify_one();
+}
+
+void edit_journal::write_out()
+{
+  std::vector<edit> batch = {};
+  std::vector<char> bytes = {};
+  bool failed = false;
+
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true)
+  {
+    wake.wait(lock, [&]() { return stopping or restarting or not pending.empty(); });
+    bool restart = restarting;
+    std::string base = restart_base;
+    bool stop = stopping;
+    restarting = false;
+    batch.swap(pending);
+    lock.unlock();
+
+    bytes.clear();
+    if (restart)
+    {
+      uint32_t header[2] = {version, uint32_t(base.size())};
+      bytes.insert(bytes.end(), std::begin(magic), std::end(magic));
+      bytes.insert(bytes.end(), reinterpret_cast<const char*>(header), reinterpret_cast<const char*>(header) + sizeof(header));
+      bytes.insert(bytes.end(), base.begin(), base.end());
+    }
+    for (const edit& edit : batch)
+    {
+      const char* data = reinterpret_cast<const char*>(&edit);
+      uint32_t sum = checksum(data, sizeof(edit));
+      bytes.insert(bytes.end(), data, data + sizeof(edit));
+      bytes.insert(bytes.end(), reinterpret_cast<const char*>(&sum), reinterpret_cast<const char*>(&sum) + sizeof(sum));
+    }
+    batch.clear();
+
+    bool written = (not restart or platform::resize_file(descriptor, 0)) and write_all(bytes.data(), bytes.size()) and platform::sync_file(descriptor);
+    // Reported once, the journal keeps trying
+    if (not written and not failed) std::cout << "Could not write the edit journal: " << std::strerror(errno) << '\n';
+    failed = not written;
+    if (stop) return;
+
+    // Group commit: everything edited until the interval is over goes out with the next sync
+    lock.lock();
+    wake.wait_for(lock, std::chrono::milliseconds(commit_interval), [&]() { return stopping; });
+  }
+}
+
+bool edit_journal::write_all(const char* data, size_t size)
+{
+  while (size > 0)
+  {
+    int64_t written = platform::write_file(descriptor, data, size);
+    if (written == -1)
+    {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    data += written;
+    size -= size_t(written);
+  }
+  return true;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Append-only journal of the edits made to the graph since it was last opened or saved, so they can be replayed after a
+// crash. The journal starts with the file the edits were made to (or none, for the empty graph), followed by one fixed
+// size record per edit with a checksum, so a record torn by a crash is recognised and dropped along with everything after
+// it.
+//
+// The UI thread only queues the edits. A writer thread writes out everything queued so far and syncs it to disk
+// (fdatasync), then waits for commit_interval before the next batch, so however many edits come in, the disk is synced at
+// most once per interval and the UI never waits for it.
+class edit_journal
+{
+public:
+  enum edit_type : uint32_t
+  {
+    CREATE_NODE = 1, // a: ID, b/c: position
+    DELETE_NODE, // a: ID, its lines go with it
+    MOVE_NODE, // a: ID, b/c: the position it ended up at
+    ADD_LINE, // a: from, b: to, c: length
+    DELETE_LINE, // a: from, b: to
+    SET_LINE_LENGTH, // a: from, b: to, c: length
+    CLEAR_GRAPH, // All nodes and lines
+    CLEAR_LINES // All lines
+  };
+
+  struct edit
+  {
+    edit_type type;
+    int32_t a = 0;
+    int32_t b = 0;
+    int32_t c = 0;
+  };
+
+  int commit_interval = 100; // Milliseconds from one sync to disk to the next at least
+
+  ~edit_journal();
+
+  // Opens (or creates) the journal at the path and starts the writer. The edits already in it are handed out along with the
+  // file they were made to; whatever follows the last intact record is cut off. Returns false and describes what went wrong
+  // in error if the journal can't be opened, every edit is ignored then.
+  bool open(const std::string& path, std::string& base, std::vector<edit>& edits, std::string& error);
+
+  // Starts over for the graph as it is in the file at the base path (empty for the empty graph), dropping every edit so far
+  void restart(const std::string& base);
+
+  void append(const edit& edit);
+
+private:
+  int descriptor = -1;
+  std::thread writer;
+  std::mutex mutex;
+  std::condition_variable wake;
+  // Guarded by the mutex
+  std::vector<edit> pending = {};
+  bool restarting = false;
+  std::string restart_base = {};
+  bool stopping = false;
+
+  void write_out();
+  bool write_all(const char* data, size_t size);
+};
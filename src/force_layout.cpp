@@ -0,0 +1,606 @@
+#include "force_layout.h"
+#include "parallel.h"
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+#if defined(__x86_64__) or defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+  // Beyond this the cells get so small that only nodes sitting on top of each other are left to separate
+  constexpr int max_tree_depth = 24;
+
+  // Cells with this few nodes aren't split any further; summing them up directly is cheaper than walking more cells
+  constexpr int leaf_capacity = 8;
+
+#if defined(__x86_64__) or defined(__i386__)
+  // The springs [first, last) 8 at a time: the forces are computed side by side, only adding them onto the nodes is done
+  // one by one. Returns where it stopped, leaving fewer than 8 springs. Compiled for AVX2 whatever the build flags are, so
+  // it may only be called once the CPU is known to have it.
+  __attribute__((target("avx2"))) int accumulate_springs_avx2(const int32_t* froms, const int32_t* tos, const float* inverse_lengths, const float* xs, const float* ys, int first, int last, float* accumulator_x, float* accumulator_y)
+  {
+    int i = first;
+    alignas(32) float force_xs[8];
+    alignas(32) float force_ys[8];
+    for (; i + 8 <= last; i += 8)
+    {
+      __m256i from = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(froms + i));
+      __m256i to = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tos + i));
+      __m256 dx = _mm256_sub_ps(_mm256_i32gather_ps(xs, to, 4), _mm256_i32gather_ps(xs, from, 4));
+      __m256 dy = _mm256_sub_ps(_mm256_i32gather_ps(ys, to, 4), _mm256_i32gather_ps(ys, from, 4));
+      __m256 distance = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)));
+      __m256 scale = _mm256_mul_ps(distance, _mm256_loadu_ps(inverse_lengths + i));
+      _mm256_store_ps(force_xs, _mm256_mul_ps(dx, scale));
+      _mm256_store_ps(force_ys, _mm256_mul_ps(dy, scale));
+
+      for (int lane = 0; lane < 8; lane++)
+      {
+        accumulator_x[froms[i + lane]] += force_xs[lane];
+        accumulator_y[froms[i + lane]] += force_ys[lane];
+        accumulator_x[tos[i + lane]] -= force_xs[lane];
+        accumulator_y[tos[i + lane]] -= force_ys[lane];
+      }
+    }
+
+    // The caller is compiled without AVX, which runs slowly while the upper halves of the registers are dirty
+    _mm256_zeroupper();
+    return i;
+  }
+#endif
+}
+
+force_layout::~force_layout()
+{
+  if (worker.joinable()) worker.join();
+}
+
+void force_layout::start()
+{
+  running = true;
+  first_step = true;
+}
+
+void force_layout::stop()
+{
+  running = false;
+  if (worker.joinable()) stopped_in_flight = true;
+}
+
+bool force_layout::is_running() const
+{
+  return running;
+}
+
+int force_layout::current_level() const
+{
+  return shown_level;
+}
+
+const std::vector<force_layout::level_report>& force_layout::level_reports() const
+{
+  return shown_reports;
+}
+
+bool force_layout::has_same_nodes(const std::map<int, olc::vi2d>& nodes) const
+{
+  if (ids.size() != nodes.size()) return false;
+
+  size_t i = 0;
+  for (const auto& node : nodes)
+    if (ids[i++] != node.first) return false;
+
+  return true;
+}
+
+void force_layout::gather(const std::map<int, olc::vi2d>& nodes, const std::vector<line>& lines)
+{
+  // Keeping the fractional positions between steps unless the nodes changed, otherwise small steps would be rounded away
+  bool same_nodes = has_same_nodes(nodes);
+  if (same_nodes)
+  {
+    size_t i = 0;
+    for (const auto& node : nodes)
+    {
+      if (olc::vi2d{int(std::round(node_xs[i])), int(std::round(node_ys[i]))} != node.second)
+      {
+        node_xs[i] = float(node.second.x);
+        node_ys[i] = float(node.second.y);
+      }
+      i++;
+    }
+  }
+  else
+  {
+    ids.clear();
+    node_xs.clear();
+    node_ys.clear();
+    for (const auto& node : nodes)
+    {
+      ids.push_back(node.first);
+      node_xs.push_back(float(node.second.x));
+      node_ys.push_back(float(node.second.y));
+    }
+    nodes_changed = true;
+  }
+
+  // Dragging nodes around changes neither, and new IDs need the lines compressed again even if they stayed the same
+  uint64_t gathered_fingerprint = fingerprint(lines);
+  if (same_nodes and gathered_fingerprint == lines_fingerprint and not first_step) return;
+
+  lines_snapshot = lines;
+  lines_gathered = true;
+  lines_fingerprint = gathered_fingerprint;
+}
+
+void force_layout::build_springs()
+{
+  if (lines_gathered)
+  {
+    graph = compressed_lines(ids, lines_snapshot, false, thread_count);
+    std::vector<line>().swap(lines_snapshot);
+    lines_gathered = false;
+  }
+
+  spring_froms.clear();
+  spring_tos.clear();
+  spring_inverse_lengths.clear();
+  graph.for_each_line([&](int from, int to, int length)
+  {
+    if (from == to) return;
+
+    spring_froms.push_back(from);
+    spring_tos.push_back(to);
+    spring_inverse_lengths.push_back(1.0f / (ideal_distance * float(length)));
+  });
+}
+
+// The lines of the graph itself might change between steps, the ones of the coarser levels are fixed
+void force_layout::use_springs_of_level()
+{
+  if (level_index == 0)
+  {
+    build_springs();
+    return;
+  }
+
+  spring_froms = levels[level_index].froms;
+  spring_tos = levels[level_index].tos;
+  spring_inverse_lengths = levels[level_index].inverse_lengths;
+}
+
+void force_layout::compute_step(bool reheat)
+{
+  int count = int(ids.size());
+  next_node_xs.resize(count);
+  next_node_ys.resize(count);
+  if (count == 0)
+  {
+    converged = true;
+    return;
+  }
+
+  // The coarser levels no longer fit once nodes were added or deleted, so those start over
+  bool restart = reheat or (nodes_changed and level_index > 0);
+  nodes_changed = false;
+
+  if (restart)
+  {
+    build_springs();
+    levels.assign(1, level());
+    levels[0].count = count;
+    if (count > multilevel_threshold) coarsen();
+
+    // Every coarser node starts out at the centre of the nodes merged into it
+    xs = node_xs;
+    ys = node_ys;
+    for (size_t index = 1; index < levels.size(); index++)
+    {
+      const level& level = levels[index];
+      std::vector<float> coarse_xs(level.count, 0.0f);
+      std::vector<float> coarse_ys(level.count, 0.0f);
+      std::vector<float> sizes(level.count, 0.0f);
+      for (size_t i = 0; i < level.parents.size(); i++)
+      {
+        coarse_xs[level.parents[i]] += xs[i];
+        coarse_ys[level.parents[i]] += ys[i];
+        sizes[level.parents[i]] += 1.0f;
+      }
+      for (int i = 0; i < level.count; i++)
+      {
+        coarse_xs[i] /= sizes[i];
+        coarse_ys[i] /= sizes[i];
+      }
+      xs.swap(coarse_xs);
+      ys.swap(coarse_ys);
+    }
+
+    level_index = int(levels.size()) - 1;
+    use_springs_of_level();
+    reports.clear();
+    level_steps = 0;
+    level_start = std::chrono::steady_clock::now();
+    converged = false;
+  }
+  // Continuing from the positions shown, which includes nodes dragged around in the meantime
+  else if (level_index == 0)
+  {
+    xs = node_xs;
+    ys = node_ys;
+    build_springs();
+  }
+
+  // The coarser levels are small, so handing over every single one of their steps would mostly cost time spent on
+  // showing them; those steps are bundled up to a time budget instead
+  auto started = std::chrono::steady_clock::now();
+  do
+  {
+    build_tree();
+
+    // The first step may move a node by a tenth of the extent of the whole graph (or its coarsest version)
+    if (restart) temperature = std::max(2.0f * ideal_distance, tree[0].size / 10.0f);
+    restart = false;
+
+    layout_step(level_index == int(levels.size()) - 1 ? cooling : refine_cooling);
+    level_steps++;
+
+    if (temperature < final_temperature) finish_level();
+  }
+  while (level_index > 0 and std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - started).count() < coarse_time_budget);
+
+  show_positions();
+}
+
+// Reports how the level went and hands its positions down to the next finer one, if there is one
+void force_layout::finish_level()
+{
+  float milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - level_start).count();
+  reports.push_back({level_index, int(xs.size()), int(spring_froms.size()), level_steps, milliseconds});
+
+  if (level_index == 0) converged = true;
+  else
+  {
+    // The finer level has more nodes, so it gets more room; it only needs refining, so it starts off a lot cooler
+    std::vector<float> finer_xs;
+    std::vector<float> finer_ys;
+    float scale = std::sqrt(float(levels[level_index].parents.size()) / float(levels[level_index].count));
+    spread_into_finer_level(level_index, xs, ys, scale, finer_xs, finer_ys);
+    xs.swap(finer_xs);
+    ys.swap(finer_ys);
+
+    level_index--;
+    use_springs_of_level();
+    temperature = ideal_distance;
+    level_steps = 0;
+    level_start = std::chrono::steady_clock::now();
+  }
+}
+
+// Merges nodes pairwise along the lines (each node with its unmatched neighbour of the lowest degree, visiting the nodes
+// in random order) until the graph is small enough or stops shrinking
+void force_layout::coarsen()
+{
+  levels[0].froms = spring_froms;
+  levels[0].tos = spring_tos;
+  levels[0].inverse_lengths = spring_inverse_lengths;
+
+  std::mt19937 random(1);
+
+  while (levels.back().count > coarsest_size)
+  {
+    const level& finer = levels.back();
+    int count = finer.count;
+
+    // Neighbours of every node in one array, node i's being [offsets[i], offsets[i + 1])
+    std::vector<int> offsets(count + 1, 0);
+    for (size_t i = 0; i < finer.froms.size(); i++)
+    {
+      offsets[finer.froms[i] + 1]++;
+      offsets[finer.tos[i] + 1]++;
+    }
+    for (int i = 0; i < count; i++) offsets[i + 1] += offsets[i];
+    std::vector<int> neighbours(offsets[count]);
+    std::vector<int> filled(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < finer.froms.size(); i++)
+    {
+      neighbours[filled[finer.froms[i]]++] = finer.tos[i];
+      neighbours[filled[finer.tos[i]]++] = finer.froms[i];
+    }
+
+    std::vector<int> visit_order(count);
+    std::iota(visit_order.begin(), visit_order.end(), 0);
+    std::shuffle(visit_order.begin(), visit_order.end(), random);
+
+    level coarser;
+    coarser.parents.assign(count, -1);
+    for (const int& node : visit_order)
+    {
+      if (coarser.parents[node] != -1) continue;
+
+      int partner = -1;
+      for (int i = offsets[node]; i < offsets[node + 1]; i++)
+      {
+        int neighbour = neighbours[i];
+        if (coarser.parents[neighbour] != -1) continue;
+        if (partner == -1 or offsets[neighbour + 1] - offsets[neighbour] < offsets[partner + 1] - offsets[partner]) partner = neighbour;
+      }
+
+      coarser.parents[node] = coarser.count;
+      if (partner != -1) coarser.parents[partner] = coarser.count;
+      coarser.count++;
+    }
+
+    // Hardly anything could be merged (i.e. the leaves of a star), another level would only cost time
+    if (coarser.count > count - count / 10) break;
+
+    // The lines between the merged nodes, lines ending up between the same two nodes become one with the average pull
+    std::vector<std::pair<uint64_t, float>> pairs = {};
+    for (size_t i = 0; i < finer.froms.size(); i++)
+    {
+      uint32_t from = coarser.parents[finer.froms[i]];
+      uint32_t to = coarser.parents[finer.tos[i]];
+      if (from == to) continue;
+      pairs.push_back({(uint64_t(std::min(from, to)) << 32) | std::max(from, to), finer.inverse_lengths[i]});
+    }
+    std::sort(pairs.begin(), pairs.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    for (size_t first = 0, last = 0; first < pairs.size(); first = last)
+    {
+      float sum = 0.0f;
+      for (last = first; last < pairs.size() and pairs[last].first == pairs[first].first; last++) sum += pairs[last].second;
+
+      coarser.froms.push_back(int32_t(pairs[first].first >> 32));
+      coarser.tos.push_back(int32_t(pairs[first].first & 0xFFFFFFFF));
+      coarser.inverse_lengths.push_back(sum / float(last - first));
+    }
+
+    levels.push_back(std::move(coarser));
+  }
+}
+
+// Every node of the finer level goes where the node it was merged into is (spread out from the centre by the scale).
+// The first one keeps that spot, the others are put a bit off to the side, in a direction that differs from node to node.
+void force_layout::spread_into_finer_level(int index, const std::vector<float>& coarse_xs, const std::vector<float>& coarse_ys, float scale, std::vector<float>& finer_xs, std::vector<float>& finer_ys) const
+{
+  const level& level = levels[index];
+
+  float centre_x = 0.0f;
+  float centre_y = 0.0f;
+  for (int i = 0; i < level.count; i++)
+  {
+    centre_x += coarse_xs[i] / float(level.count);
+    centre_y += coarse_ys[i] / float(level.count);
+  }
+
+  std::vector<bool> taken(level.count, false);
+  finer_xs.resize(level.parents.size());
+  finer_ys.resize(level.parents.size());
+  for (size_t i = 0; i < level.parents.size(); i++)
+  {
+    int parent = level.parents[i];
+    finer_xs[i] = centre_x + (coarse_xs[parent] - centre_x) * scale;
+    finer_ys[i] = centre_y + (coarse_ys[parent] - centre_y) * scale;
+
+    if (taken[parent])
+    {
+      finer_xs[i] += std::cos(float(i)) * ideal_distance * 0.25f;
+      finer_ys[i] += std::sin(float(i)) * ideal_distance * 0.25f;
+    }
+    taken[parent] = true;
+  }
+}
+
+// The nodes of the graph itself are shown where the coarser nodes they were merged into are, until their level is reached
+void force_layout::show_positions()
+{
+  if (level_index == 0)
+  {
+    next_node_xs = xs;
+    next_node_ys = ys;
+    return;
+  }
+
+  std::vector<float> coarse_xs = xs;
+  std::vector<float> coarse_ys = ys;
+  for (int index = level_index; index > 0; index--)
+  {
+    spread_into_finer_level(index, coarse_xs, coarse_ys, 1.0f, next_node_xs, next_node_ys);
+    coarse_xs.swap(next_node_xs);
+    coarse_ys.swap(next_node_ys);
+  }
+  next_node_xs.swap(coarse_xs);
+  next_node_ys.swap(coarse_ys);
+}
+
+void force_layout::layout_step(float step_cooling)
+{
+  int count = int(xs.size());
+  next_xs.resize(count);
+  next_ys.resize(count);
+
+  // Repulsion, every node only writing its own displacement. Going through the nodes in tree order, so nodes one after
+  // another walk mostly the same cells, which stay in cache.
+  displacement_xs.resize(count);
+  displacement_ys.resize(count);
+  parallel_for(thread_count, count, 256, [&](int first, int last)
+  {
+    for (int i = first; i < last; i++)
+    {
+      olc::vf2d force = repulsion_on(order[i]);
+      displacement_xs[order[i]] = force.x;
+      displacement_ys[order[i]] = force.y;
+    }
+  });
+
+  // Attraction, every thread taking an equal share of the lines and summing their forces up in its own accumulator
+  int spring_count = int(spring_froms.size());
+  int spring_threads = std::max(1, std::min(thread_count, spring_count / 4096));
+  accumulator_xs.resize(spring_threads);
+  accumulator_ys.resize(spring_threads);
+  on_threads(spring_threads, [&](int thread)
+  {
+    accumulator_xs[thread].assign(count, 0.0f);
+    accumulator_ys[thread].assign(count, 0.0f);
+
+    int first = int(int64_t(spring_count) * thread / spring_threads);
+    int last = int(int64_t(spring_count) * (thread + 1) / spring_threads);
+    accumulate_springs(first, last, accumulator_xs[thread].data(), accumulator_ys[thread].data());
+  });
+
+  // Adding the accumulators up and moving the nodes by at most the temperature
+  parallel_for(thread_count, count, 4096, [&](int first, int last)
+  {
+    for (int i = first; i < last; i++)
+    {
+      float x = displacement_xs[i];
+      float y = displacement_ys[i];
+      for (int thread = 0; thread < spring_threads; thread++)
+      {
+        x += accumulator_xs[thread][i];
+        y += accumulator_ys[thread][i];
+      }
+
+      float length = std::sqrt(x * x + y * y);
+      float scale = (length > 0.0f ? std::min(length, temperature) / length : 0.0f);
+      next_xs[i] = xs[i] + x * scale;
+      next_ys[i] = ys[i] + y * scale;
+    }
+  });
+
+  xs.swap(next_xs);
+  ys.swap(next_ys);
+  temperature *= step_cooling;
+}
+
+// Attraction d^2 / k, where k is the rest length of the line, so longer lines pull less and settle further apart
+void force_layout::accumulate_springs(int first, int last, float* accumulator_x, float* accumulator_y) const
+{
+  int i = first;
+
+#if defined(__x86_64__) or defined(__i386__)
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  if (has_avx2) i = accumulate_springs_avx2(spring_froms.data(), spring_tos.data(), spring_inverse_lengths.data(), xs.data(), ys.data(), first, last, accumulator_x, accumulator_y);
+#endif
+
+  // Whatever is left over (or everything without AVX2)
+  for (; i < last; i++)
+  {
+    float dx = xs[spring_tos[i]] - xs[spring_froms[i]];
+    float dy = ys[spring_tos[i]] - ys[spring_froms[i]];
+    float scale = std::sqrt(dx * dx + dy * dy) * spring_inverse_lengths[i];
+    accumulator_x[spring_froms[i]] += dx * scale;
+    accumulator_y[spring_froms[i]] += dy * scale;
+    accumulator_x[spring_tos[i]] -= dx * scale;
+    accumulator_y[spring_tos[i]] -= dy * scale;
+  }
+}
+
+void force_layout::build_tree()
+{
+  olc::vf2d top_left = {xs[0], ys[0]};
+  olc::vf2d bottom_right = {xs[0], ys[0]};
+  for (size_t i = 0; i < xs.size(); i++)
+  {
+    top_left = top_left.min({xs[i], ys[i]});
+    bottom_right = bottom_right.max({xs[i], ys[i]});
+  }
+
+  order.resize(xs.size());
+  std::iota(order.begin(), order.end(), 0);
+
+  tree.clear();
+  tree.emplace_back();
+  build_quad(0, 0, int(order.size()), top_left, std::max(bottom_right.x - top_left.x, bottom_right.y - top_left.y) + 1.0f, 0);
+}
+
+void force_layout::build_quad(int index, int first, int last, const olc::vf2d& corner, float size, int depth)
+{
+  olc::vf2d sum = {0.0f, 0.0f};
+  for (int i = first; i < last; i++) sum += olc::vf2d{xs[order[i]], ys[order[i]]};
+
+  tree[index].mass = float(last - first);
+  tree[index].centre_of_mass = (last > first ? sum / float(last - first) : corner);
+  tree[index].corner = corner;
+  tree[index].size = size;
+
+  if (last - first <= leaf_capacity or depth == max_tree_depth)
+  {
+    tree[index].first = first;
+    tree[index].last = last;
+    return;
+  }
+
+  // Sorting the nodes into the quadrants: first top/bottom, then each half into left/right
+  olc::vf2d middle = corner + olc::vf2d{size, size} * 0.5f;
+  auto begin = order.begin();
+  int bottom = int(std::partition(begin + first, begin + last, [&](int i) { return ys[i] < middle.y; }) - begin);
+  int top_right = int(std::partition(begin + first, begin + bottom, [&](int i) { return xs[i] < middle.x; }) - begin);
+  int bottom_right = int(std::partition(begin + bottom, begin + last, [&](int i) { return xs[i] < middle.x; }) - begin);
+
+  // The tree grows while the children get built, so no reference into it is held across these calls
+  int child = int(tree.size());
+  tree.resize(tree.size() + 4);
+  tree[index].first_child = child;
+
+  float half = size * 0.5f;
+  build_quad(child + 0, first, top_right, corner, half, depth + 1);
+  build_quad(child + 1, top_right, bottom, {middle.x, corner.y}, half, depth + 1);
+  build_quad(child + 2, bottom, bottom_right, {corner.x, middle.y}, half, depth + 1);
+  build_quad(child + 3, bottom_right, last, middle, half, depth + 1);
+}
+
+// Repulsion k^2 / d from every other node, k being the ideal distance
+olc::vf2d force_layout::repulsion_on(int node) const
+{
+  const olc::vf2d position = {xs[node], ys[node]};
+  const float k_squared = ideal_distance * ideal_distance;
+  const float theta_squared = theta * theta;
+  olc::vf2d force = {0.0f, 0.0f};
+
+  int stack[4 * max_tree_depth + 4];
+  int stack_size = 0;
+  stack[stack_size++] = 0;
+
+  while (stack_size > 0)
+  {
+    const quad& quad = tree[stack[--stack_size]];
+    if (quad.mass == 0.0f) continue;
+
+    if (quad.first_child == -1)
+    {
+      for (int i = quad.first; i < quad.last; i++)
+      {
+        if (order[i] == node) continue;
+
+        olc::vf2d delta = position - olc::vf2d{xs[order[i]], ys[order[i]]};
+        float distance_squared = delta.mag2();
+
+        // Nodes on top of each other get pushed apart in a direction that differs from node to node
+        if (distance_squared < 0.01f)
+        {
+          delta = olc::vf2d{std::cos(float(node)), std::sin(float(node))} * 0.1f;
+          distance_squared = 0.01f;
+        }
+
+        force += delta * (k_squared / distance_squared);
+      }
+      continue;
+    }
+
+    // Far enough away (and not containing the node itself), the whole cell acts as one node at its centre of mass
+    olc::vf2d delta = position - quad.centre_of_mass;
+    float distance_squared = delta.mag2();
+    bool inside = position.x >= quad.corner.x and position.y >= quad.corner.y and position.x < quad.corner.x + quad.size and position.y < quad.corner.y + quad.size;
+    if (not inside and quad.size * quad.size < theta_squared * distance_squared)
+    {
+      force += delta * (quad.mass * k_squared / distance_squared);
+      continue;
+    }
+
+    for (int child = 0; child < 4; child++) stack[stack_size++] = quad.first_child + child;
+  }
+
+  return force;
+}
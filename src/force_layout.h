@@ -0,0 +1,201 @@
+#pragma once
+
+#include "olcPixelGameEngine.h"
+#include "compressed_lines.h"
+#include "line.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <thread>
+#include <vector>
+
+// Fruchterman-Reingold force-directed layout: every pair of nodes pushes each other apart, every line pulls its two nodes
+// together, and the nodes move along the sum of those forces by at most a temperature that cools down with every step.
+// The repulsion between all pairs is approximated with a Barnes-Hut quadtree (a group of nodes far enough away acts like
+// a single heavier node at its centre of mass), which makes a step O(n log n) instead of O(n^2).
+//
+// Graphs with more than multilevel_threshold nodes are laid out on several levels: the graph is coarsened over and over
+// by merging nodes along a matching of the lines, the coarsest version is laid out first, and then every level hands its
+// positions down to the next finer one, which only needs a few steps of refining. Until the last level is reached the
+// nodes are shown around where the node they were merged into is, so stopping at any level still leaves a usable picture.
+//
+// Steps run on a background thread which spreads the work over more threads in turn. The positions are double buffered:
+// a step reads the current positions and writes the next ones into the other buffer, and only update() (on the main
+// thread) hands a finished step over to the nodes, so whatever gets painted is always one complete step.
+class force_layout
+{
+public:
+  float ideal_distance = 40.0f; // World units between two nodes joined by a line of length 1
+  float theta = 0.9f; // Groups smaller than theta times their distance are approximated; 0 is exact, higher is faster
+  float cooling = 0.98f; // The temperature is multiplied by this after every step
+  float final_temperature = 0.5f; // A level is done once no node may move further than this (in world units)
+  int thread_count = std::max(1u, std::thread::hardware_concurrency());
+  int multilevel_threshold = 1000; // Graphs with more nodes than this are coarsened first
+  int coarsest_size = 64; // Coarsening stops once a level has no more nodes than this
+  float refine_cooling = 0.9f; // Cooling on the levels that start from the positions of the coarser level
+  float coarse_time_budget = 10.0f; // Milliseconds of steps on the coarser levels that are bundled into one hand-over
+
+  // How laying out a level went; level 0 is the graph itself
+  struct level_report
+  {
+    int level;
+    int node_count;
+    int line_count;
+    int steps;
+    float milliseconds;
+  };
+
+  ~force_layout();
+
+  void start();
+  void stop();
+  bool is_running() const;
+
+  // As of the last step handed over by update(): the level being laid out and the report of every level done so far
+  int current_level() const;
+  const std::vector<level_report>& level_reports() const;
+
+  // Called once per frame. If the step running in the background is done, its positions are written into the nodes
+  // (calling moved(id, from, to) for every node whose position changed) and the next step is started from the nodes and
+  // lines as they are now. Nodes moved by something else in the meantime (i.e. dragged by the user) continue from where
+  // they were put. While a step is still running nothing happens, so a slow step never holds up a frame.
+  //
+  // edit_version has to go up with every change to the nodes or lines made by anything but this layout. As long as it
+  // stays the same, the nodes are what the last step left them as, so the next one starts without copying anything.
+  template<typename function_type>
+  void update(std::map<int, olc::vi2d>& nodes, const std::vector<line>& lines, uint64_t edit_version, function_type&& moved)
+  {
+    if (worker.joinable())
+    {
+      if (not step_done) return;
+
+      worker.join();
+      std::swap(node_xs, next_node_xs);
+      std::swap(node_ys, next_node_ys);
+      shown_level = level_index;
+      shown_reports = reports;
+      if (converged and not first_step) running = false;
+
+      // The nodes might have been added or deleted while the step was running, which makes its result useless, and after
+      // stop() (e.g. the graph having been replaced) it isn't wanted anymore even if the nodes look the same
+      bool discarded = stopped_in_flight;
+      stopped_in_flight = false;
+      if (not discarded and (edit_version == gathered_version or has_same_nodes(nodes)))
+      {
+        size_t i = 0;
+        for (auto& node : nodes)
+        {
+          olc::vi2d to = {int(std::round(node_xs[i])), int(std::round(node_ys[i]))};
+          if (to != node.second)
+          {
+            moved(node.first, node.second, to);
+            node.second = to;
+          }
+          i++;
+        }
+      }
+    }
+
+    if (not running) return;
+
+    if (first_step or edit_version != gathered_version) gather(nodes, lines);
+    gathered_version = edit_version;
+    bool reheat = first_step;
+    first_step = false;
+    step_done = false;
+    worker = std::thread([this, reheat]()
+    {
+      compute_step(reheat);
+      step_done = true;
+    });
+  }
+
+private:
+  // A coarser version of the graph, every node of the next finer level having been merged into one of its nodes
+  struct level
+  {
+    std::vector<int32_t> parents = {}; // For every node of the next finer level, the node of this level it became part of
+    int count = 0;
+    // The lines, as indices into the nodes of this level and 1 / rest length
+    std::vector<int32_t> froms = {};
+    std::vector<int32_t> tos = {};
+    std::vector<float> inverse_lengths = {};
+  };
+
+  // Square cells; the four children of a cell are stored next to each other starting at first_child
+  struct quad
+  {
+    olc::vf2d centre_of_mass = {0.0f, 0.0f};
+    float mass = 0.0f; // The number of nodes inside
+    olc::vf2d corner = {0.0f, 0.0f}; // Top left
+    float size = 0.0f; // Side length
+    int first_child = -1; // -1 for leaves
+    int first = 0; // Leaves only: the nodes order[first, last)
+    int last = 0;
+  };
+
+  bool running = false;
+  bool stopped_in_flight = false; // Whether stop() was called while a step was running, whose result is dropped then
+  bool first_step = false; // Whether the next step starts over (coarsening again) with a high temperature
+  std::thread worker;
+  std::atomic<bool> step_done = false;
+  int shown_level = 0;
+  std::vector<level_report> shown_reports = {};
+  uint64_t gathered_version = 0; // The edit version the nodes and lines were last gathered at
+
+  // Everything below is owned by the worker while a step is running
+  std::vector<int> ids = {};
+  bool nodes_changed = false;
+  // The lines are only copied when they or the nodes changed, and compressed into graph by the worker (which keeps that
+  // work off the main thread), the copy being let go of then
+  std::vector<line> lines_snapshot = {};
+  bool lines_gathered = false;
+  uint64_t lines_fingerprint = 0;
+  compressed_lines graph = {}; // The lines by index into ids, which the springs of the graph itself are built from
+  // Positions of the nodes themselves; the shown ones and the ones being computed
+  std::vector<float> node_xs = {};
+  std::vector<float> node_ys = {};
+  std::vector<float> next_node_xs = {};
+  std::vector<float> next_node_ys = {};
+  std::vector<level> levels = {}; // The graph itself first, then coarser and coarser
+  int level_index = 0; // The level being laid out
+  float temperature = 0.0f;
+  bool converged = false;
+  int level_steps = 0;
+  std::chrono::steady_clock::time_point level_start = {};
+  std::vector<level_report> reports = {};
+  // Positions on the level being laid out, as separate x and y arrays (for the vectorised passes), the current ones and
+  // the ones being computed
+  std::vector<float> xs = {};
+  std::vector<float> ys = {};
+  std::vector<float> next_xs = {};
+  std::vector<float> next_ys = {};
+  std::vector<float> displacement_xs = {};
+  std::vector<float> displacement_ys = {};
+  // Lines of the level being laid out, as indices into the positions and 1 / rest length
+  std::vector<int32_t> spring_froms = {};
+  std::vector<int32_t> spring_tos = {};
+  std::vector<float> spring_inverse_lengths = {};
+  // Every thread sums up the spring forces of its share of the lines on its own, they get added together afterwards
+  std::vector<std::vector<float>> accumulator_xs = {};
+  std::vector<std::vector<float>> accumulator_ys = {};
+  std::vector<quad> tree = {};
+  std::vector<int> order = {};
+
+  bool has_same_nodes(const std::map<int, olc::vi2d>& nodes) const;
+  void gather(const std::map<int, olc::vi2d>& nodes, const std::vector<line>& lines);
+  void compute_step(bool reheat);
+  void build_springs();
+  void finish_level();
+  void coarsen();
+  void spread_into_finer_level(int index, const std::vector<float>& coarse_xs, const std::vector<float>& coarse_ys, float scale, std::vector<float>& finer_xs, std::vector<float>& finer_ys) const;
+  void use_springs_of_level();
+  void show_positions();
+  void layout_step(float step_cooling);
+  void accumulate_springs(int first, int last, float* accumulator_x, float* accumulator_y) const;
+  void build_tree();
+  void build_quad(int index, int first, int last, const olc::vf2d& corner, float size, int depth);
+  olc::vf2d repulsion_on(int node) const;
+};
@@ -0,0 +1,37 @@
+#include "graph_export.h"
+#include "buffered_writer.h"
+
+bool graph_export::write_dot(const std::string& path, const std::map<int, olc::vi2d>& nodes, const std::vector<line>& lines, std::string& error)
+{
+  buffered_writer out;
+  if (not out.open(path, error)) return false;
+
+  out << "digraph G {\n";
+  out << "  node [shape=circle];\n";
+  for (const auto& [id, position] : nodes) out << "  " << id << " [pos=\"" << position.x << ',' << -position.y << "!\"];\n";
+  for (const line& line : lines) out << "  " << line.from << " -> " << line.to << " [len=" << line.length << "];\n";
+  out << "}\n";
+
+  return out.close(error);
+}
+
+bool graph_export::write_graphml(const std::string& path, const std::map<int, olc::vi2d>& nodes, const std::vector<line>& lines, std::string& error)
+{
+  buffered_writer out;
+  if (not out.open(path, error)) return false;
+
+  out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+  out << "<graphml xmlns=\"http://graphml.graphdrawing.org/xmlns\">\n";
+  out << "  <key id=\"x\" for=\"node\" attr.name=\"x\" attr.type=\"int\"/>\n";
+  out << "  <key id=\"y\" for=\"node\" attr.name=\"y\" attr.type=\"int\"/>\n";
+  out << "  <key id=\"length\" for=\"edge\" attr.name=\"length\" attr.type=\"int\"/>\n";
+  out << "  <graph id=\"G\" edgedefault=\"directed\">\n";
+  for (const auto& [id, position] : nodes)
+    out << "    <node id=\"n" << id << "\"><data key=\"x\">" << position.x << "</data><data key=\"y\">" << position.y << "</data></node>\n";
+  for (const line& line : lines)
+    out << "    <edge source=\"n" << line.from << "\" target=\"n" << line.to << "\"><data key=\"length\">" << line.length << "</data></edge>\n";
+  out << "  </graph>\n";
+  out << "</graphml>\n";
+
+  return out.close(error);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "olcPixelGameEngine.h"
+#include "line.h"
+#include <map>
+#include <string>
+#include <vector>
+
+// Exports the graph for other tools, streaming it through a buffered_writer element by element, so the memory needed
+// doesn't grow with the graph. Nodes keep their IDs and positions, lines their direction and length.
+namespace graph_export
+{
+  // Graphviz: a digraph with every node pinned at its position (y pointing up, as Graphviz has it) and the line lengths
+  // as len, the length neato aims for
+  bool write_dot(const std::string& path, const std::map<int, olc::vi2d>& nodes, const std::vector<line>& lines, std::string& error);
+
+  // GraphML: a directed graph with x and y as node data and length as edge data
+  bool write_graphml(const std::string& path, const std::map<int, olc::vi2d>& nodes, const std::vector<line>& lines, std::string& error);
+}
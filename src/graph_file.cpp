@@ -0,0 +1,168 @@
+#include "graph_file.h"
+#include "compressed_lines.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fstream>
+
+static_assert(sizeof(graph_file::header) == 32 and sizeof(graph_file::node_record) == 12 and sizeof(graph_file::line_record) == 12);
+
+bool graph_file::is_graph_file(const std::string& path)
+{
+  char start[sizeof(magic)] = {};
+  std::ifstream file(path, std::ios::binary);
+  file.read(start, sizeof(start));
+  return file and std::equal(std::begin(magic), std::end(magic), start);
+}
+
+bool graph_file::save(const std::string& path, const std::map<int, olc::vi2d>& nodes, const std::vector<line>& lines, std::string& error)
+{
+  std::vector<node_record> records = {};
+  records.reserve(nodes.size());
+  for (const auto& [id, position] : nodes) records.push_back({id, position.x, position.y});
+  return save(path, records, lines, error);
+}
+
+bool graph_file::save(const std::string& path, const std::vector<node_record>& nodes, const std::vector<line>& lines, std::string& error)
+{
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (not file)
+  {
+    error = std::strerror(errno);
+    return false;
+  }
+
+  header header = {};
+  std::copy(std::begin(magic), std::end(magic), header.magic);
+  header.version = version;
+  header.byte_order_mark = byte_order_mark;
+  header.node_count = nodes.size();
+
+  // Lines that don't join two of the nodes aren't stored, so the count is what the compressed lines hold
+  std::vector<int> ids = {};
+  ids.reserve(nodes.size());
+  for (const node_record& node : nodes) ids.push_back(node.id);
+  compressed_lines compressed(std::move(ids), lines);
+  header.line_count = uint64_t(compressed.line_count());
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(nodes.data()), std::streamsize(nodes.size() * sizeof(node_record)));
+  file.write(reinterpret_cast<const char*>(compressed.bytes().data()), std::streamsize(compressed.bytes().size()));
+
+  file.close();
+  if (not file)
+  {
+    error = "could not write the file";
+    return false;
+  }
+  return true;
+}
+
+bool graph_file::load(const std::string& path, std::map<int, olc::vi2d>& nodes, std::vector<line>& lines, std::string& error)
+{
+  mapped_file file;
+  if (not file.open(path, error)) return false;
+  if (file.size() < sizeof(header))
+  {
+    error = "too small to be a graph file";
+    return false;
+  }
+
+  header header;
+  std::memcpy(&header, file.data(), sizeof(header));
+  if (not std::equal(std::begin(magic), std::end(magic), header.magic))
+  {
+    error = "not a graph file";
+    return false;
+  }
+  if (header.byte_order_mark != byte_order_mark)
+  {
+    error = "written with a different byte order";
+    return false;
+  }
+  if (header.version != 1 and header.version != 2)
+  {
+    error = "unsupported version " + std::to_string(header.version);
+    return false;
+  }
+
+  // Checking the counts one at a time keeps the expected size from overflowing
+  size_t record_space = file.size() - sizeof(header);
+  if (header.node_count > uint64_t(INT_MAX) or header.node_count > record_space / sizeof(node_record))
+  {
+    error = "the file is shorter than its node count says";
+    return false;
+  }
+  record_space -= size_t(header.node_count) * sizeof(node_record);
+  if (header.version == 1 and (record_space % sizeof(line_record) != 0 or header.line_count != record_space / sizeof(line_record)))
+  {
+    error = "the file size does not match its line count";
+    return false;
+  }
+  if (header.line_count > uint64_t(INT_MAX))
+  {
+    error = "more lines than the app can hold";
+    return false;
+  }
+
+  // The records start right after the 32 byte header and are 12 bytes each, so they are 4 byte aligned within the page
+  // aligned mapping and can be read in place
+  size_t node_count = size_t(header.node_count);
+  size_t line_count = size_t(header.line_count);
+  const node_record* node_records = reinterpret_cast<const node_record*>(file.data() + sizeof(header));
+  const char* line_data = reinterpret_cast<const char*>(node_records + node_count);
+
+  for (size_t i = 0; i < node_count; i++)
+  {
+    if (node_records[i].id <= 0 or (i > 0 and node_records[i].id <= node_records[i - 1].id))
+    {
+      error = "node " + std::to_string(i) + " has an ID out of order";
+      return false;
+    }
+  }
+
+  std::vector<line> loaded_lines = {};
+  if (header.version == 1)
+  {
+    // Positive ascending IDs are exactly 1 to n if the last one is n, which is what the app hands out; only otherwise do
+    // the line ends have to be looked up
+    bool dense = (node_count == 0 or size_t(node_records[node_count - 1].id) == node_count);
+    auto has_node = [&](int id)
+    {
+      if (dense) return id >= 1 and size_t(id) <= node_count;
+      const node_record* found = std::lower_bound(node_records, node_records + node_count, id, [](const node_record& record, int id) { return record.id < id; });
+      return found != node_records + node_count and found->id == id;
+    };
+
+    const line_record* line_records = reinterpret_cast<const line_record*>(line_data);
+    loaded_lines.reserve(line_count);
+    for (size_t i = 0; i < line_count; i++)
+    {
+      const line_record& record = line_records[i];
+      if (not has_node(record.from) or not has_node(record.to) or record.length < 1 or record.length > 99)
+      {
+        error = "line " + std::to_string(i) + " is invalid";
+        return false;
+      }
+      loaded_lines.emplace_back(record.from, record.to, record.length);
+    }
+  }
+  else
+  {
+    std::vector<int> ids(node_count);
+    for (size_t i = 0; i < node_count; i++) ids[i] = node_records[i].id;
+
+    compressed_lines compressed;
+    if (not compressed.assign(std::move(ids), reinterpret_cast<const uint8_t*>(line_data), record_space, int64_t(line_count), error)) return false;
+    loaded_lines = compressed.to_lines();
+  }
+
+  // Sorted already, so every node goes right at the end of the map
+  std::map<int, olc::vi2d> loaded_nodes = {};
+  for (size_t i = 0; i < node_count; i++) loaded_nodes.emplace_hint(loaded_nodes.end(), node_records[i].id, olc::vi2d{node_records[i].x, node_records[i].y});
+
+  nodes.swap(loaded_nodes);
+  lines.swap(loaded_lines);
+  return true;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "olcPixelGameEngine.h"
+#include "line.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// The binary graph file: a header followed by the nodes and then the lines. The nodes are fixed size little endian
+// records laid out exactly like they are read, so loading maps the file into memory and goes through them in place instead
+// of parsing them. They are stored sorted by ID (the order of the map).
+//
+//   header:  "PGEGRAPH", version, byte order mark (0x01020304), node count, line count
+//   nodes:   node count times {ID, x, y}
+//   lines:   version 1: line count times {from, to, length}
+//            version 2: the byte stream of compressed_lines, 2 to 3 bytes per line for most graphs
+//
+// Files are written as version 2, both versions are read. A file only loads if its size matches the counts exactly, the
+// IDs are positive and ascending and every line joins two of its nodes with a length from 1 to 99. Loading fails as a
+// whole, leaving the graph it was meant to replace untouched.
+namespace graph_file
+{
+  constexpr char magic[8] = {'P', 'G', 'E', 'G', 'R', 'A', 'P', 'H'};
+  constexpr uint32_t version = 2; // Of the files written
+  constexpr uint32_t byte_order_mark = 0x01020304;
+
+  struct header
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order_mark;
+    uint64_t node_count;
+    uint64_t line_count;
+  };
+
+  struct node_record
+  {
+    int32_t id;
+    int32_t x;
+    int32_t y;
+  };
+
+  struct line_record
+  {
+    int32_t from;
+    int32_t to;
+    int32_t length;
+  };
+
+  // Whether the file starts like a graph file (anything else is taken for an edge list)
+  bool is_graph_file(const std::string& path);
+
+  // All return false and describe what went wrong in error if they fail
+  bool save(const std::string& path, const std::map<int, olc::vi2d>& nodes, const std::vector<line>& lines, std::string& error);
+  // The nodes as records, sorted by ID
+  bool save(const std::string& path, const std::vector<node_record>& nodes, const std::vector<line>& lines, std::string& error);
+  bool load(const std::string& path, std::map<int, olc::vi2d>& nodes, std::vector<line>& lines, std::string& error);
+}
@@ -0,0 +1,111 @@
+#include "graph_snapshot.h"
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+  // Items copied between two looks at the clock
+  constexpr int nodes_per_check = 1024;
+  constexpr size_t lines_per_check = 16'384;
+}
+
+void graph_snapshot::start(const std::map<int, olc::vi2d>& nodes, const std::vector<line>& lines, uint64_t version, uint64_t structure_version)
+{
+  copying = true;
+  copied_version = version;
+  copied_structure_version = structure_version;
+  next_moved = 0;
+  next_node = nodes.begin();
+  next_line = 0;
+  node_copies.clear();
+  node_copies.reserve(nodes.size());
+  line_copies.clear();
+  line_copies.reserve(lines.size());
+  copy_frames = 0;
+  copy_milliseconds = 0.0f;
+}
+
+bool graph_snapshot::copy_some(const std::map<int, olc::vi2d>& nodes, const std::vector<line>& lines, uint64_t version, uint64_t structure_version, float budget)
+{
+  // Starting over doesn't forget what the earlier attempts cost
+  if (structure_version != copied_structure_version)
+  {
+    int frames = copy_frames;
+    float milliseconds = copy_milliseconds;
+    start(nodes, lines, version, structure_version);
+    copy_frames = frames;
+    copy_milliseconds = milliseconds;
+  }
+  // Whatever else changed were moves, which the copy has kept up with
+  copied_version = version;
+
+  auto started = std::chrono::steady_clock::now();
+  auto deadline = started + std::chrono::duration<float, std::milli>(budget);
+  copy_frames++;
+  auto out_of_time = [&]()
+  {
+    auto now = std::chrono::steady_clock::now();
+    if (now < deadline) return false;
+    copy_milliseconds += std::chrono::duration<float, std::milli>(now - started).count();
+    return true;
+  };
+
+  while (next_node != nodes.end())
+  {
+    for (int k = 0; k < nodes_per_check and next_node != nodes.end(); k++, next_node++)
+    {
+      node_copies.push_back({next_node->first, next_node->second.x, next_node->second.y});
+    }
+    if (out_of_time()) return false;
+  }
+
+  while (next_line < lines.size())
+  {
+    size_t last = std::min(lines.size(), next_line + lines_per_check);
+    line_copies.insert(line_copies.end(), lines.begin() + std::ptrdiff_t(next_line), lines.begin() + std::ptrdiff_t(last));
+    next_line = last;
+    if (next_line < lines.size() and out_of_time()) return false;
+  }
+
+  copying = false;
+  copy_milliseconds += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - started).count();
+  return true;
+}
+
+void graph_snapshot::moved(int id, const olc::vi2d& to)
+{
+  // Nodes that haven't been copied yet are copied where they are once they are
+  if (not copying or node_copies.empty() or id > node_copies.back().id) return;
+
+  // Galloping from where the last one was: steps twice as long every time until one goes past the node, which leaves only
+  // a short range to search when the node is close by
+  size_t low = 0;
+  size_t high = node_copies.size();
+  if (next_moved < high and node_copies[next_moved].id <= id)
+  {
+    low = next_moved;
+    for (size_t step = 1; low + step < high; step *= 2)
+    {
+      if (node_copies[low + step].id > id)
+      {
+        high = low + step;
+        break;
+      }
+      low += step;
+    }
+  }
+  auto by_id = [](const graph_file::node_record& node, int id) { return node.id < id; };
+  size_t index = size_t(std::lower_bound(node_copies.begin() + std::ptrdiff_t(low), node_copies.begin() + std::ptrdiff_t(high), id, by_id) - node_copies.begin());
+  if (index == node_copies.size() or node_copies[index].id != id) return;
+
+  node_copies[index].x = to.x;
+  node_copies[index].y = to.y;
+  next_moved = index + 1;
+}
+
+void graph_snapshot::release()
+{
+  copying = false;
+  node_copies = {};
+  line_copies = {};
+}
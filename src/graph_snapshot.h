@@ -0,0 +1,56 @@
+#pragma once
+
+#include "olcPixelGameEngine.h"
+#include "graph_file.h"
+#include "line.h"
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// A copy of the graph for a background thread to work from, taken a little every frame so that it costs the frames the
+// same however big the graph is. Nodes moving while it is being taken (a layout running or the user dragging them) don't
+// make the copy start over, which would keep it from ever being complete while they do: every move is handed to moved(),
+// which brings the nodes copied so far up to date, and the ones still to come are copied as they are by then. Only a change
+// to which nodes and lines there are (their structure version going up) starts the copy over. Either way a complete
+// snapshot is the graph as it was at one version, the one it had when the copy was completed.
+//
+// The nodes are stored as graph file records, sorted by ID, which is what the background threads write out anyway.
+class graph_snapshot
+{
+public:
+  // Starts copying the graph at the versions, dropping whatever was copied before
+  void start(const std::map<int, olc::vi2d>& nodes, const std::vector<line>& lines, uint64_t version, uint64_t structure_version);
+
+  // Copies for up to budget milliseconds, starting over first if the graph's structure isn't at the version being copied
+  // anymore. Returns true once the snapshot is complete, as of the version.
+  bool copy_some(const std::map<int, olc::vi2d>& nodes, const std::vector<line>& lines, uint64_t version, uint64_t structure_version, float budget);
+
+  // Has to be called for every node moving while a copy is being taken. Moves come in the order of the nodes' IDs for the
+  // most part (which is how the layouts hand them over), so the node after the last one moved is looked at first.
+  void moved(int id, const olc::vi2d& to);
+
+  // Whether a copy has been started and isn't complete yet
+  bool is_copying() const { return copying; }
+
+  // Drops the snapshot, along with its memory
+  void release();
+
+  // Once complete: the graph, its version and what taking the snapshot cost
+  const std::vector<graph_file::node_record>& nodes() const { return node_copies; }
+  const std::vector<line>& lines() const { return line_copies; }
+  uint64_t version() const { return copied_version; }
+  int frames() const { return copy_frames; }
+  float milliseconds() const { return copy_milliseconds; }
+
+private:
+  bool copying = false;
+  uint64_t copied_version = 0;
+  uint64_t copied_structure_version = 0;
+  size_t next_moved = 0; // Where among the copies the node after the last one moved is
+  std::map<int, olc::vi2d>::const_iterator next_node = {};
+  size_t next_line = 0;
+  std::vector<graph_file::node_record> node_copies = {};
+  std::vector<line> line_copies = {};
+  int copy_frames = 0;
+  float copy_milliseconds = 0.0f;
+};
@@ -0,0 +1,470 @@
+#include "layered_layout.h"
+#include "parallel.h"
+#include <algorithm>
+#include <random>
+
+layered_layout::~layered_layout()
+{
+  if (worker.joinable()) worker.join();
+}
+
+void layered_layout::start()
+{
+  running = true;
+  first_step = true;
+}
+
+void layered_layout::stop()
+{
+  running = false;
+  if (worker.joinable()) stopped_in_flight = true;
+}
+
+bool layered_layout::is_running() const
+{
+  return running;
+}
+
+int64_t layered_layout::crossing_count() const
+{
+  return shown_crossings;
+}
+
+bool layered_layout::has_same_nodes(const std::map<int, olc::vi2d>& nodes) const
+{
+  if (ids.size() != nodes.size()) return false;
+
+  size_t i = 0;
+  for (const auto& node : nodes)
+    if (ids[i++] != node.first) return false;
+
+  return true;
+}
+
+void layered_layout::gather(const std::map<int, olc::vi2d>& nodes, const std::vector<line>& lines)
+{
+  ids.clear();
+  xs.clear();
+  ys.clear();
+  centre = {0.0f, 0.0f};
+  for (const auto& node : nodes)
+  {
+    ids.push_back(node.first);
+    xs.push_back(float(node.second.x));
+    ys.push_back(float(node.second.y));
+    centre += olc::vf2d(node.second) / float(nodes.size());
+  }
+  lines_snapshot = lines;
+}
+
+void layered_layout::compute_step(bool restart)
+{
+  next_xs = xs;
+  next_ys = ys;
+  if (ids.empty())
+  {
+    converged = true;
+    return;
+  }
+
+  std::vector<int> positions(layer_of.size());
+  if (restart)
+  {
+    build_layers();
+    positions.resize(layer_of.size());
+    best = candidates[0];
+    best_crossings = count_crossings(best, positions);
+    sweeps = 0;
+    sweeps_without_progress = 0;
+    converged = (best_crossings == 0);
+    place(best);
+    return;
+  }
+
+  // Every thread sweeps its own ordering down and up again
+  std::vector<int64_t> crossings(candidates.size());
+  on_threads(int(candidates.size()), [&](int thread)
+  {
+    std::vector<int> thread_positions(layer_of.size());
+    sweep(candidates[thread], true, thread_positions);
+    sweep(candidates[thread], false, thread_positions);
+    crossings[thread] = count_crossings(candidates[thread], thread_positions);
+  });
+
+  size_t fewest = std::min_element(crossings.begin(), crossings.end()) - crossings.begin();
+  if (crossings[fewest] < best_crossings)
+  {
+    best = candidates[fewest];
+    best_crossings = crossings[fewest];
+    sweeps_without_progress = 0;
+  }
+  else sweeps_without_progress++;
+
+  sweeps++;
+  converged = best_crossings == 0 or sweeps >= max_sweeps or sweeps_without_progress >= 2;
+  place(best);
+}
+
+void layered_layout::build_layers()
+{
+  int count = int(ids.size());
+
+  // The lines going out of every node, the copy of them isn't needed anymore after this
+  compressed_lines graph(ids, lines_snapshot, false, thread_count);
+  std::vector<line>().swap(lines_snapshot);
+
+  // Breaking the cycles: a depth first search turns around every line leading back to a node it is still inside of,
+  // which leaves no cycles. The stack holds the nodes being inside of, each with where it is at in going through its
+  // lines. Loops are left out.
+  std::vector<int> sources = {};
+  std::vector<int> sinks = {};
+  sources.reserve(size_t(graph.line_count()));
+  sinks.reserve(size_t(graph.line_count()));
+  std::vector<char> state(count, 0); // 0 not visited yet, 1 being inside of it, 2 done
+  std::vector<std::pair<int, compressed_lines::line_cursor>> stack = {};
+  for (int root = 0; root < count; root++)
+  {
+    if (state[root] != 0) continue;
+
+    state[root] = 1;
+    stack.push_back({root, graph.lines_of(root)});
+    while (not stack.empty())
+    {
+      auto& [node, cursor] = stack.back();
+      int target = 0;
+      int length = 0;
+      if (not cursor.next(target, length))
+      {
+        state[node] = 2;
+        stack.pop_back();
+        continue;
+      }
+      if (target == node) continue;
+
+      bool closes_cycle = (state[target] == 1);
+      sources.push_back(closes_cycle ? target : node);
+      sinks.push_back(closes_cycle ? node : target);
+      if (state[target] == 0)
+      {
+        state[target] = 1;
+        stack.push_back({target, graph.lines_of(target)});
+      }
+    }
+  }
+
+  // The lines both ways, and the nodes in topological order (every node after all of the ones pointing to it)
+  std::vector<int> out_offsets(count + 1, 0);
+  std::vector<int> in_offsets(count + 1, 0);
+  for (size_t edge = 0; edge < sources.size(); edge++)
+  {
+    out_offsets[sources[edge] + 1]++;
+    in_offsets[sinks[edge] + 1]++;
+  }
+  for (int i = 0; i < count; i++)
+  {
+    out_offsets[i + 1] += out_offsets[i];
+    in_offsets[i + 1] += in_offsets[i];
+  }
+  std::vector<int> out_targets(sources.size());
+  std::vector<int> in_sources(sources.size());
+  std::vector<int> filled(out_offsets.begin(), out_offsets.end() - 1);
+  std::vector<int> filled_in(in_offsets.begin(), in_offsets.end() - 1);
+  for (size_t edge = 0; edge < sources.size(); edge++)
+  {
+    out_targets[filled[sources[edge]]++] = sinks[edge];
+    in_sources[filled_in[sinks[edge]]++] = sources[edge];
+  }
+
+  std::vector<int> topological = {};
+  std::vector<int> remaining(count);
+  for (int i = 0; i < count; i++)
+  {
+    remaining[i] = in_offsets[i + 1] - in_offsets[i];
+    if (remaining[i] == 0) topological.push_back(i);
+  }
+  for (size_t next = 0; next < topological.size(); next++)
+  {
+    int node = topological[next];
+    for (int edge = out_offsets[node]; edge < out_offsets[node + 1]; edge++)
+      if (--remaining[out_targets[edge]] == 0) topological.push_back(out_targets[edge]);
+  }
+
+  // The longest path makes lines span far more layers than they need to (and with that, adds plenty of dummy nodes).
+  // Every node is moved to the layer that makes its lines as short as they can be, which is the median of the layers right
+  // below the nodes pointing to it and right above the ones it points to, as far as it can go without a line pointing
+  // upwards or within a layer. That is done back and forth in topological order until nothing moves anymore. This is what
+  // network simplex layering minimises, but it only goes as far as moving one node at a time can go: a group of nodes
+  // that would have to move together stays where it is. Returns the number of layers all lines span together.
+  std::vector<int> wanted = {};
+  auto shorten = [&](std::vector<int>& layers)
+  {
+    for (int round = 0; round < layering_rounds; round++)
+    {
+      bool anything_moved = false;
+      for (int k = 0; k < count; k++)
+      {
+        int node = topological[round % 2 == 0 ? count - 1 - k : k];
+        int lowest = INT32_MIN;
+        int highest = INT32_MAX;
+        wanted.clear();
+        for (int edge = in_offsets[node]; edge < in_offsets[node + 1]; edge++)
+        {
+          lowest = std::max(lowest, layers[in_sources[edge]] + 1);
+          wanted.push_back(layers[in_sources[edge]] + 1);
+        }
+        for (int edge = out_offsets[node]; edge < out_offsets[node + 1]; edge++)
+        {
+          highest = std::min(highest, layers[out_targets[edge]] - 1);
+          wanted.push_back(layers[out_targets[edge]] - 1);
+        }
+        if (wanted.empty()) continue;
+
+        std::nth_element(wanted.begin(), wanted.begin() + wanted.size() / 2, wanted.end());
+        int layer = std::clamp(wanted[wanted.size() / 2], lowest, highest);
+        if (layer == layers[node]) continue;
+
+        layers[node] = layer;
+        anything_moved = true;
+      }
+      if (not anything_moved) break;
+    }
+
+    int64_t spans = 0;
+    for (size_t edge = 0; edge < sources.size(); edge++) spans += layers[sinks[edge]] - layers[sources[edge]];
+    return spans;
+  };
+
+  // Starting out from both longest path layerings, every node as high as it can go and every node as low as it can go, as
+  // those get stuck in different places; the one ending up with the shorter lines is kept
+  std::vector<int> from_top(count, 0);
+  for (int node : topological)
+    for (int edge = out_offsets[node]; edge < out_offsets[node + 1]; edge++) from_top[out_targets[edge]] = std::max(from_top[out_targets[edge]], from_top[node] + 1);
+  std::vector<int> from_bottom(count, 0);
+  for (int k = count - 1; k >= 0; k--)
+  {
+    int node = topological[k];
+    for (int edge = in_offsets[node]; edge < in_offsets[node + 1]; edge++) from_bottom[in_sources[edge]] = std::min(from_bottom[in_sources[edge]], from_bottom[node] - 1);
+  }
+  layer_of = (shorten(from_top) <= shorten(from_bottom) ? from_top : from_bottom);
+
+  // Layers are counted from the top one
+  int top = *std::min_element(layer_of.begin(), layer_of.end());
+  for (int& layer : layer_of) layer -= top;
+
+  // Splitting lines spanning several layers by a dummy node on every layer in between
+  std::vector<std::pair<int, int>> segments = {};
+  for (size_t edge = 0; edge < sources.size(); edge++)
+  {
+    int upper = sources[edge];
+    for (int layer = layer_of[sources[edge]] + 1; layer < layer_of[sinks[edge]]; layer++)
+    {
+      int dummy = int(layer_of.size());
+      layer_of.push_back(layer);
+      segments.push_back({upper, dummy});
+      upper = dummy;
+    }
+    segments.push_back({upper, sinks[edge]});
+  }
+
+  int total = int(layer_of.size());
+  layer_count = *std::max_element(layer_of.begin(), layer_of.end()) + 1;
+  up_offsets.assign(total + 1, 0);
+  down_offsets.assign(total + 1, 0);
+  for (const auto& [upper, lower] : segments)
+  {
+    down_offsets[upper + 1]++;
+    up_offsets[lower + 1]++;
+  }
+  for (int i = 0; i < total; i++)
+  {
+    up_offsets[i + 1] += up_offsets[i];
+    down_offsets[i + 1] += down_offsets[i];
+  }
+  up_neighbours.resize(segments.size());
+  down_neighbours.resize(segments.size());
+  std::vector<int> filled_up(up_offsets.begin(), up_offsets.end() - 1);
+  std::vector<int> filled_down(down_offsets.begin(), down_offsets.end() - 1);
+  for (const auto& [upper, lower] : segments)
+  {
+    down_neighbours[filled_down[upper]++] = lower;
+    up_neighbours[filled_up[lower]++] = upper;
+  }
+
+  // The first ordering is the one a depth first search downwards finds the nodes in, starting from the top layers, which
+  // keeps what hangs from the same node together
+  ordering first(layer_count);
+  std::vector<int> roots(total);
+  for (int i = 0; i < total; i++) roots[i] = i;
+  std::stable_sort(roots.begin(), roots.end(), [&](int a, int b) { return layer_of[a] < layer_of[b]; });
+  std::vector<char> visited(total, 0);
+  std::vector<int> pending = {};
+  for (int root : roots)
+  {
+    if (visited[root]) continue;
+
+    visited[root] = 1;
+    pending.push_back(root);
+    while (not pending.empty())
+    {
+      int node = pending.back();
+      pending.pop_back();
+      first[layer_of[node]].push_back(node);
+
+      // Pushed the other way around, so the first line is followed first
+      for (int edge = down_offsets[node + 1] - 1; edge >= down_offsets[node]; edge--)
+      {
+        int lower = down_neighbours[edge];
+        if (visited[lower]) continue;
+
+        visited[lower] = 1;
+        pending.push_back(lower);
+      }
+    }
+  }
+
+  // The other threads start out from shuffled layers, which finds orderings the first one can't be swept into
+  candidates.assign(std::max(1, thread_count), first);
+  for (size_t thread = 1; thread < candidates.size(); thread++)
+  {
+    std::mt19937 random{uint32_t(thread)};
+    for (auto& layer : candidates[thread]) std::shuffle(layer.begin(), layer.end(), random);
+  }
+}
+
+// Sorts every layer by the average position of the nodes' neighbours in the layer before, going down from the top or up
+// from the bottom; nodes without any neighbours there stay where they are
+void layered_layout::sweep(ordering& layers, bool downwards, std::vector<int>& positions) const
+{
+  for (const auto& layer : layers)
+    for (int i = 0; i < int(layer.size()); i++) positions[layer[i]] = i;
+
+  const std::vector<int>& offsets = (downwards ? up_offsets : down_offsets);
+  const std::vector<int>& neighbours = (downwards ? up_neighbours : down_neighbours);
+
+  std::vector<std::pair<float, int>> keys = {};
+  for (int step = 1; step < layer_count; step++)
+  {
+    auto& layer = layers[downwards ? step : layer_count - 1 - step];
+
+    keys.clear();
+    for (int i = 0; i < int(layer.size()); i++)
+    {
+      int node = layer[i];
+      int first = offsets[node];
+      int last = offsets[node + 1];
+
+      float sum = 0.0f;
+      for (int edge = first; edge < last; edge++) sum += float(positions[neighbours[edge]]);
+      keys.push_back({(last > first ? sum / float(last - first) : float(i)), node});
+    }
+    std::stable_sort(keys.begin(), keys.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    for (int i = 0; i < int(layer.size()); i++)
+    {
+      layer[i] = keys[i].second;
+      positions[layer[i]] = i;
+    }
+  }
+}
+
+// Counts the crossings between every two neighbouring layers by going through the lines sorted by their upper end and then
+// by their lower end: every line crosses the ones before it whose lower end lies further right (Barth, Juenger and Mutzel)
+int64_t layered_layout::count_crossings(const ordering& layers, std::vector<int>& positions) const
+{
+  for (const auto& layer : layers)
+    for (int i = 0; i < int(layer.size()); i++) positions[layer[i]] = i;
+
+  int64_t crossings = 0;
+  std::vector<int> tree = {}; // Binary indexed tree counting the lower ends so far, by position
+  std::vector<int> lower_ends = {};
+  for (int upper = 0; upper + 1 < layer_count; upper++)
+  {
+    int width = int(layers[upper + 1].size());
+    tree.assign(width + 1, 0);
+    int64_t so_far = 0;
+
+    for (int node : layers[upper])
+    {
+      lower_ends.clear();
+      for (int edge = down_offsets[node]; edge < down_offsets[node + 1]; edge++) lower_ends.push_back(positions[down_neighbours[edge]]);
+      std::sort(lower_ends.begin(), lower_ends.end());
+
+      for (int end : lower_ends)
+      {
+        int64_t at_most = 0;
+        for (int i = end + 1; i > 0; i -= i & -i) at_most += tree[i];
+        crossings += so_far - at_most;
+
+        for (int i = end + 1; i <= width; i += i & -i) tree[i]++;
+        so_far++;
+      }
+    }
+  }
+
+  return crossings;
+}
+
+// Moves every node towards the average of its neighbours above and below while keeping the order of its layer and the
+// node distance: shifting the i-th node's target left by i node distances turns that into fitting a non-decreasing
+// sequence, which pooling adjacent violators does exactly. Layers only look at the layers next to them, so all odd layers
+// can be placed at the same time, and then all even ones.
+void layered_layout::place(const ordering& layers)
+{
+  int total = int(layer_of.size());
+  std::vector<float> x(total);
+  for (const auto& layer : layers)
+    for (int i = 0; i < int(layer.size()); i++) x[layer[i]] = (float(i) - float(layer.size() - 1) / 2.0f) * node_distance;
+
+  for (int round = 0; round < placement_rounds; round++)
+    for (int parity = 0; parity < 2; parity++)
+    {
+      int half = (layer_count - parity + 1) / 2;
+      parallel_for(thread_count, half, 16, [&](int first, int last)
+      {
+        std::vector<float> targets = {};
+        std::vector<std::pair<float, int>> blocks = {}; // Sum and count of the pooled targets
+        for (int index = first; index < last; index++)
+        {
+          const auto& layer = layers[2 * index + parity];
+
+          targets.clear();
+          for (int i = 0; i < int(layer.size()); i++)
+          {
+            int node = layer[i];
+            float sum = 0.0f;
+            int neighbour_count = 0;
+            for (int edge = up_offsets[node]; edge < up_offsets[node + 1]; edge++, neighbour_count++) sum += x[up_neighbours[edge]];
+            for (int edge = down_offsets[node]; edge < down_offsets[node + 1]; edge++, neighbour_count++) sum += x[down_neighbours[edge]];
+            float target = (neighbour_count > 0 ? sum / float(neighbour_count) : x[node]);
+            targets.push_back(target - float(i) * node_distance);
+          }
+
+          blocks.clear();
+          for (float target : targets)
+          {
+            blocks.push_back({target, 1});
+            while (blocks.size() > 1 and blocks[blocks.size() - 2].first * blocks.back().second > blocks.back().first * blocks[blocks.size() - 2].second)
+            {
+              blocks[blocks.size() - 2].first += blocks.back().first;
+              blocks[blocks.size() - 2].second += blocks.back().second;
+              blocks.pop_back();
+            }
+          }
+
+          int i = 0;
+          for (const auto& [sum, block_size] : blocks)
+            for (int k = 0; k < block_size; k++, i++) x[layer[i]] = sum / float(block_size) + float(i) * node_distance;
+        }
+      });
+    }
+
+  // Centred on where the nodes were when the layout started
+  int count = int(ids.size());
+  float mean = 0.0f;
+  for (int i = 0; i < count; i++) mean += x[i] / float(count);
+  for (int i = 0; i < count; i++)
+  {
+    next_xs[i] = centre.x + x[i] - mean;
+    next_ys[i] = centre.y + (float(layer_of[i]) - float(layer_count - 1) / 2.0f) * layer_distance;
+  }
+}
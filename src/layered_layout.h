@@ -0,0 +1,145 @@
+#pragma once
+
+#include "olcPixelGameEngine.h"
+#include "compressed_lines.h"
+#include "line.h"
+#include <atomic>
+#include <cmath>
+#include <map>
+#include <thread>
+#include <vector>
+
+// Layered (Sugiyama) layout for directed graphs: every line points downwards, from one layer to a lower one. The lines
+// closing a cycle are turned around first, then every node is put as high as the lines pointing to it let it go (the
+// longest path) and moved from there to where its lines get shortest. Lines spanning several layers are split by a
+// dummy node on every layer in between so that all lines join neighbouring layers. The order of the nodes within the
+// layers is improved by sweeps: going down (and then up) the layers, every node is sorted by the average position of its
+// neighbours in the layer before (barycentres). Every thread sweeps an ordering of its own, each starting out differently,
+// and the one with the fewest crossings is kept. Finally every node is moved towards its neighbours as far as the order
+// and the distance between nodes allow.
+//
+// Like the other layouts, it runs on a background thread and only update() on the main thread hands its results over to
+// the nodes, which happens after every pair of sweeps.
+class layered_layout
+{
+public:
+  float layer_distance = 80.0f; // World units between two layers
+  float node_distance = 40.0f; // The smallest distance between two nodes of a layer (in world units)
+  int layering_rounds = 16; // Rounds of moving the nodes between layers to shorten the lines, at most
+  int max_sweeps = 24; // Pairs of sweeps (down and up) at most, the layout also stops once the crossings stop going down
+  int placement_rounds = 8; // Rounds of moving the nodes towards their neighbours after every pair of sweeps
+  int thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+  ~layered_layout();
+
+  void start();
+  void stop();
+  bool is_running() const;
+
+  // As of the last pair of sweeps handed over by update(): the number of lines crossing each other between neighbouring
+  // layers (those of the dummy nodes included), -1 before the first one
+  int64_t crossing_count() const;
+
+  // Called once per frame. If the pair of sweeps running in the background is done, the positions of the best ordering so
+  // far are written into the nodes (calling moved(id, from, to) for every node whose position changed) and the next pair
+  // is started. The layers are built again whenever the nodes or lines changed. edit_version works like it does for
+  // force_layout: as long as it stays the same, nothing is compared between pairs of sweeps.
+  template<typename function_type>
+  void update(std::map<int, olc::vi2d>& nodes, const std::vector<line>& lines, uint64_t edit_version, function_type&& moved)
+  {
+    if (worker.joinable())
+    {
+      if (not step_done) return;
+
+      worker.join();
+      std::swap(xs, next_xs);
+      std::swap(ys, next_ys);
+      shown_crossings = best_crossings;
+      if (converged and not first_step) running = false;
+
+      // The nodes might have been added or deleted while the sweeps were running, which makes their result useless, and
+      // after stop() (e.g. the graph having been replaced) it isn't wanted anymore even if the nodes look the same
+      bool discarded = stopped_in_flight;
+      stopped_in_flight = false;
+      if (not discarded and (edit_version == gathered_version or has_same_nodes(nodes)))
+      {
+        size_t i = 0;
+        for (auto& node : nodes)
+        {
+          olc::vi2d to = {int(std::round(xs[i])), int(std::round(ys[i]))};
+          if (to != node.second)
+          {
+            moved(node.first, node.second, to);
+            node.second = to;
+          }
+          i++;
+        }
+      }
+    }
+
+    if (not running) return;
+
+    // Only which nodes the lines join matters here, not their lengths
+    bool edited = first_step or edit_version != gathered_version;
+    uint64_t edited_lines = (edited ? fingerprint(lines, false) : lines_fingerprint);
+    bool restart = first_step or (edited and (not has_same_nodes(nodes) or edited_lines != lines_fingerprint));
+    first_step = false;
+    if (restart)
+    {
+      gather(nodes, lines);
+      lines_fingerprint = edited_lines;
+    }
+    gathered_version = edit_version;
+
+    step_done = false;
+    worker = std::thread([this, restart]()
+    {
+      compute_step(restart);
+      step_done = true;
+    });
+  }
+
+private:
+  bool running = false;
+  bool stopped_in_flight = false; // Whether stop() was called while a step was running, whose result is dropped then
+  bool first_step = false; // Whether the next step builds the layers anew
+  std::thread worker;
+  std::atomic<bool> step_done = false;
+  int64_t shown_crossings = -1;
+  uint64_t gathered_version = 0; // The edit version the nodes and lines were last compared or gathered at
+
+  // Everything below is owned by the worker while a step is running
+  std::vector<int> ids = {};
+  std::vector<line> lines_snapshot = {}; // Only kept until build_layers() has compressed it
+  uint64_t lines_fingerprint = 0;
+  olc::vf2d centre = {0.0f, 0.0f}; // Where the nodes were centred when the layout (re)started, the layout is kept there
+  bool converged = false;
+  int sweeps = 0;
+  int sweeps_without_progress = 0;
+  int64_t best_crossings = -1;
+  // Positions of the nodes themselves (not the dummies); the shown ones and the ones being computed
+  std::vector<float> xs = {};
+  std::vector<float> ys = {};
+  std::vector<float> next_xs = {};
+  std::vector<float> next_ys = {};
+  // The nodes followed by the dummies, with the lines between neighbouring layers in both directions: node i's neighbours
+  // in the layer above are [up_offsets[i], up_offsets[i + 1]), the ones below [down_offsets[i], down_offsets[i + 1])
+  std::vector<int> layer_of = {};
+  std::vector<int> up_offsets = {};
+  std::vector<int> up_neighbours = {};
+  std::vector<int> down_offsets = {};
+  std::vector<int> down_neighbours = {};
+  int layer_count = 0;
+  // Orderings: the nodes of every layer from left to right. Every thread has one of its own, the best one is kept apart.
+  using ordering = std::vector<std::vector<int>>;
+  std::vector<ordering> candidates = {};
+  ordering best = {};
+
+  bool has_same_nodes(const std::map<int, olc::vi2d>& nodes) const;
+  void gather(const std::map<int, olc::vi2d>& nodes, const std::vector<line>& lines);
+  void compute_step(bool restart);
+  void build_layers();
+  void sweep(ordering& layers, bool downwards, std::vector<int>& positions) const;
+  int64_t count_crossings(const ordering& layers, std::vector<int>& positions) const;
+  void place(const ordering& layers);
+};
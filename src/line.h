@@ -0,0 +1,46 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct line
+{
+  int from;
+  int to;
+  int length;
+
+  line(int from, int to, int length)
+  {
+    this->from = from;
+    this->to = to;
+    this->length = length;
+  }
+};
+
+// A 64 bit hash of the lines in their order (and of their lengths unless left out), which lets the layouts tell whether
+// the lines changed without keeping a copy of them. It is taken every time the graph is edited, so it has to cost no more
+// than copying the lines would: four lanes of xxHash64's round, which don't wait for each other, are mixed together at the
+// end.
+inline uint64_t fingerprint(const std::vector<line>& lines, bool with_lengths = true)
+{
+  constexpr uint64_t prime_1 = 0x9e3779b185ebca87;
+  constexpr uint64_t prime_2 = 0xc2b2ae3d27d4eb4f;
+  constexpr uint64_t prime_3 = 0x165667b19e3779f9;
+  auto round = [&](uint64_t lane, uint64_t value) { return std::rotl(lane + value * prime_2, 31) * prime_1; };
+
+  uint64_t lanes[4] = {prime_1 + prime_2, prime_2, 0, 0 - prime_1};
+  for (size_t i = 0; i < lines.size(); i++)
+  {
+    uint64_t value = uint64_t(uint32_t(lines[i].from)) << 32 | uint32_t(lines[i].to);
+    if (with_lengths) value ^= uint64_t(uint32_t(lines[i].length)) * prime_3;
+    lanes[i % 4] = round(lanes[i % 4], value);
+  }
+
+  uint64_t hash = uint64_t(lines.size());
+  for (const uint64_t& lane : lanes) hash = round(hash, lane);
+  hash ^= hash >> 33;
+  hash *= prime_2;
+  return hash ^ (hash >> 29);
+}
@@ -0,0 +1,44 @@
+#include "mapped_file.h"
+#include "platform.h"
+#include <cerrno>
+#include <cstring>
+
+mapped_file::~mapped_file()
+{
+  if (mapping != nullptr) platform::unmap_file(mapping, mapped_size);
+}
+
+bool mapped_file::open(const std::string& path, std::string& error)
+{
+  int descriptor = platform::open_file(path, platform::READ);
+  if (descriptor == -1)
+  {
+    error = std::strerror(errno);
+    return false;
+  }
+
+  uint64_t size = 0;
+  if (not platform::file_size(descriptor, size))
+  {
+    error = std::strerror(errno);
+    platform::close_file(descriptor);
+    return false;
+  }
+  if (size == 0)
+  {
+    platform::close_file(descriptor);
+    return true;
+  }
+
+  // The mapping stays valid once the descriptor is closed
+  const void* pages = platform::map_file(descriptor, size_t(size));
+  if (pages == nullptr) error = std::strerror(errno);
+  platform::close_file(descriptor);
+  if (pages == nullptr) return false;
+
+  mapping = static_cast<const char*>(pages);
+  mapped_size = size_t(size);
+  // Files are read from front to back (each thread its own part of it), so reading ahead pays off
+  platform::advise(pages, mapped_size, platform::SEQUENTIAL);
+  return true;
+}
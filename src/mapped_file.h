@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// A whole file mapped read only into memory, unmapped again when it goes out of scope. The pages are only read from disk
+// once they are touched, so opening even a huge file costs next to nothing.
+class mapped_file
+{
+public:
+  mapped_file() = default;
+  mapped_file(const mapped_file&) = delete;
+  mapped_file& operator=(const mapped_file&) = delete;
+  ~mapped_file();
+
+  // Returns false and describes what went wrong in error if the file can't be mapped. An empty file maps to no data.
+  bool open(const std::string& path, std::string& error);
+
+  const char* data() const { return mapping; }
+  size_t size() const { return mapped_size; }
+
+private:
+  const char* mapping = nullptr;
+  size_t mapped_size = 0;
+};
@@ -0,0 +1,452 @@
+#include "mapped_graph.h"
+#include "platform.h"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <queue>
+#include <unordered_map>
+
+static_assert(sizeof(mapped_graph::header) == 56 and sizeof(mapped_graph::tile_range) == 16 and sizeof(mapped_graph::position_record) == 8 and sizeof(mapped_graph::id_entry) == 8);
+
+namespace
+{
+  constexpr uint64_t page_size = 4096;
+
+  enum section
+  {
+    TILES,
+    IDS,
+    POSITIONS,
+    OFFSETS,
+    NEIGHBOURS,
+    LENGTHS,
+    ID_INDEX,
+    END
+  };
+
+  // build() allocates a few words per tile, so grids bigger than this (far apart nodes and small tiles) are refused
+  constexpr uint64_t max_built_tiles = uint64_t(1) << 24;
+
+  // Whether the counts can be indexed with 32 bits (the nodes) and the sizes of the sections don't overflow 64 bits
+  bool fits(const mapped_graph::header& shape)
+  {
+    return shape.node_count < UINT32_MAX and shape.line_count < (uint64_t(1) << 60) and shape.columns >= 1 and shape.rows >= 1 and uint64_t(shape.columns) * uint64_t(shape.rows) < (uint64_t(1) << 56) and shape.tile_size >= 1;
+  }
+
+  // Where every section starts in a file of the shape, and where the file ends
+  std::array<uint64_t, END + 1> section_starts(const mapped_graph::header& shape)
+  {
+    uint64_t n = shape.node_count;
+    uint64_t ends = 2 * shape.line_count;
+    std::array<uint64_t, END> sizes = {
+      uint64_t(shape.columns) * uint64_t(shape.rows) * sizeof(mapped_graph::tile_range),
+      n * sizeof(int32_t),
+      n * sizeof(mapped_graph::position_record),
+      (n + 1) * sizeof(uint64_t),
+      ends * sizeof(uint32_t),
+      ends * sizeof(uint8_t),
+      n * sizeof(mapped_graph::id_entry)
+    };
+
+    std::array<uint64_t, END + 1> starts = {};
+    uint64_t at = page_size; // The header gets a page to itself
+    for (int i = 0; i < END; i++)
+    {
+      starts[i] = at;
+      at = (at + sizes[i] + page_size - 1) / page_size * page_size;
+    }
+    starts[END] = at;
+    return starts;
+  }
+
+  // Spreads the 16 lower bits of the value out to every other bit
+  uint64_t spread_bits(uint64_t value)
+  {
+    value &= 0xffff'ffff;
+    value = (value | (value << 16)) & 0x0000'ffff'0000'ffff;
+    value = (value | (value << 8)) & 0x00ff'00ff'00ff'00ff;
+    value = (value | (value << 4)) & 0x0f0f'0f0f'0f0f'0f0f;
+    value = (value | (value << 2)) & 0x3333'3333'3333'3333;
+    value = (value | (value << 1)) & 0x5555'5555'5555'5555;
+    return value;
+  }
+
+  int floor_divide(int64_t value, int64_t divisor)
+  {
+    return int(value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor));
+  }
+}
+
+mapped_graph::~mapped_graph()
+{
+  close();
+}
+
+bool mapped_graph::is_mapped_graph(const std::string& path)
+{
+  char start[sizeof(magic)] = {};
+  std::ifstream file(path, std::ios::binary);
+  file.read(start, sizeof(start));
+  return file and std::equal(std::begin(magic), std::end(magic), start);
+}
+
+bool mapped_graph::build(const std::string& path, const std::map<int, olc::vi2d>& nodes, const std::vector<line>& lines, int tile_size, std::string& error)
+{
+  if (tile_size < 1)
+  {
+    error = "the tiles need to be at least 1 unit wide";
+    return false;
+  }
+
+  // The grid covers every node (and has a tile even if there are none)
+  olc::vi2d smallest = (nodes.empty() ? olc::vi2d{0, 0} : nodes.begin()->second);
+  olc::vi2d largest = smallest;
+  for (const auto& [id, position] : nodes)
+  {
+    smallest = smallest.min(position);
+    largest = largest.max(position);
+  }
+
+  // Nothing is allocated for the grid before it is known to be one that can be built
+  int64_t columns = (int64_t(largest.x) - smallest.x) / tile_size + 1;
+  int64_t rows = (int64_t(largest.y) - smallest.y) / tile_size + 1;
+  if (uint64_t(columns) * uint64_t(rows) > max_built_tiles)
+  {
+    error = "the nodes are too far apart for tiles of that size";
+    return false;
+  }
+
+  header shape = {};
+  shape.node_count = nodes.size();
+  shape.line_count = lines.size();
+  shape.origin_x = smallest.x;
+  shape.origin_y = smallest.y;
+  shape.tile_size = tile_size;
+  shape.columns = int(columns);
+  shape.rows = int(rows);
+  if (not fits(shape))
+  {
+    error = "can't hold that many nodes or has no tiles";
+    return false;
+  }
+
+  // Where every tile comes in the file, then the nodes in that order (the map already has them by ID within each tile)
+  std::vector<uint64_t> order = tile_order(shape.columns, shape.rows);
+  std::vector<uint64_t> rank_of_tile(order.size());
+  for (size_t i = 0; i < order.size(); i++) rank_of_tile[order[i]] = i;
+
+  std::vector<uint64_t> rank_of_node = {};
+  rank_of_node.reserve(nodes.size());
+  std::vector<uint64_t> tile_starts(order.size() + 1, 0);
+  for (const auto& [id, position] : nodes)
+  {
+    uint64_t tile = uint64_t((int64_t(position.y) - smallest.y) / tile_size) * uint64_t(shape.columns) + uint64_t((int64_t(position.x) - smallest.x) / tile_size);
+    rank_of_node.push_back(rank_of_tile[tile]);
+    tile_starts[rank_of_tile[tile] + 1]++;
+  }
+  for (size_t i = 1; i < tile_starts.size(); i++) tile_starts[i] += tile_starts[i - 1];
+
+  mapped_graph file;
+  if (not file.create(path, shape, error)) return false;
+  sections out = file.writable();
+
+  std::vector<uint64_t> next = tile_starts;
+  size_t k = 0;
+  for (const auto& [id, position] : nodes)
+  {
+    uint64_t index = next[rank_of_node[k]]++;
+    out.ids[index] = id;
+    out.positions[index] = {position.x, position.y};
+    out.id_index[k] = {id, uint32_t(index)};
+    k++;
+  }
+  for (size_t i = 0; i < order.size(); i++) out.tiles[order[i]] = {tile_starts[i], tile_starts[i + 1] - tile_starts[i]};
+
+  // The lines at both of their ends, the neighbours of every node in the order they are stored in
+  auto index_of_id = [&](int id)
+  {
+    return std::lower_bound(out.id_index, out.id_index + nodes.size(), id, [](const id_entry& entry, int id) { return entry.id < id; })->index;
+  };
+  std::vector<std::pair<uint32_t, uint32_t>> ends = {};
+  std::vector<uint8_t> end_lengths = {};
+  ends.reserve(2 * lines.size());
+  end_lengths.reserve(2 * lines.size());
+  for (const line& line : lines)
+  {
+    uint32_t from = index_of_id(line.from);
+    uint32_t to = index_of_id(line.to);
+    ends.push_back({from, to});
+    end_lengths.push_back(uint8_t(line.length) | outgoing);
+    ends.push_back({to, from});
+    end_lengths.push_back(uint8_t(line.length));
+  }
+  std::vector<uint64_t> sorted(ends.size());
+  for (size_t i = 0; i < sorted.size(); i++) sorted[i] = i;
+  std::sort(sorted.begin(), sorted.end(), [&](uint64_t a, uint64_t b) { return ends[a] < ends[b]; });
+
+  std::fill(out.offsets, out.offsets + nodes.size() + 1, 0);
+  for (size_t i = 0; i < sorted.size(); i++)
+  {
+    const auto& [node, neighbour] = ends[sorted[i]];
+    out.offsets[node + 1]++;
+    out.neighbours[i] = neighbour;
+    out.lengths[i] = end_lengths[sorted[i]];
+  }
+  for (size_t i = 1; i <= nodes.size(); i++) out.offsets[i] += out.offsets[i - 1];
+
+  return file.sync(error);
+}
+
+std::vector<uint64_t> mapped_graph::tile_order(int columns, int rows)
+{
+  std::vector<uint64_t> order(size_t(columns) * size_t(rows));
+  for (size_t i = 0; i < order.size(); i++) order[i] = i;
+
+  auto code = [&](uint64_t tile) { return spread_bits(tile % uint64_t(columns)) | (spread_bits(tile / uint64_t(columns)) << 1); };
+  std::sort(order.begin(), order.end(), [&](uint64_t a, uint64_t b) { return code(a) < code(b); });
+  return order;
+}
+
+bool mapped_graph::create(const std::string& path, const header& shape, std::string& error)
+{
+  close();
+  if (not fits(shape))
+  {
+    error = "can't hold that many nodes or has no tiles";
+    return false;
+  }
+
+  descriptor = platform::open_file(path, platform::READ_WRITE);
+  if (descriptor == -1)
+  {
+    error = std::strerror(errno);
+    return false;
+  }
+
+  uint64_t size = section_starts(shape)[END];
+  void* pages = nullptr;
+  if (platform::resize_file(descriptor, size)) pages = platform::map_file_for_writing(descriptor, size_t(size));
+  if (pages == nullptr)
+  {
+    error = std::strerror(errno);
+    close();
+    return false;
+  }
+
+  mapping = static_cast<char*>(pages);
+  mapped_size = size;
+  this->shape = shape;
+  std::copy(std::begin(magic), std::end(magic), this->shape.magic);
+  this->shape.version = version;
+  this->shape.byte_order_mark = byte_order_mark;
+  this->shape.padding = 0;
+  std::memcpy(mapping, &this->shape, sizeof(header));
+  locate_sections();
+  // A new file is written from front to back
+  expect_sequential(true);
+  return true;
+}
+
+bool mapped_graph::sync(std::string& error)
+{
+  if (not platform::sync_mapping(mapping, mapped_size, descriptor))
+  {
+    error = std::strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+bool mapped_graph::open(const std::string& path, std::string& error)
+{
+  close();
+
+  int file = platform::open_file(path, platform::READ);
+  if (file == -1)
+  {
+    error = std::strerror(errno);
+    return false;
+  }
+
+  uint64_t file_size = 0;
+  header file_shape = {};
+  if (not platform::file_size(file, file_size))
+  {
+    error = std::strerror(errno);
+    platform::close_file(file);
+    return false;
+  }
+  if (platform::read_file_at(file, &file_shape, sizeof(file_shape), 0) != int64_t(sizeof(file_shape)))
+  {
+    error = "too small to be a mapped graph file";
+    platform::close_file(file);
+    return false;
+  }
+
+  const char* problem = nullptr;
+  if (not std::equal(std::begin(magic), std::end(magic), file_shape.magic)) problem = "not a mapped graph file";
+  else if (file_shape.byte_order_mark != byte_order_mark) problem = "written with a different byte order";
+  else if (file_shape.version != version) problem = "written by a newer version";
+  else if (not fits(file_shape)) problem = "the header is damaged";
+  else if (file_size != section_starts(file_shape)[END]) problem = "the size doesn't match the header";
+  if (problem != nullptr)
+  {
+    error = problem;
+    platform::close_file(file);
+    return false;
+  }
+
+  // The mapping stays valid once the descriptor is closed
+  const void* pages = platform::map_file(file, size_t(file_size));
+  if (pages == nullptr) error = std::strerror(errno);
+  platform::close_file(file);
+  if (pages == nullptr) return false;
+
+  // Only ever read through, but kept in the same pointer as a file being created
+  mapping = static_cast<char*>(const_cast<void*>(pages));
+  mapped_size = size_t(file_size);
+  shape = file_shape;
+  locate_sections();
+  return true;
+}
+
+void mapped_graph::close()
+{
+  if (mapping != nullptr) platform::unmap_file(mapping, mapped_size);
+  if (descriptor != -1) platform::close_file(descriptor);
+  mapping = nullptr;
+  mapped_size = 0;
+  descriptor = -1;
+  shape = {};
+  data = {};
+}
+
+size_t mapped_graph::resident_bytes() const
+{
+  return (mapping == nullptr ? 0 : platform::resident_bytes(mapping, mapped_size));
+}
+
+olc::vi2d mapped_graph::tile_of(const olc::vi2d& position) const
+{
+  return {floor_divide(int64_t(position.x) - shape.origin_x, shape.tile_size), floor_divide(int64_t(position.y) - shape.origin_y, shape.tile_size)};
+}
+
+int64_t mapped_graph::index_of(int id) const
+{
+  const id_entry* first = data.id_index;
+  const id_entry* end = first + shape.node_count;
+  const id_entry* found = std::lower_bound(first, end, id, [](const id_entry& entry, int id) { return entry.id < id; });
+  return (found != end and found->id == id and found->index < shape.node_count ? int64_t(found->index) : -1);
+}
+
+int64_t mapped_graph::nearest_within(const olc::vi2d& position, int max_distance_squared) const
+{
+  int reach = int(std::ceil(std::sqrt(double(max_distance_squared))));
+  int64_t nearest = -1;
+  int64_t nearest_distance = 0;
+  for_each_in_rect(position - olc::vi2d{reach, reach}, position + olc::vi2d{reach, reach}, [&](uint32_t index, const olc::vi2d& at)
+  {
+    int64_t dx = int64_t(at.x) - position.x;
+    int64_t dy = int64_t(at.y) - position.y;
+    int64_t distance = dx * dx + dy * dy;
+    if (distance > max_distance_squared) return;
+    if (nearest == -1 or distance < nearest_distance or (distance == nearest_distance and id(index) < id(uint32_t(nearest))))
+    {
+      nearest = index;
+      nearest_distance = distance;
+    }
+  });
+  return nearest;
+}
+
+void mapped_graph::prefetch(const olc::vi2d& first_tile, const olc::vi2d& last_tile) const
+{
+  olc::vi2d first = first_tile.max({0, 0});
+  olc::vi2d last = last_tile.min({shape.columns - 1, shape.rows - 1});
+
+  for (int row = first.y; row <= last.y; row++)
+    for (int column = first.x; column <= last.x; column++)
+    {
+      tile_range range = tile(column, row);
+      if (range.count == 0) continue;
+
+      uint64_t end = range.first + range.count;
+      platform::advise(data.ids + range.first, range.count * sizeof(int32_t), platform::SOON);
+      platform::advise(data.positions + range.first, range.count * sizeof(position_record), platform::SOON);
+      platform::advise(data.offsets + range.first, (range.count + 1) * sizeof(uint64_t), platform::SOON);
+      // Finding the lines of the tile reads its offsets right away, which the first and last one are enough for
+      uint64_t first_end = data.offsets[range.first];
+      uint64_t last_end = data.offsets[end];
+      if (first_end > last_end or last_end > 2 * shape.line_count) continue;
+      platform::advise(data.neighbours + first_end, (last_end - first_end) * sizeof(uint32_t), platform::SOON);
+      platform::advise(data.lengths + first_end, last_end - first_end, platform::SOON);
+    }
+}
+
+void mapped_graph::expect_sequential(bool sequential) const
+{
+  if (mapping != nullptr) platform::advise(mapping, mapped_size, sequential ? platform::SEQUENTIAL : platform::RANDOM);
+}
+
+std::vector<uint32_t> mapped_graph::shortest_path(uint32_t from, uint32_t to, size_t& settled_count, const std::function<bool()>& stop) const
+{
+  struct visit
+  {
+    uint64_t distance;
+    uint32_t previous;
+    bool settled;
+  };
+  std::unordered_map<uint32_t, visit> visits = {{from, {0, from, false}}};
+  using entry = std::pair<uint64_t, uint32_t>;
+  std::priority_queue<entry, std::vector<entry>, std::greater<entry>> queue;
+  queue.push({0, from});
+
+  while (not queue.empty())
+  {
+    auto [distance, index] = queue.top();
+    queue.pop();
+    visit& current = visits[index];
+    if (current.settled) continue;
+    current.settled = true;
+    settled_count++;
+
+    if (index == to)
+    {
+      std::vector<uint32_t> path = {to};
+      while (path.back() != from) path.push_back(visits[path.back()].previous);
+      std::reverse(path.begin(), path.end());
+      return path;
+    }
+    if (stop and settled_count % 4096 == 0 and stop()) return {};
+
+    for_each_neighbour(index, [&](uint32_t neighbour, int length, bool is_outgoing)
+    {
+      if (not is_outgoing) return;
+      uint64_t through = distance + uint64_t(length);
+      auto [found, inserted] = visits.try_emplace(neighbour, visit{through, index, false});
+      if (not inserted)
+      {
+        if (found->second.settled or found->second.distance <= through) return;
+        found->second = {through, index, false};
+      }
+      queue.push({through, neighbour});
+    });
+  }
+  return {};
+}
+
+void mapped_graph::locate_sections()
+{
+  std::array<uint64_t, END + 1> starts = section_starts(shape);
+  data.tiles = reinterpret_cast<tile_range*>(mapping + starts[TILES]);
+  data.ids = reinterpret_cast<int32_t*>(mapping + starts[IDS]);
+  data.positions = reinterpret_cast<position_record*>(mapping + starts[POSITIONS]);
+  data.offsets = reinterpret_cast<uint64_t*>(mapping + starts[OFFSETS]);
+  data.neighbours = reinterpret_cast<uint32_t*>(mapping + starts[NEIGHBOURS]);
+  data.lengths = reinterpret_cast<uint8_t*>(mapping + starts[LENGTHS]);
+  data.id_index = reinterpret_cast<id_entry*>(mapping + starts[ID_INDEX]);
+}
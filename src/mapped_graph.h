@@ -0,0 +1,195 @@
+#pragma once
+
+#include "olcPixelGameEngine.h"
+#include "line.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// A graph too big for memory, kept in a file as a compressed sparse row (CSR) structure that is mapped into memory and
+// used in place. Only the pages that get touched are read from disk, and the kernel drops them again when memory runs
+// short, so painting the part in view or searching a path only costs memory for that part of the graph.
+//
+// The plane is cut into square tiles. The nodes are stored tile by tile, and within a tile by ID. The tiles follow a
+// Z-order curve, which keeps tiles that are close on screen close in the file. Every line is stored at both of its ends,
+// so all the neighbours of a node can be found without searching. The sections all start on a page boundary:
+//
+//   header:     "PGEMAPPD", version, byte order mark (0x01020304), node count, line count, the tile grid
+//   tiles:      columns times rows {first node, node count}, row by row
+//   IDs:        node count times the ID
+//   positions:  node count times {x, y}
+//   offsets:    node count + 1 times where the neighbours of the node start (the last one is twice the line count)
+//   neighbours: twice the line count times the index of the node at the other end
+//   lengths:    twice the line count times the length, the top bit set if the line goes out to the neighbour
+//   ID index:   node count times {ID, index}, sorted by ID
+//
+// Opening a file only reads the header and checks that the size fits it, however big the file is. The rest is checked as
+// it is read instead: a tile that points past the nodes is taken to have none, a node whose offsets run backwards or past
+// the neighbours to have no lines, and a neighbour or ID index entry past the nodes is skipped. A damaged file shows up
+// with parts missing that way rather than reading outside of the mapping.
+class mapped_graph
+{
+public:
+  static constexpr char magic[8] = {'P', 'G', 'E', 'M', 'A', 'P', 'P', 'D'};
+  static constexpr uint32_t version = 1;
+  static constexpr uint32_t byte_order_mark = 0x01020304;
+  static constexpr uint8_t outgoing = 0x80; // The bit of a length which marks a line going to the neighbour
+
+  struct header
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order_mark;
+    uint64_t node_count;
+    uint64_t line_count;
+    int32_t origin_x; // The world position of the top left corner of the top left tile
+    int32_t origin_y;
+    int32_t tile_size; // In world units
+    int32_t columns;
+    int32_t rows;
+    uint32_t padding;
+  };
+
+  struct tile_range
+  {
+    uint64_t first;
+    uint64_t count;
+  };
+
+  struct position_record
+  {
+    int32_t x;
+    int32_t y;
+  };
+
+  struct id_entry
+  {
+    int32_t id;
+    uint32_t index;
+  };
+
+  // Where the sections are once the file is mapped; only written through while a file is being created
+  struct sections
+  {
+    tile_range* tiles = nullptr;
+    int32_t* ids = nullptr;
+    position_record* positions = nullptr;
+    uint64_t* offsets = nullptr;
+    uint32_t* neighbours = nullptr;
+    uint8_t* lengths = nullptr;
+    id_entry* id_index = nullptr;
+  };
+
+  mapped_graph() = default;
+  mapped_graph(const mapped_graph&) = delete;
+  mapped_graph& operator=(const mapped_graph&) = delete;
+  ~mapped_graph();
+
+  // Whether the file starts like a mapped graph file
+  static bool is_mapped_graph(const std::string& path);
+
+  // Writes the graph to a mapped graph file with tiles of the size (in world units)
+  static bool build(const std::string& path, const std::map<int, olc::vi2d>& nodes, const std::vector<line>& lines, int tile_size, std::string& error);
+
+  // All return false and describe what went wrong in error if they fail; a graph that was open is closed either way
+  bool open(const std::string& path, std::string& error);
+  void close();
+  bool is_open() const { return mapping != nullptr; }
+
+  size_t node_count() const { return size_t(shape.node_count); }
+  size_t line_count() const { return size_t(shape.line_count); }
+  int columns() const { return shape.columns; }
+  int rows() const { return shape.rows; }
+  int tile_size() const { return shape.tile_size; }
+  olc::vi2d origin() const { return {shape.origin_x, shape.origin_y}; }
+  // How much of the file is in memory right now, in bytes
+  size_t resident_bytes() const;
+
+  // The tile the world position falls into, which is outside the grid if the position is
+  olc::vi2d tile_of(const olc::vi2d& position) const;
+  tile_range tile(int column, int row) const
+  {
+    tile_range range = data.tiles[size_t(row) * size_t(shape.columns) + size_t(column)];
+    return (range.first <= shape.node_count and range.count <= shape.node_count - range.first ? range : tile_range{0, 0});
+  }
+
+  int id(uint32_t index) const { return data.ids[index]; }
+  olc::vi2d position(uint32_t index) const { return {data.positions[index].x, data.positions[index].y}; }
+  // The index of the node with the ID, -1 if there is none
+  int64_t index_of(int id) const;
+
+  // Calls function(index, length, is_outgoing) for every line of the node, skipping any that lead outside of the nodes (in
+  // a damaged file)
+  template<typename function_type>
+  void for_each_neighbour(uint32_t index, function_type&& function) const
+  {
+    uint64_t first = data.offsets[index];
+    uint64_t last = data.offsets[index + 1];
+    if (first > last or last > 2 * shape.line_count) return;
+
+    for (uint64_t i = first; i < last; i++)
+    {
+      if (data.neighbours[i] >= shape.node_count) continue;
+      function(data.neighbours[i], int(data.lengths[i] & ~outgoing), (data.lengths[i] & outgoing) != 0);
+    }
+  }
+
+  // Calls function(index, position) for every node inside of the rectangle spanned by the two corners (edges included)
+  template<typename function_type>
+  void for_each_in_rect(const olc::vi2d& top_left, const olc::vi2d& bottom_right, function_type&& function) const
+  {
+    olc::vi2d first = tile_of(top_left).max({0, 0});
+    olc::vi2d last = tile_of(bottom_right).min({shape.columns - 1, shape.rows - 1});
+
+    for (int row = first.y; row <= last.y; row++)
+      for (int column = first.x; column <= last.x; column++)
+      {
+        tile_range range = tile(column, row);
+        for (uint64_t i = range.first; i < range.first + range.count; i++)
+        {
+          const position_record& at = data.positions[i];
+          if (at.x < top_left.x or at.x > bottom_right.x or at.y < top_left.y or at.y > bottom_right.y) continue;
+          function(uint32_t(i), olc::vi2d{at.x, at.y});
+        }
+      }
+  }
+
+  // The node closest to the position whose squared distance to it is at most max_distance_squared, -1 if there is none;
+  // ties go to the lower ID
+  int64_t nearest_within(const olc::vi2d& position, int max_distance_squared) const;
+
+  // Asks the kernel to read the nodes of the tiles from the first to the last (corners of a rectangle of tiles) and their
+  // lines ahead of time
+  void prefetch(const olc::vi2d& first_tile, const olc::vi2d& last_tile) const;
+
+  // The shortest path from a node to another one (both indices) along the lines in their direction, from the first node
+  // to the last one, or nothing if there is none. Dijkstra's algorithm, keeping what it knows in a hash map rather than an
+  // array over all nodes, so it only touches the part of the graph closer to the start than the end is. Adds up how many
+  // nodes that took in settled_count. Stops early (returning nothing) once stop returns true; it is asked every so often.
+  std::vector<uint32_t> shortest_path(uint32_t from, uint32_t to, size_t& settled_count, const std::function<bool()>& stop = {}) const;
+
+private:
+  char* mapping = nullptr;
+  size_t mapped_size = 0;
+  int descriptor = -1; // Kept open while a new file is being written, for syncing it
+  header shape = {};
+  sections data = {};
+
+  // The row by row indices of the tiles of a grid in the order their nodes are stored in
+  static std::vector<uint64_t> tile_order(int columns, int rows);
+
+  // Creates a file of the size the counts and the grid of the shape call for, mapped for writing through writable(). It
+  // still has to be synced and closed afterwards.
+  bool create(const std::string& path, const header& shape, std::string& error);
+  sections writable() const { return data; }
+  bool sync(std::string& error);
+
+  void locate_sections();
+
+  // The pages are read one at a time as they are touched, which suits looking at a part of the graph. Going through all of
+  // it in order (creating a file) is better served by reading ahead, which this turns on (and off again).
+  void expect_sequential(bool sequential) const;
+};
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Worker threads started once and kept for the whole run, so spreading work over threads (every frame, every layout
+// step) doesn't pay for starting and joining them each time. Tasks are submitted in groups, and whoever waits for a group
+// runs its queued tasks in the meantime. It only ever runs tasks of its own group, so the UI thread painting a frame
+// can't end up running a long layout step that a background thread queued, and calls from several threads at once or
+// from within a task still can't starve each other.
+class thread_pool
+{
+public:
+  // Tasks that are waited for together
+  struct task_group
+  {
+    int remaining = 0; // Guarded by the pool's mutex
+  };
+
+  explicit thread_pool(int worker_count)
+  {
+    for (int i = 0; i < worker_count; i++) workers.emplace_back([this]() { work(); });
+  }
+
+  ~thread_pool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    changed.notify_all();
+    for (auto& worker : workers) worker.join();
+  }
+
+  // The pool every on_threads() call shares
+  static thread_pool& shared()
+  {
+    static thread_pool pool(int(std::max(1u, std::thread::hardware_concurrency())));
+    return pool;
+  }
+
+  void submit(task_group& group, std::function<void()> task)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      group.remaining++;
+      tasks.push_back({&group, std::move(task)});
+    }
+    changed.notify_all();
+  }
+
+  // Runs the group's queued tasks on the calling thread until all of its tasks are done, sleeping while the rest of them
+  // run elsewhere
+  void wait(task_group& group)
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (group.remaining > 0)
+    {
+      auto task = std::find_if(tasks.begin(), tasks.end(), [&](const queued_task& task) { return task.group == &group; });
+      if (task == tasks.end())
+      {
+        changed.wait(lock);
+        continue;
+      }
+      run(lock, task);
+    }
+  }
+
+private:
+  struct queued_task
+  {
+    task_group* group;
+    std::function<void()> function;
+  };
+
+  std::vector<std::thread> workers = {};
+  std::mutex mutex;
+  std::condition_variable changed; // A task was queued or finished, or the pool is stopping
+  std::deque<queued_task> tasks = {};
+  bool stopping = false;
+
+  void work()
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+      changed.wait(lock, [&]() { return stopping or not tasks.empty(); });
+      if (stopping) return;
+      run(lock, tasks.begin());
+    }
+  }
+
+  // Called and returning with the lock held, which is let go of while the task runs
+  void run(std::unique_lock<std::mutex>& lock, std::deque<queued_task>::iterator task)
+  {
+    queued_task taken = std::move(*task);
+    tasks.erase(task);
+    lock.unlock();
+    taken.function();
+    lock.lock();
+    taken.group->remaining--;
+    changed.notify_all();
+  }
+};
+
+// Runs function(thread) on thread_count threads, the calling one being thread 0 and the others taken from the shared pool
+template<typename function_type>
+void on_threads(int thread_count, function_type&& function)
+{
+  if (thread_count <= 1)
+  {
+    function(0);
+    return;
+  }
+
+  thread_pool& pool = thread_pool::shared();
+  thread_pool::task_group group;
+  for (int thread = 1; thread < thread_count; thread++) pool.submit(group, [&function, thread]() { function(thread); });
+  function(0);
+  pool.wait(group);
+}
+
+// Every thread grabs the next chunk of [0, count) until there are none left, calling function(first, last) on it
+template<typename function_type>
+void parallel_for(int thread_count, int count, int chunk_size, function_type&& function)
+{
+  std::atomic<int> next_chunk = 0;
+  int chunk_count = (count + chunk_size - 1) / chunk_size;
+
+  on_threads(std::max(1, std::min(thread_count, chunk_count)), [&](int)
+  {
+    for (int chunk = next_chunk++; chunk < chunk_count; chunk = next_chunk++) function(chunk * chunk_size, std::min(count, (chunk + 1) * chunk_size));
+  });
+}
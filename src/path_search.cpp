@@ -0,0 +1,63 @@
+#include "path_search.h"
+#include <chrono>
+
+path_search::~path_search()
+{
+  stop();
+}
+
+void path_search::start(const mapped_graph& graph, uint32_t from, uint32_t to)
+{
+  if (running) return;
+
+  running = true;
+  done = false;
+  cancelled = false;
+  worker = std::thread([this, &graph, from, to]()
+  {
+    auto started = std::chrono::steady_clock::now();
+    settled = 0;
+    found_path = graph.shortest_path(from, to, settled, [this]() { return bool(cancelled); });
+    computed_milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - started).count();
+    done = true;
+  });
+}
+
+bool path_search::is_running() const
+{
+  return running;
+}
+
+void path_search::stop()
+{
+  if (not worker.joinable()) return;
+
+  cancelled = true;
+  worker.join();
+  running = false;
+  found_path.clear();
+}
+
+bool path_search::update()
+{
+  if (not worker.joinable() or not done) return false;
+
+  worker.join();
+  running = false;
+  return true;
+}
+
+const std::vector<uint32_t>& path_search::path() const
+{
+  return found_path;
+}
+
+size_t path_search::settled_count() const
+{
+  return settled;
+}
+
+float path_search::milliseconds() const
+{
+  return computed_milliseconds;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "mapped_graph.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// Searches the shortest path through a mapped graph on a background thread, since on a graph bigger than memory that
+// can mean reading a good part of it from disk. update() hands the path over once it is found.
+class path_search
+{
+public:
+  ~path_search();
+
+  // Starts searching from a node to another one (both indices), unless a search is under way already. The graph has to
+  // stay open until the search is done or stopped.
+  void start(const mapped_graph& graph, uint32_t from, uint32_t to);
+  bool is_running() const;
+
+  // Gives up on the search under way (if any), waiting for the thread to notice
+  void stop();
+
+  // Called once per frame. Returns true once the search is done.
+  bool update();
+
+  // As of the last search handed over by update(): the path (nothing if there is none), how many nodes the search
+  // settled and how long it took
+  const std::vector<uint32_t>& path() const;
+  size_t settled_count() const;
+  float milliseconds() const;
+
+private:
+  bool running = false;
+  std::thread worker;
+  std::atomic<bool> done = false;
+  std::atomic<bool> cancelled = false;
+
+  // Everything below is owned by the worker while the search is running
+  std::vector<uint32_t> found_path = {};
+  size_t settled = 0;
+  float computed_milliseconds = 0.0f;
+};
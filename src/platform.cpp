@@ -0,0 +1,351 @@
+#include "platform.h"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <vector>
+
+#ifdef _WIN32
+
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#include <windows.h>
+#include <psapi.h>
+
+namespace
+{
+  // The Windows API reports errors through GetLastError(), which is turned into the nearest errno
+  void set_errno_from_last_error()
+  {
+    switch (GetLastError())
+    {
+      case ERROR_FILE_NOT_FOUND:
+      case ERROR_PATH_NOT_FOUND: errno = ENOENT; break;
+      case ERROR_ACCESS_DENIED:
+      case ERROR_SHARING_VIOLATION: errno = EACCES; break;
+      case ERROR_NOT_ENOUGH_MEMORY:
+      case ERROR_OUTOFMEMORY:
+      case ERROR_COMMITMENT_LIMIT: errno = ENOMEM; break;
+      case ERROR_DISK_FULL:
+      case ERROR_HANDLE_DISK_FULL: errno = ENOSPC; break;
+      case ERROR_INVALID_HANDLE: errno = EBADF; break;
+      default: errno = EIO; break;
+    }
+  }
+
+  HANDLE handle_of(int descriptor)
+  {
+    return reinterpret_cast<HANDLE>(_get_osfhandle(descriptor));
+  }
+
+  void* map_view(int descriptor, size_t size, bool writable)
+  {
+    HANDLE mapping = CreateFileMappingA(handle_of(descriptor), nullptr, writable ? PAGE_READWRITE : PAGE_READONLY, DWORD(uint64_t(size) >> 32), DWORD(size), nullptr);
+    if (mapping == nullptr)
+    {
+      set_errno_from_last_error();
+      return nullptr;
+    }
+    // Like the descriptor, the mapping object may go once there is a view of it
+    void* view = MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size);
+    if (view == nullptr) set_errno_from_last_error();
+    CloseHandle(mapping);
+    return view;
+  }
+}
+
+int platform::open_file(const std::string& path, file_mode mode)
+{
+  int flags = _O_BINARY;
+  switch (mode)
+  {
+    case READ: flags |= _O_RDONLY; break;
+    case WRITE: flags |= _O_WRONLY | _O_CREAT | _O_TRUNC; break;
+    case APPEND: flags |= _O_WRONLY | _O_CREAT | _O_APPEND; break;
+    case READ_WRITE: flags |= _O_RDWR | _O_CREAT | _O_TRUNC; break;
+  }
+  return _open(path.c_str(), flags, _S_IREAD | _S_IWRITE);
+}
+
+bool platform::close_file(int descriptor)
+{
+  return _close(descriptor) == 0;
+}
+
+bool platform::file_size(int descriptor, uint64_t& size)
+{
+  int64_t length = _filelengthi64(descriptor);
+  if (length == -1) return false;
+  size = uint64_t(length);
+  return true;
+}
+
+bool platform::resize_file(int descriptor, uint64_t size)
+{
+  errno_t result = _chsize_s(descriptor, int64_t(size));
+  if (result != 0) errno = result;
+  return result == 0;
+}
+
+int64_t platform::write_file(int descriptor, const void* data, size_t size)
+{
+  // _write() takes an int's worth at most
+  return _write(descriptor, data, unsigned(std::min(size, size_t(INT_MAX))));
+}
+
+int64_t platform::read_file_at(int descriptor, void* data, size_t size, uint64_t offset)
+{
+  // There is no pread(), this moves the file position
+  if (_lseeki64(descriptor, int64_t(offset), SEEK_SET) == -1) return -1;
+  return _read(descriptor, data, unsigned(std::min(size, size_t(INT_MAX))));
+}
+
+bool platform::sync_file(int descriptor)
+{
+  return _commit(descriptor) == 0;
+}
+
+bool platform::sync_path(const std::string& path)
+{
+  DWORD attributes = GetFileAttributesA(path.c_str());
+  if (attributes != INVALID_FILE_ATTRIBUTES and (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0) return true;
+
+  // Only a handle that may write can be flushed
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE or not FlushFileBuffers(file))
+  {
+    set_errno_from_last_error();
+    if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+    return false;
+  }
+  CloseHandle(file);
+  return true;
+}
+
+bool platform::replace_file(const std::string& from, const std::string& to)
+{
+  // rename() won't replace a file on Windows
+  if (MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) return true;
+  set_errno_from_last_error();
+  return false;
+}
+
+const void* platform::map_file(int descriptor, size_t size)
+{
+  return map_view(descriptor, size, false);
+}
+
+void* platform::map_file_for_writing(int descriptor, size_t size)
+{
+  return map_view(descriptor, size, true);
+}
+
+void platform::unmap_file(const void* start, size_t)
+{
+  UnmapViewOfFile(start);
+}
+
+// FlushViewOfFile() only hands the changes to the file system, the file is flushed to get them on the disk
+bool platform::sync_mapping(void* start, size_t size, int descriptor)
+{
+  if (FlushViewOfFile(start, size) and FlushFileBuffers(handle_of(descriptor))) return true;
+  set_errno_from_last_error();
+  return false;
+}
+
+// Windows has no hint for reading a mapping in order or here and there, it reads a few pages around each one touched on
+// its own
+void platform::advise(const void* start, size_t size, access pattern)
+{
+  if (pattern != SOON or size == 0) return;
+#if _WIN32_WINNT >= 0x0602
+  // Windows 8 on
+  WIN32_MEMORY_RANGE_ENTRY range = {const_cast<void*>(start), size};
+  PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#endif
+}
+
+size_t platform::resident_bytes(const void* start, size_t size)
+{
+  SYSTEM_INFO system = {};
+  GetSystemInfo(&system);
+  size_t page_size = system.dwPageSize;
+
+  std::vector<PSAPI_WORKING_SET_EX_INFORMATION> pages((size + page_size - 1) / page_size);
+  for (size_t i = 0; i < pages.size(); i++) pages[i].VirtualAddress = const_cast<char*>(static_cast<const char*>(start)) + i * page_size;
+  if (pages.empty() or not QueryWorkingSetEx(GetCurrentProcess(), pages.data(), DWORD(pages.size() * sizeof(pages[0])))) return 0;
+  return size_t(std::count_if(pages.begin(), pages.end(), [](const PSAPI_WORKING_SET_EX_INFORMATION& page) { return page.VirtualAttributes.Valid != 0; })) * page_size;
+}
+
+std::tm platform::local_time(std::time_t time)
+{
+  std::tm local = {};
+  localtime_s(&local, &time);
+  return local;
+}
+
+void platform::process_memory(uint64_t& resident_bytes, uint64_t& peak_resident_bytes)
+{
+  PROCESS_MEMORY_COUNTERS counters = {};
+  counters.cb = sizeof(counters);
+  if (not GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) counters = {};
+  resident_bytes = uint64_t(counters.WorkingSetSize);
+  peak_resident_bytes = uint64_t(counters.PeakWorkingSetSize);
+}
+
+#else
+
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+  // A "VmRSS:    1234 kB" like field of /proc/self/status in bytes, 0 if there is none
+  uint64_t status_bytes(const std::string& status, const std::string& field)
+  {
+    size_t at = status.find(field + ":");
+    if (at == std::string::npos) return 0;
+    std::istringstream value(status.substr(at + field.size() + 1));
+    uint64_t kilobytes = 0;
+    value >> kilobytes;
+    return kilobytes * 1024;
+  }
+
+  size_t page_size()
+  {
+    static const size_t size = size_t(sysconf(_SC_PAGESIZE));
+    return size;
+  }
+}
+
+int platform::open_file(const std::string& path, file_mode mode)
+{
+  int flags = 0;
+  switch (mode)
+  {
+    case READ: flags |= O_RDONLY; break;
+    case WRITE: flags |= O_WRONLY | O_CREAT | O_TRUNC; break;
+    case APPEND: flags |= O_WRONLY | O_CREAT | O_APPEND; break;
+    case READ_WRITE: flags |= O_RDWR | O_CREAT | O_TRUNC; break;
+  }
+  return ::open(path.c_str(), flags, 0644);
+}
+
+bool platform::close_file(int descriptor)
+{
+  return ::close(descriptor) == 0;
+}
+
+bool platform::file_size(int descriptor, uint64_t& size)
+{
+  struct stat status;
+  if (fstat(descriptor, &status) == -1) return false;
+  size = uint64_t(status.st_size);
+  return true;
+}
+
+bool platform::resize_file(int descriptor, uint64_t size)
+{
+  return ftruncate(descriptor, off_t(size)) == 0;
+}
+
+int64_t platform::write_file(int descriptor, const void* data, size_t size)
+{
+  return ::write(descriptor, data, size);
+}
+
+int64_t platform::read_file_at(int descriptor, void* data, size_t size, uint64_t offset)
+{
+  return pread(descriptor, data, size, off_t(offset));
+}
+
+bool platform::sync_file(int descriptor)
+{
+  return fdatasync(descriptor) == 0;
+}
+
+bool platform::sync_path(const std::string& path)
+{
+  int descriptor = ::open(path.c_str(), O_RDONLY);
+  if (descriptor == -1) return false;
+  bool synced = fsync(descriptor) == 0;
+  int sync_error = errno;
+  ::close(descriptor);
+  errno = sync_error;
+  return synced;
+}
+
+bool platform::replace_file(const std::string& from, const std::string& to)
+{
+  return std::rename(from.c_str(), to.c_str()) == 0;
+}
+
+const void* platform::map_file(int descriptor, size_t size)
+{
+  void* pages = mmap(nullptr, size, PROT_READ, MAP_SHARED, descriptor, 0);
+  return (pages == MAP_FAILED ? nullptr : pages);
+}
+
+void* platform::map_file_for_writing(int descriptor, size_t size)
+{
+  void* pages = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+  return (pages == MAP_FAILED ? nullptr : pages);
+}
+
+void platform::unmap_file(const void* start, size_t size)
+{
+  munmap(const_cast<void*>(start), size);
+}
+
+bool platform::sync_mapping(void* start, size_t size, int)
+{
+  return msync(start, size, MS_SYNC) == 0;
+}
+
+// madvise() only takes whole pages
+void platform::advise(const void* start, size_t size, access pattern)
+{
+  if (size == 0) return;
+
+  int advice = MADV_NORMAL;
+  switch (pattern)
+  {
+    case SEQUENTIAL: advice = MADV_SEQUENTIAL; break;
+    case RANDOM: advice = MADV_RANDOM; break;
+    case SOON: advice = MADV_WILLNEED; break;
+  }
+  uintptr_t first = reinterpret_cast<uintptr_t>(start) / page_size() * page_size();
+  uintptr_t end = reinterpret_cast<uintptr_t>(start) + size;
+  madvise(reinterpret_cast<void*>(first), end - first, advice);
+}
+
+size_t platform::resident_bytes(const void* start, size_t size)
+{
+  std::vector<unsigned char> resident((size + page_size() - 1) / page_size());
+  if (mincore(const_cast<void*>(start), size, resident.data()) == -1) return 0;
+  return size_t(std::count_if(resident.begin(), resident.end(), [](unsigned char page) { return (page & 1) != 0; })) * page_size();
+}
+
+std::tm platform::local_time(std::time_t time)
+{
+  std::tm local = {};
+  localtime_r(&time, &local);
+  return local;
+}
+
+void platform::process_memory(uint64_t& resident_bytes, uint64_t& peak_resident_bytes)
+{
+  std::ifstream status_file("/proc/self/status");
+  std::string status((std::istreambuf_iterator<char>(status_file)), std::istreambuf_iterator<char>());
+  resident_bytes = status_bytes(status, "VmRSS");
+  peak_resident_bytes = status_bytes(status, "VmHWM");
+}
+
+#endif
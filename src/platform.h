@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+// What the app needs from the operating system beyond the standard library, which is the same on every system: files by
+// descriptor, syncing them to disk, mapping them into memory, the local time and how much memory the process uses. POSIX
+// calls on Linux, the Windows API and the C runtime's descriptors on Windows. Just like the POSIX calls, whatever fails
+// returns false (or -1, or nullptr) and leaves what went wrong in errno.
+namespace platform
+{
+  enum file_mode
+  {
+    READ, // An existing file, for reading
+    WRITE, // Created or emptied, for writing
+    APPEND, // Created if there is none, every write going to its end
+    READ_WRITE, // Created or emptied, for reading and writing (and mapping for writing)
+  };
+
+  // Returns the descriptor of the file, -1 if it can't be opened. Files are always opened as binary (on Windows too).
+  int open_file(const std::string& path, file_mode mode);
+  bool close_file(int descriptor);
+  bool file_size(int descriptor, uint64_t& size);
+  // Cuts the file off or lengthens it with zeros
+  bool resize_file(int descriptor, uint64_t size);
+  // Writes some of the data, which may be less than all of it, and returns how much, -1 if nothing could be written
+  int64_t write_file(int descriptor, const void* data, size_t size);
+  // Reads up to size bytes from the offset on and returns how many, -1 if that fails
+  int64_t read_file_at(int descriptor, void* data, size_t size, uint64_t offset);
+  // Returns once what was written to the file is on the disk (its contents, not necessarily its times and such)
+  bool sync_file(int descriptor);
+  // The same for a file or a directory by its path. Syncing the directory makes a rename within it last. Windows can't sync
+  // a directory and doesn't need to (NTFS journals the rename), there that does nothing.
+  bool sync_path(const std::string& path);
+  // Renames the file, replacing whatever file was at the new path in one step
+  bool replace_file(const std::string& from, const std::string& to);
+
+  // Maps the first size bytes of the file into memory read only, size must not be 0. The mapping stays valid once the
+  // descriptor is closed, until unmap_file().
+  const void* map_file(int descriptor, size_t size);
+  // The same for reading and writing, the changes going to the file
+  void* map_file_for_writing(int descriptor, size_t size);
+  void unmap_file(const void* start, size_t size);
+  // Returns once the changes to a mapping for writing are on the disk. Windows needs the file for that, so its descriptor
+  // has to be open still.
+  bool sync_mapping(void* start, size_t size, int descriptor);
+
+  enum access
+  {
+    SEQUENTIAL, // From front to back, so reading ahead pays off
+    RANDOM, // Here and there, so only what is touched should be read
+    SOON, // Soon, so it may as well be read now
+  };
+
+  // Tells the system how a part of a mapping is going to be read. Only a hint, which systems without it ignore.
+  void advise(const void* start, size_t size, access pattern);
+  // How much of a mapping (starting on a page) is in memory right now, in bytes
+  size_t resident_bytes(const void* start, size_t size);
+
+  // The time broken down into the local time zone's date and time of day
+  std::tm local_time(std::time_t time);
+  // How much memory the process has in use right now and the most it ever had, in bytes, 0 where that isn't known
+  void process_memory(uint64_t& resident_bytes, uint64_t& peak_resident_bytes);
+}
@@ -0,0 +1,87 @@
+#include "png_writer.h"
+#include <cerrno>
+#include <csetjmp>
+#include <cstring>
+
+// libpng reports errors by jumping back to the setjmp() of the call that failed, which is why nothing in the functions
+// calling into it may need destructing between the two
+
+png_writer::~png_writer()
+{
+  release();
+}
+
+bool png_writer::open(const std::string& path, int width, int height, std::string& error)
+{
+  release();
+  failure.clear();
+
+  file = std::fopen(path.c_str(), "wb");
+  if (file == nullptr)
+  {
+    error = std::strerror(errno);
+    return false;
+  }
+  png = png_create_write_struct(PNG_LIBPNG_VER_STRING, this, on_error, nullptr);
+  if (png != nullptr) info = png_create_info_struct(png);
+  if (info == nullptr)
+  {
+    error = "could not set up libpng";
+    release();
+    return false;
+  }
+
+  if (setjmp(png_jmpbuf(png)))
+  {
+    error = failure;
+    release();
+    return false;
+  }
+  png_init_io(png, file);
+  png_set_compression_level(png, compression_level);
+  // Trying every filter on every row (libpng's default) takes most of the time and hardly pays off on flat colours
+  png_set_filter(png, 0, PNG_FILTER_NONE);
+  png_set_IHDR(png, info, png_uint_32(width), png_uint_32(height), 8, PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+  png_write_info(png, info);
+  // The pixels come as RGBA, the alpha byte after the colour is skipped
+  png_set_filler(png, 0, PNG_FILLER_AFTER);
+  return true;
+}
+
+void png_writer::write_rows(olc::Sprite& sprite, int row_count)
+{
+  if (png == nullptr or not failure.empty()) return;
+
+  if (setjmp(png_jmpbuf(png))) return;
+  for (int row = 0; row < row_count; row++) png_write_row(png, reinterpret_cast<png_bytep>(sprite.GetData() + size_t(row) * size_t(sprite.width)));
+}
+
+bool png_writer::close(std::string& error)
+{
+  if (png != nullptr and failure.empty())
+  {
+    if (setjmp(png_jmpbuf(png)) == 0) png_write_end(png, nullptr);
+  }
+  if (file != nullptr and std::fclose(file) != 0 and failure.empty()) failure = std::strerror(errno);
+  file = nullptr;
+  release();
+
+  if (failure.empty()) return true;
+  error = failure;
+  return false;
+}
+
+void png_writer::on_error(png_structp png, png_const_charp message)
+{
+  static_cast<png_writer*>(png_get_error_ptr(png))->failure = message;
+  png_longjmp(png, 1);
+}
+
+void png_writer::release()
+{
+  if (png != nullptr) png_destroy_write_struct(&png, info != nullptr ? &info : nullptr);
+  png = nullptr;
+  info = nullptr;
+  if (file != nullptr) std::fclose(file);
+  file = nullptr;
+}
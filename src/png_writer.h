@@ -0,0 +1,38 @@
+#pragma once
+
+#include "olcPixelGameEngine.h"
+#include <cstdio>
+#include <png.h>
+#include <string>
+
+// Writes a PNG image row by row with libpng, so an image far bigger than what fits in memory at once can be written from
+// a few rows at a time. The pixels are stored as 8 bit RGB, the alpha of the sprites is dropped. Once something fails,
+// everything after it is skipped and close() reports the first error.
+//
+// This is the one file that needs a library besides the engine's: the build has to link libpng and zlib (-lpng -lz).
+class png_writer
+{
+public:
+  int compression_level = 3; // zlib's 0 (none) to 9 (smallest); images of graphs are mostly background, which is cheap at any level
+
+  png_writer() = default;
+  png_writer(const png_writer&) = delete;
+  png_writer& operator=(const png_writer&) = delete;
+  ~png_writer();
+
+  // Creates (or truncates) the file and writes the header for an image of the size
+  bool open(const std::string& path, int width, int height, std::string& error);
+  // The top rows of the sprite, which has to be as wide as the image, become the next rows of the image
+  void write_rows(olc::Sprite& sprite, int row_count);
+  // Finishes the image and closes the file, returns false if anything went wrong along the way
+  bool close(std::string& error);
+
+private:
+  FILE* file = nullptr;
+  png_structp png = nullptr;
+  png_infop info = nullptr;
+  std::string failure = {};
+
+  static void on_error(png_structp png, png_const_charp message);
+  void release();
+};
@@ -0,0 +1,178 @@
+#include "segment_bvh.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+void segment_bvh::build(const std::vector<line>& lines, const std::map<int, olc::vi2d>& nodes)
+{
+  tree.clear();
+  segments.clear();
+  leaf_of_segment.assign(lines.size(), -1);
+  segments_of_node.clear();
+
+  for (int i = 0; i < int(lines.size()); i++)
+  {
+    auto from = nodes.find(lines[i].from);
+    auto to = nodes.find(lines[i].to);
+    olc::vf2d a = (from != nodes.end() ? olc::vf2d(from->second) : olc::vf2d());
+    olc::vf2d b = (to != nodes.end() ? olc::vf2d(to->second) : olc::vf2d());
+
+    segments.push_back({lines[i].from, lines[i].to, a, b});
+    segments_of_node.insert({lines[i].from, i});
+    if (lines[i].to != lines[i].from) segments_of_node.insert({lines[i].to, i});
+  }
+
+  if (not segments.empty())
+  {
+    std::vector<int> order(segments.size());
+    std::iota(order.begin(), order.end(), 0);
+    tree.reserve(2 * segments.size());
+    build_range(order, 0, int(order.size()), -1);
+  }
+
+  built = true;
+}
+
+// Builds the subtree over the segments order[first, last) and returns the index of its root
+int segment_bvh::build_range(std::vector<int>& order, int first, int last, int parent)
+{
+  int index = int(tree.size());
+  tree.emplace_back();
+  tree[index].parent = parent;
+
+  if (last - first == 1)
+  {
+    tree[index].segment = order[first];
+    tree[index].bounds = box_of(segments[order[first]]);
+    leaf_of_segment[order[first]] = index;
+    return index;
+  }
+
+  // Splitting at the median of the segment centres along the longer side of their bounds
+  box centres = {INFINITY, INFINITY, -INFINITY, -INFINITY};
+  for (int i = first; i < last; i++)
+  {
+    olc::vf2d centre = (segments[order[i]].a + segments[order[i]].b) * 0.5f;
+    centres = merge(centres, {centre.x, centre.y, centre.x, centre.y});
+  }
+  bool split_x = centres.right - centres.left >= centres.bottom - centres.top;
+  int middle = first + (last - first) / 2;
+  std::nth_element(order.begin() + first, order.begin() + middle, order.begin() + last, [&](int a, int b)
+  {
+    olc::vf2d centre_a = segments[a].a + segments[a].b;
+    olc::vf2d centre_b = segments[b].a + segments[b].b;
+    return split_x ? centre_a.x < centre_b.x : centre_a.y < centre_b.y;
+  });
+
+  // The tree grows while the children get built, so no reference into it is held across these calls
+  int left = build_range(order, first, middle, index);
+  int right = build_range(order, middle, last, index);
+  tree[index].children[0] = left;
+  tree[index].children[1] = right;
+  refit(index);
+  return index;
+}
+
+void segment_bvh::refit(int index)
+{
+  tree_node& node = tree[index];
+  node.bounds = merge(tree[node.children[0]].bounds, tree[node.children[1]].bounds);
+}
+
+void segment_bvh::invalidate()
+{
+  built = false;
+}
+
+bool segment_bvh::is_built() const
+{
+  return built;
+}
+
+void segment_bvh::refit_node(int node, const std::map<int, olc::vi2d>& nodes)
+{
+  if (not built) return;
+
+  auto position = nodes.find(node);
+  if (position == nodes.end()) return;
+
+  auto range = segments_of_node.equal_range(node);
+  for (auto it = range.first; it != range.second; it++)
+  {
+    segment& segment = segments[it->second];
+    if (segment.from == node) segment.a = position->second;
+    if (segment.to == node) segment.b = position->second;
+
+    int index = leaf_of_segment[it->second];
+    tree[index].bounds = box_of(segment);
+    for (index = tree[index].parent; index != -1; index = tree[index].parent) refit(index);
+  }
+}
+
+int segment_bvh::nearest(const olc::vf2d& point, float max_distance) const
+{
+  if (not built or tree.empty()) return -1;
+
+  float best_distance = max_distance * max_distance;
+  int best_segment = -1;
+
+  // Depth first, visiting the closer child first so the limit shrinks as early as possible. Splitting at the median keeps
+  // the tree balanced, so its depth (and with that the number of entries on the stack) stays below 64 for any size.
+  int stack[64];
+  int stack_size = 0;
+  stack[stack_size++] = 0;
+  while (stack_size > 0)
+  {
+    int index = stack[--stack_size];
+
+    const tree_node& node = tree[index];
+    if (squared_distance_to_box(point, node.bounds) > best_distance) continue;
+
+    if (node.segment != -1)
+    {
+      float distance = squared_distance_to_segment(point, segments[node.segment]);
+      if (distance < best_distance or (distance == best_distance and best_segment == -1))
+      {
+        best_distance = distance;
+        best_segment = node.segment;
+      }
+      continue;
+    }
+
+    float near_left = squared_distance_to_box(point, tree[node.children[0]].bounds);
+    float near_right = squared_distance_to_box(point, tree[node.children[1]].bounds);
+    bool left_first = near_left <= near_right;
+    stack[stack_size++] = node.children[left_first ? 1 : 0];
+    stack[stack_size++] = node.children[left_first ? 0 : 1];
+  }
+
+  return best_segment;
+}
+
+segment_bvh::box segment_bvh::box_of(const segment& segment)
+{
+  return {std::min(segment.a.x, segment.b.x), std::min(segment.a.y, segment.b.y), std::max(segment.a.x, segment.b.x), std::max(segment.a.y, segment.b.y)};
+}
+
+segment_bvh::box segment_bvh::merge(const box& a, const box& b)
+{
+  return {std::min(a.left, b.left), std::min(a.top, b.top), std::max(a.right, b.right), std::max(a.bottom, b.bottom)};
+}
+
+float segment_bvh::squared_distance_to_box(const olc::vf2d& point, const box& box)
+{
+  float dx = std::max({box.left - point.x, 0.0f, point.x - box.right});
+  float dy = std::max({box.top - point.y, 0.0f, point.y - box.bottom});
+  return dx * dx + dy * dy;
+}
+
+float segment_bvh::squared_distance_to_segment(const olc::vf2d& point, const segment& segment)
+{
+  olc::vf2d direction = segment.b - segment.a;
+  float length_squared = direction.mag2();
+
+  // Projecting the point onto the segment, clamped to its ends (a zero length segment is just its start)
+  float t = (length_squared > 0.0f ? std::clamp((point - segment.a).dot(direction) / length_squared, 0.0f, 1.0f) : 0.0f);
+  olc::vf2d closest = segment.a + direction * t;
+  return (point - closest).mag2();
+}
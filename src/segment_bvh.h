@@ -0,0 +1,84 @@
+#pragma once
+
+#include "olcPixelGameEngine.h"
+#include "line.h"
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+// Bounding volume hierarchy over the line segments between nodes, used to find the line closest to a point in O(log E).
+// Adding or removing lines invalidates it and it gets rebuilt on the next query; moving a node only refits the boxes on
+// the way from the lines touching that node up to the root.
+class segment_bvh
+{
+public:
+  void build(const std::vector<line>& lines, const std::map<int, olc::vi2d>& nodes);
+  void invalidate();
+  bool is_built() const;
+
+  // Updates the segments coming from/going to the node after it moved
+  void refit_node(int node, const std::map<int, olc::vi2d>& nodes);
+
+  // Index (into the lines it was built from) of the line closest to the point within max_distance, -1 if there is none
+  int nearest(const olc::vf2d& point, float max_distance) const;
+
+  // Calls function(index) for every line whose bounds overlap the rectangle spanned by the two corners, in no particular
+  // order
+  template<typename function_type>
+  void for_each_in_rect(const olc::vf2d& top_left, const olc::vf2d& bottom_right, function_type&& function) const
+  {
+    if (not built or tree.empty()) return;
+
+    // The depth stays below 64 for the same reason as in nearest()
+    int stack[64];
+    int stack_size = 0;
+    stack[stack_size++] = 0;
+    while (stack_size > 0)
+    {
+      const tree_node& node = tree[stack[--stack_size]];
+      if (node.bounds.right < top_left.x or node.bounds.left > bottom_right.x or node.bounds.bottom < top_left.y or node.bounds.top > bottom_right.y) continue;
+
+      if (node.segment != -1) function(node.segment);
+      else
+      {
+        stack[stack_size++] = node.children[0];
+        stack[stack_size++] = node.children[1];
+      }
+    }
+  }
+
+private:
+  struct box
+  {
+    float left, top, right, bottom;
+  };
+
+  struct tree_node
+  {
+    box bounds = {};
+    int children[2] = {-1, -1}; // Both -1 for leaves
+    int parent = -1;
+    int segment = -1; // Only set for leaves
+  };
+
+  struct segment
+  {
+    int from;
+    int to;
+    olc::vf2d a;
+    olc::vf2d b;
+  };
+
+  bool built = false;
+  std::vector<tree_node> tree = {};
+  std::vector<segment> segments = {};
+  std::vector<int> leaf_of_segment = {};
+  std::unordered_multimap<int, int> segments_of_node = {};
+
+  int build_range(std::vector<int>& order, int first, int last, int parent);
+  void refit(int index);
+  static box box_of(const segment& segment);
+  static box merge(const box& a, const box& b);
+  static float squared_distance_to_box(const olc::vf2d& point, const box& box);
+  static float squared_distance_to_segment(const olc::vf2d& point, const segment& segment);
+};
@@ -0,0 +1,184 @@
+#include "spatial_hash.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__x86_64__) or defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+  // Squared distances from every candidate from the ith on to the point, keeping the nearest one in best_distance/best_id.
+  // Coordinates within a few cells of each other are small, so the squares comfortably fit into 32 bits.
+  void nearest_in_rest(const int32_t* ids, const int32_t* xs, const int32_t* ys, size_t i, size_t count, const olc::vi2d& point, int32_t& best_distance, int32_t& best_id)
+  {
+    // Selects instead of branching, on locals the compiler can keep in registers
+    int32_t distance_so_far = best_distance;
+    int32_t id_so_far = best_id;
+    for (; i < count; i++)
+    {
+      int32_t dx = xs[i] - point.x;
+      int32_t dy = ys[i] - point.y;
+      int32_t distance = dx * dx + dy * dy;
+      bool better = distance < distance_so_far or (distance == distance_so_far and ids[i] < id_so_far);
+      distance_so_far = better ? distance : distance_so_far;
+      id_so_far = better ? ids[i] : id_so_far;
+    }
+    best_distance = distance_so_far;
+    best_id = id_so_far;
+  }
+
+#if defined(__x86_64__) or defined(__i386__)
+  // The same for 8 candidates per step, every lane tracking its own best which get reduced at the end. Compiled for AVX2
+  // whatever the build flags are, so it may only be called once the CPU is known to have it.
+  __attribute__((target("avx2"))) void nearest_in_batch_avx2(const int32_t* ids, const int32_t* xs, const int32_t* ys, size_t count, const olc::vi2d& point, int32_t& best_distance, int32_t& best_id)
+  {
+    size_t i = 0;
+    if (count >= 8)
+    {
+      const __m256i px = _mm256_set1_epi32(point.x);
+      const __m256i py = _mm256_set1_epi32(point.y);
+      __m256i lane_distance = _mm256_set1_epi32(best_distance);
+      __m256i lane_id = _mm256_set1_epi32(best_id);
+
+      for (; i + 8 <= count; i += 8)
+      {
+        __m256i dx = _mm256_sub_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(xs + i)), px);
+        __m256i dy = _mm256_sub_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(ys + i)), py);
+        __m256i distance = _mm256_add_epi32(_mm256_mullo_epi32(dx, dx), _mm256_mullo_epi32(dy, dy));
+        __m256i id = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ids + i));
+
+        __m256i closer = _mm256_cmpgt_epi32(lane_distance, distance);
+        __m256i tie = _mm256_and_si256(_mm256_cmpeq_epi32(lane_distance, distance), _mm256_cmpgt_epi32(lane_id, id));
+        __m256i better = _mm256_or_si256(closer, tie);
+
+        lane_distance = _mm256_blendv_epi8(lane_distance, distance, better);
+        lane_id = _mm256_blendv_epi8(lane_id, id, better);
+      }
+
+      alignas(32) int32_t distances[8];
+      alignas(32) int32_t lane_ids[8];
+      _mm256_store_si256(reinterpret_cast<__m256i*>(distances), lane_distance);
+      _mm256_store_si256(reinterpret_cast<__m256i*>(lane_ids), lane_id);
+      // Everything from here on is compiled without AVX, which runs slowly while the upper halves of the registers are dirty
+      _mm256_zeroupper();
+
+      int32_t distance_so_far = best_distance;
+      int32_t id_so_far = best_id;
+      for (int lane = 0; lane < 8; lane++)
+      {
+        bool better = distances[lane] < distance_so_far or (distances[lane] == distance_so_far and lane_ids[lane] < id_so_far);
+        distance_so_far = better ? distances[lane] : distance_so_far;
+        id_so_far = better ? lane_ids[lane] : id_so_far;
+      }
+      best_distance = distance_so_far;
+      best_id = id_so_far;
+    }
+
+    nearest_in_rest(ids, xs, ys, i, count, point, best_distance, best_id);
+  }
+#endif
+
+  // Picks the AVX2 version when the CPU running this has it and there are enough candidates to make up for calling it
+  // (it can't be inlined here)
+  void nearest_in_batch(const int32_t* ids, const int32_t* xs, const int32_t* ys, size_t count, const olc::vi2d& point, int32_t& best_distance, int32_t& best_id)
+  {
+#if defined(__x86_64__) or defined(__i386__)
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    if (has_avx2 and count >= 16)
+    {
+      nearest_in_batch_avx2(ids, xs, ys, count, point, best_distance, best_id);
+      return;
+    }
+#endif
+    nearest_in_rest(ids, xs, ys, 0, count, point, best_distance, best_id);
+  }
+}
+
+void spatial_hash::insert(int id, const olc::vi2d& position)
+{
+  cell& cell = cells[key_of(cell_of(position))];
+  cell.ids.push_back(id);
+  cell.xs.push_back(position.x);
+  cell.ys.push_back(position.y);
+}
+
+void spatial_hash::erase(int id, const olc::vi2d& position)
+{
+  auto found = cells.find(key_of(cell_of(position)));
+  if (found == cells.end()) return;
+
+  // Order within a cell doesn't matter, so the ID is swapped to the back and popped
+  cell& cell = found->second;
+  auto index = std::find(cell.ids.begin(), cell.ids.end(), id) - cell.ids.begin();
+  if (index == int(cell.ids.size())) return;
+
+  cell.ids[index] = cell.ids.back();
+  cell.xs[index] = cell.xs.back();
+  cell.ys[index] = cell.ys.back();
+  cell.ids.pop_back();
+  cell.xs.pop_back();
+  cell.ys.pop_back();
+
+  if (cell.ids.empty()) cells.erase(found);
+}
+
+void spatial_hash::move(int id, const olc::vi2d& from, const olc::vi2d& to)
+{
+  // Most moves (i.e. every frame of dragging a node) stay within the same cell
+  if (cell_of(from) == cell_of(to))
+  {
+    cell& cell = cells[key_of(cell_of(from))];
+    for (size_t i = 0; i < cell.ids.size(); i++)
+    {
+      if (cell.ids[i] != id) continue;
+      cell.xs[i] = to.x;
+      cell.ys[i] = to.y;
+    }
+    return;
+  }
+
+  erase(id, from);
+  insert(id, to);
+}
+
+void spatial_hash::clear()
+{
+  cells.clear();
+}
+
+int spatial_hash::nearest_within(const olc::vi2d& position, int max_distance_squared) const
+{
+  int reach = int(std::ceil(std::sqrt(double(max_distance_squared))));
+  olc::vi2d first = cell_of(position - olc::vi2d{reach, reach});
+  olc::vi2d last = cell_of(position + olc::vi2d{reach, reach});
+
+  // Starting just outside of the limit means anything that ends up as the best is within it
+  int32_t best_distance = max_distance_squared + 1;
+  int32_t best_id = std::numeric_limits<int32_t>::max();
+
+  for (int y = first.y; y <= last.y; y++)
+    for (int x = first.x; x <= last.x; x++)
+    {
+      auto found = cells.find(key_of({x, y}));
+      if (found == cells.end()) continue;
+
+      const cell& cell = found->second;
+      nearest_in_batch(cell.ids.data(), cell.xs.data(), cell.ys.data(), cell.ids.size(), position, best_distance, best_id);
+    }
+
+  return best_distance <= max_distance_squared ? best_id : 0;
+}
+
+olc::vi2d spatial_hash::cell_of(const olc::vi2d& position) const
+{
+  // Rounding towards negative infinity, plain division would put -1 and 1 into the same cell
+  auto floor_div = [&](int value) { return value >= 0 ? value / cell_size : -((-value + cell_size - 1) / cell_size); };
+  return {floor_div(position.x), floor_div(position.y)};
+}
+
+uint64_t spatial_hash::key_of(const olc::vi2d& cell)
+{
+  return (uint64_t(uint32_t(cell.x)) << 32) | uint64_t(uint32_t(cell.y));
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "olcPixelGameEngine.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Uniform grid over world space, bucketing node IDs by the cell their position falls into. Only the non-empty cells are
+// stored, so the size of the world doesn't matter. With a cell size of about twice the node radius, everything that can
+// touch a point lies in the 3x3 cells around it, which makes picking and overlap tests O(1) expected. The positions are
+// kept next to the IDs (as separate x and y arrays) so a whole cell can be tested at once without a lookup elsewhere.
+class spatial_hash
+{
+public:
+  explicit spatial_hash(int cell_size) : cell_size(cell_size) {}
+
+  void insert(int id, const olc::vi2d& position);
+  void erase(int id, const olc::vi2d& position);
+  void move(int id, const olc::vi2d& from, const olc::vi2d& to);
+  void clear();
+
+  // The node closest to the position whose squared distance to it is at most max_distance_squared, 0 if there is none;
+  // ties go to the lower ID
+  int nearest_within(const olc::vi2d& position, int max_distance_squared) const;
+
+  // Calls function(id, position) for every node inside of the rectangle spanned by the two corners (edges included)
+  template<typename function_type>
+  void for_each_in_rect(const olc::vi2d& top_left, const olc::vi2d& bottom_right, function_type&& function) const
+  {
+    olc::vi2d first = cell_of(top_left);
+    olc::vi2d last = cell_of(bottom_right);
+
+    auto visit = [&](const cell& cell)
+    {
+      for (size_t i = 0; i < cell.ids.size(); i++)
+      {
+        if (cell.xs[i] < top_left.x or cell.xs[i] > bottom_right.x or cell.ys[i] < top_left.y or cell.ys[i] > bottom_right.y) continue;
+        function(cell.ids[i], olc::vi2d{cell.xs[i], cell.ys[i]});
+      }
+    };
+
+    // A rectangle covering more cells than there are non-empty ones (i.e. zoomed far out) is cheaper to check by going
+    // through the non-empty cells instead
+    if ((int64_t(last.x) - first.x + 1) * (int64_t(last.y) - first.y + 1) > int64_t(cells.size()))
+    {
+      for (const auto& entry : cells) visit(entry.second);
+      return;
+    }
+
+    for (int y = first.y; y <= last.y; y++)
+      for (int x = first.x; x <= last.x; x++)
+      {
+        auto found = cells.find(key_of({x, y}));
+        if (found != cells.end()) visit(found->second);
+      }
+  }
+
+private:
+  struct cell
+  {
+    std::vector<int32_t> ids = {};
+    std::vector<int32_t> xs = {};
+    std::vector<int32_t> ys = {};
+  };
+
+  int cell_size;
+  std::unordered_map<uint64_t, cell> cells = {};
+
+  olc::vi2d cell_of(const olc::vi2d& position) const;
+  static uint64_t key_of(const olc::vi2d& cell);
+};
@@ -0,0 +1,745 @@
+#include "spectral_layout.h"
+#include "parallel.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <numeric>
+#include <random>
+
+namespace
+{
+  // Everything below works on blocks of two vectors (one for x, one for y), stored interleaved: entry 2 * i + k is node
+  // i's entry of vector k, so a product with the Laplacian reads every neighbour once for both
+  constexpr int width = 2;
+
+  // LOBPCG looks for the best vectors among the current ones, their residuals and their previous change
+  constexpr int max_columns = 3 * width;
+
+  // Nodes handled by a thread at a time
+  constexpr int chunk_size = 4096;
+
+  // Row major, only the top left size x size part is used
+  using small_matrix = std::array<double, max_columns * max_columns>;
+  using small_vector = std::array<double, max_columns>;
+
+  double& at(small_matrix& matrix, int row, int column)
+  {
+    return matrix[row * max_columns + column];
+  }
+
+  // Eigenvalues (ascending) and eigenvectors (as columns) of a small symmetric matrix, by cyclic Jacobi rotations
+  void small_eigen(int size, small_matrix a, small_vector& values, small_matrix& vectors)
+  {
+    // Callers never pass more than max_columns, but the compiler has to see that to know sorting order[0, size) below
+    // stays inside of it
+    size = std::clamp(size, 0, max_columns);
+    vectors.fill(0.0);
+    for (int i = 0; i < size; i++) at(vectors, i, i) = 1.0;
+
+    double norm = 0.0;
+    for (int p = 0; p < size; p++)
+      for (int q = 0; q < size; q++) norm += at(a, p, q) * at(a, p, q);
+
+    for (int sweep = 0; sweep < 50; sweep++)
+    {
+      double off_diagonal = 0.0;
+      for (int p = 0; p < size; p++)
+        for (int q = p + 1; q < size; q++) off_diagonal += at(a, p, q) * at(a, p, q);
+      if (off_diagonal <= 1e-30 * norm) break;
+
+      for (int p = 0; p < size; p++)
+        for (int q = p + 1; q < size; q++)
+        {
+          if (at(a, p, q) == 0.0) continue;
+
+          // The rotation in the (p, q) plane which zeroes a[p][q]
+          double theta = (at(a, q, q) - at(a, p, p)) / (2.0 * at(a, p, q));
+          double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+          double c = 1.0 / std::sqrt(t * t + 1.0);
+          double s = t * c;
+
+          for (int k = 0; k < size; k++)
+          {
+            double kp = at(a, k, p);
+            double kq = at(a, k, q);
+            at(a, k, p) = c * kp - s * kq;
+            at(a, k, q) = s * kp + c * kq;
+          }
+          for (int k = 0; k < size; k++)
+          {
+            double pk = at(a, p, k);
+            double qk = at(a, q, k);
+            at(a, p, k) = c * pk - s * qk;
+            at(a, q, k) = s * pk + c * qk;
+          }
+          for (int k = 0; k < size; k++)
+          {
+            double kp = at(vectors, k, p);
+            double kq = at(vectors, k, q);
+            at(vectors, k, p) = c * kp - s * kq;
+            at(vectors, k, q) = s * kp + c * kq;
+          }
+        }
+    }
+
+    std::array<int, max_columns> order = {};
+    std::iota(order.begin(), order.begin() + size, 0);
+    std::sort(order.begin(), order.begin() + size, [&](int i, int j) { return at(a, i, i) < at(a, j, j); });
+
+    small_matrix sorted = {};
+    for (int j = 0; j < size; j++)
+    {
+      values[j] = at(a, order[j], order[j]);
+      for (int i = 0; i < size; i++) at(sorted, i, j) = at(vectors, i, order[j]);
+    }
+    vectors = sorted;
+  }
+
+  // Adds a node's share to the top right half of the Laplacian (a) and D (b) restricted to the basis. The number of
+  // columns is fixed at compile time so the loops get unrolled, this being most of the work of an iteration.
+  template<int columns>
+  void add_row(const float* values, const float* value_products, double mass, small_matrix& a, small_matrix& b)
+  {
+    for (int row = 0; row < columns; row++)
+      for (int column = row; column < columns; column++)
+      {
+        at(a, row, column) += double(values[row]) * value_products[column];
+        at(b, row, column) += mass * values[row] * values[column];
+      }
+  }
+}
+
+spectral_layout::~spectral_layout()
+{
+  if (worker.joinable()) worker.join();
+}
+
+void spectral_layout::start()
+{
+  running = true;
+}
+
+void spectral_layout::stop()
+{
+  running = false;
+}
+
+bool spectral_layout::is_running() const
+{
+  return running;
+}
+
+float spectral_layout::milliseconds() const
+{
+  return shown_milliseconds;
+}
+
+bool spectral_layout::has_same_nodes(const std::map<int, olc::vi2d>& nodes) const
+{
+  if (ids.size() != nodes.size()) return false;
+
+  size_t i = 0;
+  for (const auto& node : nodes)
+    if (ids[i++] != node.first) return false;
+
+  return true;
+}
+
+void spectral_layout::gather(const std::map<int, olc::vi2d>& nodes, const std::vector<line>& lines)
+{
+  ids.clear();
+  centre = {0.0f, 0.0f};
+  for (const auto& node : nodes)
+  {
+    ids.push_back(node.first);
+    centre += olc::vf2d(node.second) / float(nodes.size());
+  }
+  lines_snapshot = lines;
+}
+
+void spectral_layout::compute()
+{
+  auto started = std::chrono::steady_clock::now();
+  int count = int(ids.size());
+  xs.assign(count, centre.x);
+  ys.assign(count, centre.y);
+  if (count == 0) return;
+
+  level graph = build_graph();
+
+  // The connected parts of the graph, biggest first. Each one is laid out on its own: together, the eigenvectors with the
+  // smallest eigenvalues would only tell the parts apart (being constant on each) rather than show any of them.
+  std::vector<std::vector<int>> components = {};
+  std::vector<char> found(count, 0);
+  for (int root = 0; root < count; root++)
+  {
+    if (found[root]) continue;
+
+    found[root] = 1;
+    std::vector<int> members = {root};
+    for (size_t next = 0; next < members.size(); next++)
+      for (int edge = graph.offsets[members[next]]; edge < graph.offsets[members[next] + 1]; edge++)
+      {
+        int neighbour = graph.neighbours[edge];
+        if (found[neighbour]) continue;
+
+        found[neighbour] = 1;
+        members.push_back(neighbour);
+      }
+    components.push_back(std::move(members));
+  }
+  std::stable_sort(components.begin(), components.end(), [](const auto& a, const auto& b) { return a.size() > b.size(); });
+
+  // Every part laid out around 0, along with its bounds
+  std::vector<olc::vf2d> positions(count, {0.0f, 0.0f});
+  std::vector<std::pair<olc::vf2d, olc::vf2d>> bounds(components.size(), {{0.0f, 0.0f}, {0.0f, 0.0f}});
+  std::vector<int> local_index(count, -1);
+  for (size_t component = 0; component < components.size(); component++)
+  {
+    const std::vector<int>& members = components[component];
+    if (members.size() == 1) continue;
+
+    for (int i = 0; i < int(members.size()); i++) local_index[members[i]] = i;
+    levels.clear();
+    levels.push_back(extract(graph, members, local_index));
+    std::vector<float> vectors = lay_out_levels();
+
+    olc::vf2d top_left = {INFINITY, INFINITY};
+    olc::vf2d bottom_right = {-INFINITY, -INFINITY};
+    for (int i = 0; i < int(members.size()); i++)
+    {
+      olc::vf2d position = {vectors[size_t(i) * width], vectors[size_t(i) * width + 1]};
+      positions[members[i]] = position;
+      top_left = top_left.min(position);
+      bottom_right = bottom_right.max(position);
+    }
+    bounds[component] = {top_left, bottom_right};
+  }
+  levels = {};
+
+  // The parts go into rows from left to right, biggest first, the rows being about as wide as all of the parts would be
+  // high if they made up a square
+  float gap = unit_length;
+  double area = 0.0;
+  float widest = 0.0f;
+  for (const auto& [top_left, bottom_right] : bounds)
+  {
+    olc::vf2d size = bottom_right - top_left + olc::vf2d{gap, gap};
+    area += double(size.x) * size.y;
+    widest = std::max(widest, size.x);
+  }
+  float row_width = std::max(widest, float(std::sqrt(area)));
+
+  std::vector<olc::vf2d> offsets(components.size());
+  olc::vf2d corner = {0.0f, 0.0f};
+  float row_height = 0.0f;
+  for (size_t component = 0; component < components.size(); component++)
+  {
+    olc::vf2d size = bounds[component].second - bounds[component].first + olc::vf2d{gap, gap};
+    if (corner.x > 0.0f and corner.x + size.x > row_width)
+    {
+      corner = {0.0f, corner.y + row_height};
+      row_height = 0.0f;
+    }
+
+    offsets[component] = corner - bounds[component].first;
+    corner.x += size.x;
+    row_height = std::max(row_height, size.y);
+  }
+
+  // Centred where the nodes were
+  olc::vf2d middle = olc::vf2d{row_width - gap, corner.y + row_height - gap} / 2.0f;
+  for (size_t component = 0; component < components.size(); component++)
+    for (int node : components[component])
+    {
+      olc::vf2d position = centre + positions[node] + offsets[component] - middle;
+      xs[node] = position.x;
+      ys[node] = position.y;
+    }
+
+  computed_milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - started).count();
+}
+
+// Coarsens the level in levels (a connected graph), finds the eigenvectors level by level and returns them scaled so
+// that the lines get the unit length on average, centred around 0
+std::vector<float> spectral_layout::lay_out_levels()
+{
+  coarsen();
+
+  // The coarsest level starts out from random vectors, every finer one from the vectors of the level above it
+  std::vector<float> vectors(size_t(levels.back().count) * width);
+  std::mt19937 random(1);
+  std::uniform_real_distribution<float> start(-1.0f, 1.0f);
+  for (float& value : vectors) value = start(random);
+  solve(levels.back(), vectors, coarsest_iterations);
+
+  for (int index = int(levels.size()) - 1; index > 0; index--)
+  {
+    const std::vector<int>& parents = levels[index].parents;
+    std::vector<float> finer(parents.size() * width);
+    for (size_t i = 0; i < parents.size(); i++)
+      for (int k = 0; k < width; k++) finer[i * width + k] = vectors[size_t(parents[i]) * width + k];
+
+    vectors.swap(finer);
+    solve(levels[index - 1], vectors, iterations_per_level);
+  }
+
+  // The eigenvectors only give the shape, the lines' weights being 1 / length give the scale
+  const level& graph = levels[0];
+  double stretch = 0.0;
+  double mean_x = 0.0;
+  double mean_y = 0.0;
+  for (int i = 0; i < graph.count; i++)
+  {
+    for (int edge = graph.offsets[i]; edge < graph.offsets[i + 1]; edge++)
+    {
+      int j = graph.neighbours[edge];
+      stretch += std::hypot(vectors[size_t(i) * width] - vectors[size_t(j) * width], vectors[size_t(i) * width + 1] - vectors[size_t(j) * width + 1]) * graph.weights[edge];
+    }
+    mean_x += vectors[size_t(i) * width] / double(graph.count);
+    mean_y += vectors[size_t(i) * width + 1] / double(graph.count);
+  }
+  int line_ends = graph.offsets[graph.count];
+  float scale = (stretch > 0.0 ? float(unit_length * line_ends / stretch) : unit_length);
+  for (int i = 0; i < graph.count; i++)
+  {
+    vectors[size_t(i) * width] = float(vectors[size_t(i) * width] - mean_x) * scale;
+    vectors[size_t(i) * width + 1] = float(vectors[size_t(i) * width + 1] - mean_y) * scale;
+  }
+
+  return vectors;
+}
+
+spectral_layout::level spectral_layout::build_graph() const
+{
+  int count = int(ids.size());
+
+  // IDs are sorted (they come from a map), so a line's ends are found by binary search
+  auto index_of = [&](int id)
+  {
+    auto found = std::lower_bound(ids.begin(), ids.end(), id);
+    return (found != ids.end() and *found == id ? int(found - ids.begin()) : -1);
+  };
+
+  // Lines go both ways here, each weighted by 1 / its length: they are counted first, then filled in. Several lines
+  // between the same two nodes simply stay separate entries.
+  std::vector<std::pair<int, int>> ends(lines_snapshot.size());
+  level graph;
+  graph.count = count;
+  graph.offsets.assign(count + 1, 0);
+  for (size_t i = 0; i < lines_snapshot.size(); i++)
+  {
+    int from = index_of(lines_snapshot[i].from);
+    int to = index_of(lines_snapshot[i].to);
+    ends[i] = {from, to};
+    if (from == -1 or to == -1 or from == to) continue;
+
+    graph.offsets[from + 1]++;
+    graph.offsets[to + 1]++;
+  }
+  for (int i = 0; i < count; i++) graph.offsets[i + 1] += graph.offsets[i];
+
+  graph.neighbours.resize(graph.offsets[count]);
+  graph.weights.resize(graph.offsets[count]);
+  std::vector<int> filled(graph.offsets.begin(), graph.offsets.end() - 1);
+  for (size_t i = 0; i < lines_snapshot.size(); i++)
+  {
+    auto [from, to] = ends[i];
+    if (from == -1 or to == -1 or from == to) continue;
+
+    float weight = 1.0f / float(std::max(1, lines_snapshot[i].length));
+    graph.neighbours[filled[from]] = to;
+    graph.weights[filled[from]++] = weight;
+    graph.neighbours[filled[to]] = from;
+    graph.weights[filled[to]++] = weight;
+  }
+
+  return graph;
+}
+
+// The part of the graph made up of the members (numbered by local_index), with the weighted degrees filled in
+spectral_layout::level spectral_layout::extract(const level& graph, const std::vector<int>& members, const std::vector<int>& local_index) const
+{
+  level part;
+  part.count = int(members.size());
+  part.offsets.assign(part.count + 1, 0);
+  for (int i = 0; i < part.count; i++) part.offsets[i + 1] = part.offsets[i] + graph.offsets[members[i] + 1] - graph.offsets[members[i]];
+
+  part.neighbours.resize(part.offsets[part.count]);
+  part.weights.resize(part.offsets[part.count]);
+  part.diagonals.assign(part.count, 0.0f);
+  for (int i = 0; i < part.count; i++)
+  {
+    int first = graph.offsets[members[i]];
+    for (int k = 0; k < part.offsets[i + 1] - part.offsets[i]; k++)
+    {
+      part.neighbours[part.offsets[i] + k] = local_index[graph.neighbours[first + k]];
+      part.weights[part.offsets[i] + k] = graph.weights[first + k];
+      part.diagonals[i] += graph.weights[first + k];
+    }
+  }
+
+  part.masses = part.diagonals;
+  part.total_mass = std::accumulate(part.masses.begin(), part.masses.end(), 0.0);
+  return part;
+}
+
+// Merges every node with the unmerged neighbour it has the heaviest line to (visiting the nodes in random order) until the
+// graph is small enough or stops shrinking
+void spectral_layout::coarsen()
+{
+  std::mt19937 random(1);
+
+  while (levels.back().count > coarsest_size)
+  {
+    const level& finer = levels.back();
+    int count = finer.count;
+
+    std::vector<int> visit_order(count);
+    std::iota(visit_order.begin(), visit_order.end(), 0);
+    std::shuffle(visit_order.begin(), visit_order.end(), random);
+
+    level coarser;
+    coarser.parents.assign(count, -1);
+    for (const int& node : visit_order)
+    {
+      if (coarser.parents[node] != -1) continue;
+
+      // The heaviest line to a node not merged yet, and the heaviest one to a node merged already
+      int partner = -1;
+      int merged = -1;
+      float heaviest_partner = 0.0f;
+      float heaviest_merged = 0.0f;
+      for (int edge = finer.offsets[node]; edge < finer.offsets[node + 1]; edge++)
+      {
+        int neighbour = finer.neighbours[edge];
+        float weight = finer.weights[edge];
+        if (coarser.parents[neighbour] == -1 and weight > heaviest_partner)
+        {
+          partner = neighbour;
+          heaviest_partner = weight;
+        }
+        else if (coarser.parents[neighbour] != -1 and weight > heaviest_merged)
+        {
+          merged = neighbour;
+          heaviest_merged = weight;
+        }
+      }
+
+      // Nodes whose neighbours are all taken (like the leaves around a hub) join one of them rather than staying on their
+      // own, otherwise graphs with hubs would hardly get any smaller
+      if (partner == -1)
+      {
+        coarser.parents[node] = coarser.parents[merged];
+        continue;
+      }
+
+      coarser.parents[node] = coarser.count;
+      coarser.parents[partner] = coarser.count;
+      coarser.count++;
+    }
+
+    // Hardly anything could be merged, another level would only cost time
+    if (coarser.count > count - count / 10) break;
+
+    coarser.masses.assign(coarser.count, 0.0f);
+    for (int i = 0; i < count; i++) coarser.masses[coarser.parents[i]] += finer.masses[i];
+    coarser.total_mass = finer.total_mass;
+
+    // The lines between the merged nodes (lines within a merged node drop out), first with every line of the finer level
+    // as an entry of its own, then with the entries leading to the same node summed up
+    std::vector<int> offsets(coarser.count + 1, 0);
+    for (int i = 0; i < count; i++)
+      for (int edge = finer.offsets[i]; edge < finer.offsets[i + 1]; edge++)
+        if (coarser.parents[i] != coarser.parents[finer.neighbours[edge]]) offsets[coarser.parents[i] + 1]++;
+    for (int i = 0; i < coarser.count; i++) offsets[i + 1] += offsets[i];
+
+    std::vector<std::pair<int, float>> entries(offsets[coarser.count]);
+    std::vector<int> filled(offsets.begin(), offsets.end() - 1);
+    for (int i = 0; i < count; i++)
+      for (int edge = finer.offsets[i]; edge < finer.offsets[i + 1]; edge++)
+      {
+        int from = coarser.parents[i];
+        int to = coarser.parents[finer.neighbours[edge]];
+        if (from != to) entries[filled[from]++] = {to, finer.weights[edge]};
+      }
+
+    std::vector<int> merged_counts(coarser.count, 0);
+    parallel_for(thread_count, coarser.count, chunk_size, [&](int first, int last)
+    {
+      for (int i = first; i < last; i++)
+      {
+        auto begin = entries.begin() + offsets[i];
+        auto end = entries.begin() + offsets[i + 1];
+        std::sort(begin, end, [](const auto& a, const auto& b) { return a.first < b.first; });
+
+        auto kept = begin;
+        for (auto entry = begin; entry != end; entry++)
+        {
+          if (kept != begin and (kept - 1)->first == entry->first) (kept - 1)->second += entry->second;
+          else *kept++ = *entry;
+        }
+        merged_counts[i] = int(kept - begin);
+      }
+    });
+
+    coarser.offsets.assign(coarser.count + 1, 0);
+    for (int i = 0; i < coarser.count; i++) coarser.offsets[i + 1] = coarser.offsets[i] + merged_counts[i];
+    coarser.neighbours.resize(coarser.offsets[coarser.count]);
+    coarser.weights.resize(coarser.offsets[coarser.count]);
+    coarser.diagonals.assign(coarser.count, 0.0f);
+    for (int i = 0; i < coarser.count; i++)
+      for (int k = 0; k < merged_counts[i]; k++)
+      {
+        coarser.neighbours[coarser.offsets[i] + k] = entries[offsets[i] + k].first;
+        coarser.weights[coarser.offsets[i] + k] = entries[offsets[i] + k].second;
+        coarser.diagonals[i] += entries[offsets[i] + k].second;
+      }
+
+    levels.push_back(std::move(coarser));
+  }
+}
+
+// The Laplacian times both vectors
+void spectral_layout::multiply(const level& level, const std::vector<float>& vectors, std::vector<float>& products) const
+{
+  parallel_for(thread_count, level.count, chunk_size, [&](int first, int last)
+  {
+    for (int i = first; i < last; i++)
+    {
+      float sum_x = 0.0f;
+      float sum_y = 0.0f;
+      for (int edge = level.offsets[i]; edge < level.offsets[i + 1]; edge++)
+      {
+        const float* neighbour = vectors.data() + size_t(level.neighbours[edge]) * width;
+        sum_x += level.weights[edge] * neighbour[0];
+        sum_y += level.weights[edge] * neighbour[1];
+      }
+
+      const float* own = vectors.data() + size_t(i) * width;
+      float* product = products.data() + size_t(i) * width;
+      product[0] = level.diagonals[i] * own[0] - sum_x;
+      product[1] = level.diagonals[i] * own[1] - sum_y;
+    }
+  });
+}
+
+// Takes the constant vector (the eigenvector with eigenvalue 0) out of both vectors, in the D weighted sense
+void spectral_layout::remove_constant(const level& level, std::vector<float>& vectors) const
+{
+  int count = level.count;
+  int chunk_count = (count + chunk_size - 1) / chunk_size;
+
+  std::vector<std::array<double, width>> partial_sums(chunk_count);
+  parallel_for(thread_count, count, chunk_size, [&](int first, int last)
+  {
+    std::array<double, width> sums = {};
+    for (int i = first; i < last; i++)
+      for (int k = 0; k < width; k++) sums[k] += double(level.masses[i]) * vectors[size_t(i) * width + k];
+    partial_sums[first / chunk_size] = sums;
+  });
+  std::array<float, width> constants = {};
+  for (const auto& sums : partial_sums)
+    for (int k = 0; k < width; k++) constants[k] += float(sums[k] / level.total_mass);
+
+  parallel_for(thread_count, count, chunk_size, [&](int first, int last)
+  {
+    for (int i = first; i < last; i++)
+      for (int k = 0; k < width; k++) vectors[size_t(i) * width + k] -= constants[k];
+  });
+}
+
+// LOBPCG for the two smallest eigenvalues of L x = lambda D x besides 0, starting from (and replacing) the vectors.
+// Every iteration finds the best two vectors within the span of the current ones, their residuals (scaled by 1 / D,
+// which is the preconditioner) and their previous change, by solving the eigenproblem of the Laplacian restricted to
+// those (Rayleigh-Ritz). Returns the number of iterations done.
+int spectral_layout::solve(const level& level, std::vector<float>& vectors, int max_iterations) const
+{
+  int count = level.count;
+  int chunk_count = (count + chunk_size - 1) / chunk_size;
+  size_t length = size_t(count) * width;
+
+  // The products of the Laplacian with the vectors, their residuals and their previous changes are kept up to date along
+  // with them, so an iteration only needs one product (for the residuals)
+  std::vector<float> products(length);
+  std::vector<float> residuals(length, 0.0f);
+  std::vector<float> residual_products(length, 0.0f);
+  std::vector<float> changes(length, 0.0f);
+  std::vector<float> change_products(length, 0.0f);
+  bool has_changes = false;
+
+  remove_constant(level, vectors);
+  multiply(level, vectors, products);
+
+  int iteration = 0;
+  while (true)
+  {
+    // The first round only puts the starting vectors in order
+    const std::vector<float>* basis[3] = {&vectors, &residuals, &changes};
+    const std::vector<float>* basis_products[3] = {&products, &residual_products, &change_products};
+    int block_count = (iteration == 0 ? 1 : (has_changes ? 3 : 2));
+    int columns = block_count * width;
+
+    // The Laplacian and D restricted to the basis, every thread summing up its share of the nodes on its own
+    std::vector<small_matrix> partial_as(chunk_count);
+    std::vector<small_matrix> partial_bs(chunk_count);
+    parallel_for(thread_count, count, chunk_size, [&](int first, int last)
+    {
+      small_matrix a = {};
+      small_matrix b = {};
+      float values[max_columns];
+      float value_products[max_columns];
+      for (int i = first; i < last; i++)
+      {
+        for (int block = 0; block < block_count; block++)
+          for (int k = 0; k < width; k++)
+          {
+            values[block * width + k] = (*basis[block])[size_t(i) * width + k];
+            value_products[block * width + k] = (*basis_products[block])[size_t(i) * width + k];
+          }
+
+        switch (columns)
+        {
+          case 2: add_row<2>(values, value_products, level.masses[i], a, b); break;
+          case 4: add_row<4>(values, value_products, level.masses[i], a, b); break;
+          default: add_row<6>(values, value_products, level.masses[i], a, b); break;
+        }
+      }
+      partial_as[first / chunk_size] = a;
+      partial_bs[first / chunk_size] = b;
+    });
+
+    small_matrix a = {};
+    small_matrix b = {};
+    for (int chunk = 0; chunk < chunk_count; chunk++)
+      for (size_t i = 0; i < a.size(); i++)
+      {
+        a[i] += partial_as[chunk][i];
+        b[i] += partial_bs[chunk][i];
+      }
+    for (int row = 0; row < columns; row++)
+      for (int column = row; column < columns; column++)
+      {
+        at(a, column, row) = at(a, row, column);
+        at(b, column, row) = at(b, row, column);
+      }
+
+    // Making the basis D-orthonormal: scaled to unit length first, then by the eigenvectors of D restricted to it,
+    // leaving out the directions the basis (nearly) doesn't span, which happens as the residuals go to 0
+    small_vector scales = {};
+    for (int column = 0; column < columns; column++) scales[column] = (at(b, column, column) > 0.0 ? 1.0 / std::sqrt(at(b, column, column)) : 0.0);
+    small_matrix scaled = {};
+    for (int row = 0; row < columns; row++)
+      for (int column = 0; column < columns; column++) at(scaled, row, column) = at(b, row, column) * scales[row] * scales[column];
+
+    small_vector b_values = {};
+    small_matrix b_vectors = {};
+    small_eigen(columns, scaled, b_values, b_vectors);
+
+    small_matrix orthonormal = {};
+    int kept = 0;
+    for (int j = 0; j < columns; j++)
+    {
+      if (b_values[j] <= 1e-6 * b_values[columns - 1]) continue;
+
+      for (int row = 0; row < columns; row++) at(orthonormal, row, kept) = scales[row] * at(b_vectors, row, j) / std::sqrt(b_values[j]);
+      kept++;
+    }
+    if (kept < width) break;
+
+    // The Laplacian in that basis, its two smallest eigenvectors being the best vectors
+    small_matrix reduced = {};
+    for (int i = 0; i < kept; i++)
+      for (int j = 0; j < kept; j++)
+      {
+        double sum = 0.0;
+        for (int row = 0; row < columns; row++)
+          for (int column = 0; column < columns; column++) sum += at(orthonormal, row, i) * at(a, row, column) * at(orthonormal, column, j);
+        at(reduced, i, j) = sum;
+      }
+
+    small_vector eigenvalues = {};
+    small_matrix eigenvectors = {};
+    small_eigen(kept, reduced, eigenvalues, eigenvectors);
+
+    float coefficients[max_columns][width];
+    for (int row = 0; row < columns; row++)
+      for (int k = 0; k < width; k++)
+      {
+        double sum = 0.0;
+        for (int j = 0; j < kept; j++) sum += at(orthonormal, row, j) * at(eigenvectors, j, k);
+        coefficients[row][k] = float(sum);
+      }
+
+    // The new vectors, their change being the part coming from the residuals and the previous change, and their new
+    // residuals L x - lambda D x, preconditioned by 1 / D
+    std::vector<std::array<double, width>> partial_norms(chunk_count);
+    parallel_for(thread_count, count, chunk_size, [&](int first, int last)
+    {
+      std::array<double, width> norms = {};
+      for (int i = first; i < last; i++)
+      {
+        float values[max_columns];
+        float value_products[max_columns];
+        for (int block = 0; block < block_count; block++)
+          for (int k = 0; k < width; k++)
+          {
+            values[block * width + k] = (*basis[block])[size_t(i) * width + k];
+            value_products[block * width + k] = (*basis_products[block])[size_t(i) * width + k];
+          }
+
+        for (int k = 0; k < width; k++)
+        {
+          float change = 0.0f;
+          float change_product = 0.0f;
+          for (int row = width; row < columns; row++)
+          {
+            change += values[row] * coefficients[row][k];
+            change_product += value_products[row] * coefficients[row][k];
+          }
+
+          float kept_value = 0.0f;
+          float kept_product = 0.0f;
+          for (int row = 0; row < width; row++)
+          {
+            kept_value += values[row] * coefficients[row][k];
+            kept_product += value_products[row] * coefficients[row][k];
+          }
+
+          size_t index = size_t(i) * width + k;
+          vectors[index] = kept_value + change;
+          products[index] = kept_product + change_product;
+          if (block_count > 1)
+          {
+            changes[index] = change;
+            change_products[index] = change_product;
+          }
+
+          float residual = products[index] - float(eigenvalues[k]) * level.masses[i] * vectors[index];
+          residuals[index] = residual / level.masses[i];
+          norms[k] += double(residual) * residual / level.masses[i];
+        }
+      }
+      partial_norms[first / chunk_size] = norms;
+    });
+    if (block_count > 1) has_changes = true;
+
+    if (iteration == max_iterations) break;
+    iteration++;
+
+    // Done once the residuals are small enough compared to the eigenvalues
+    bool converged = true;
+    for (int k = 0; k < width; k++)
+    {
+      double norm = 0.0;
+      for (const auto& norms : partial_norms) norm += norms[k];
+      if (std::sqrt(norm) > tolerance * eigenvalues[k]) converged = false;
+    }
+    if (converged) break;
+
+    remove_constant(level, residuals);
+    multiply(level, residuals, residual_products);
+  }
+
+  return iteration;
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "olcPixelGameEngine.h"
+#include "line.h"
+#include <atomic>
+#include <cmath>
+#include <map>
+#include <thread>
+#include <vector>
+
+// Spectral layout: the eigenvectors of the graph's Laplacian with the second and third smallest eigenvalues (the smallest
+// one, 0, belongs to the constant vector) put every node close to its neighbours while keeping the graph as a whole spread
+// out, so they are used as x and y right away. That makes a rough but quick first placement, which force_layout can then
+// refine. The degree normalised eigenvectors (L x = lambda D x) are used, as they keep nodes of high degree from pulling
+// everything else into a corner.
+//
+// The eigenvectors are found with LOBPCG (locally optimal block preconditioned conjugate gradients): every iteration
+// takes the best two vectors out of the current ones, their residuals and their previous change, so it only needs a
+// product with the sparse Laplacian (in CSR form, split over the threads) and a handful of dense products per iteration.
+// To get there in few iterations on big graphs, the graph is first coarsened by merging nodes along its heaviest lines;
+// the coarsest version is solved first and every finer level starts from the eigenvectors of the coarser one.
+//
+// Parts of the graph which aren't connected to each other are laid out one by one and then put next to each other.
+//
+// The whole placement runs on a background thread; update() hands it over to the nodes once it is done.
+class spectral_layout
+{
+public:
+  float unit_length = 40.0f; // World units the lines get on average, per unit of line length
+  int coarsest_size = 100; // Coarsening stops once a level has no more nodes than this
+  int coarsest_iterations = 300; // LOBPCG iterations on the coarsest level, at most
+  int iterations_per_level = 20; // LOBPCG iterations on every finer level, at most
+  float tolerance = 0.01f; // A level is done once the residuals are this small compared to the eigenvalues
+  int thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+  ~spectral_layout();
+
+  void start();
+  void stop();
+  bool is_running() const;
+
+  // How long the last placement took to compute, in milliseconds
+  float milliseconds() const;
+
+  // Called once per frame. Once the placement running in the background is done, it is written into the nodes (calling
+  // moved(id, from, to) for every node whose position changed) and the layout stops. It is thrown away instead if it was
+  // stopped in the meantime or the nodes changed.
+  template<typename function_type>
+  void update(std::map<int, olc::vi2d>& nodes, const std::vector<line>& lines, function_type&& moved)
+  {
+    if (worker.joinable())
+    {
+      if (not step_done) return;
+
+      worker.join();
+      shown_milliseconds = computed_milliseconds;
+      if (running and has_same_nodes(nodes))
+      {
+        size_t i = 0;
+        for (auto& node : nodes)
+        {
+          olc::vi2d to = {int(std::round(xs[i])), int(std::round(ys[i]))};
+          if (to != node.second)
+          {
+            moved(node.first, node.second, to);
+            node.second = to;
+          }
+          i++;
+        }
+      }
+      running = false;
+      return;
+    }
+
+    if (not running) return;
+
+    gather(nodes, lines);
+    step_done = false;
+    worker = std::thread([this]()
+    {
+      compute();
+      step_done = true;
+    });
+  }
+
+private:
+  // The graph or a coarser version of it, every node of the next finer level having been merged into one of its nodes.
+  // Its Laplacian is the one of the finer level summed up over the merged nodes, which keeps the eigenvectors alike.
+  struct level
+  {
+    int count = 0;
+    std::vector<int> parents = {}; // For every node of the next finer level, the node of this level it became part of
+    // The weighted lines of every node, node i's being [offsets[i], offsets[i + 1])
+    std::vector<int> offsets = {};
+    std::vector<int> neighbours = {};
+    std::vector<float> weights = {};
+    std::vector<float> diagonals = {}; // Of the Laplacian: the summed up weights of the node's lines
+    std::vector<float> masses = {}; // Of D: the weighted degrees of the nodes merged into the node
+    double total_mass = 0.0;
+  };
+
+  bool running = false;
+  std::thread worker;
+  std::atomic<bool> step_done = false;
+  float shown_milliseconds = 0.0f;
+
+  // Everything below is owned by the worker while the placement is being computed
+  std::vector<int> ids = {};
+  std::vector<line> lines_snapshot = {};
+  olc::vf2d centre = {0.0f, 0.0f}; // Where the nodes were centred, the placement is put there
+  std::vector<float> xs = {};
+  std::vector<float> ys = {};
+  std::vector<level> levels = {}; // The part of the graph being laid out first, then coarser and coarser
+  float computed_milliseconds = 0.0f;
+
+  bool has_same_nodes(const std::map<int, olc::vi2d>& nodes) const;
+  void gather(const std::map<int, olc::vi2d>& nodes, const std::vector<line>& lines);
+  void compute();
+  std::vector<float> lay_out_levels();
+  level build_graph() const;
+  level extract(const level& graph, const std::vector<int>& members, const std::vector<int>& local_index) const;
+  void coarsen();
+  void multiply(const level& level, const std::vector<float>& vectors, std::vector<float>& products) const;
+  void remove_constant(const level& level, std::vector<float>& vectors) const;
+  int solve(const level& level, std::vector<float>& vectors, int max_iterations) const;
+};
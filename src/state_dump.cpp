@@ -0,0 +1,184 @@
+#include "state_dump.h"
+#include "buffered_writer.h"
+#include "platform.h"
+#include <cmath>
+#include <cstdio>
+#include <string_view>
+
+namespace
+{
+  void write_string(buffered_writer& out, std::string_view text)
+  {
+    constexpr char digits[] = "0123456789abcdef";
+    out << '"';
+    for (char c : text)
+    {
+      if (c == '"' or c == '\\') out << '\\' << c;
+      else if (uint8_t(c) < 0x20) out << "\\u00" << digits[uint8_t(c) >> 4] << digits[uint8_t(c) & 15];
+      else out << c;
+    }
+    out << '"';
+  }
+
+  template<typename list_type, typename function_type>
+  void write_list(buffered_writer& out, const list_type& list, function_type&& write_element)
+  {
+    out << '[';
+    bool first = true;
+    for (const auto& element : list)
+    {
+      if (not first) out << ", ";
+      write_element(element);
+      first = false;
+    }
+    out << ']';
+  }
+
+  // JSON has no way to write infinities and NaN
+  void write_number(buffered_writer& out, double value)
+  {
+    if (std::isfinite(value)) out << value;
+    else out << "null";
+  }
+}
+
+state_dump::~state_dump()
+{
+  if (worker.joinable()) worker.join();
+}
+
+void state_dump::start(const std::map<int, olc::vi2d>& nodes, const std::vector<line>& lines, uint64_t version, uint64_t structure_version, app_state state, const std::string& path)
+{
+  if (running) return;
+
+  running = true;
+  started_at = std::chrono::system_clock::now();
+  dump_path = path;
+  snapshot.start(nodes, lines, version, structure_version);
+  this->state = std::move(state);
+}
+
+bool state_dump::update(const std::map<int, olc::vi2d>& nodes, const std::vector<line>& lines, uint64_t version, uint64_t structure_version)
+{
+  if (not running) return false;
+
+  if (snapshot.is_copying())
+  {
+    if (not snapshot.copy_some(nodes, lines, version, structure_version, copy_budget)) return false;
+
+    done = false;
+    worker = std::thread([this]()
+    {
+      write();
+      done = true;
+    });
+    return false;
+  }
+
+  if (not worker.joinable() or not done) return false;
+
+  worker.join();
+  running = false;
+  return true;
+}
+
+void state_dump::moved(int id, const olc::vi2d& to)
+{
+  // Once the snapshot is being written it belongs to the worker
+  if (not worker.joinable()) snapshot.moved(id, to);
+}
+
+bool state_dump::is_running() const
+{
+  return running;
+}
+
+const std::string& state_dump::error() const
+{
+  return failure;
+}
+
+const std::string& state_dump::path() const
+{
+  return dump_path;
+}
+
+float state_dump::milliseconds() const
+{
+  return computed_milliseconds;
+}
+
+void state_dump::write()
+{
+  auto started = std::chrono::steady_clock::now();
+  failure.clear();
+
+  buffered_writer out;
+  if (not out.open(dump_path, failure))
+  {
+    snapshot.release();
+    return;
+  }
+
+  // UTC, which std::chrono breaks down by itself
+  auto day = std::chrono::floor<std::chrono::days>(started_at);
+  std::chrono::year_month_day date(day);
+  std::chrono::hh_mm_ss time_of_day(std::chrono::floor<std::chrono::seconds>(started_at - day));
+  char time_text[32] = {};
+  std::snprintf(time_text, sizeof(time_text), "%04d-%02u-%02uT%02d:%02d:%02dZ", int(date.year()), unsigned(date.month()), unsigned(date.day()), int(time_of_day.hours().count()), int(time_of_day.minutes().count()), int(time_of_day.seconds().count()));
+
+  out << "{\n  \"time\": \"" << std::string_view(time_text) << "\",\n  \"mode\": ";
+  write_string(out, state.mode);
+  out << ",\n  \"camera\": {\"offset\": [";
+  write_number(out, state.camera_offset.x);
+  out << ", ";
+  write_number(out, state.camera_offset.y);
+  out << "], \"zoom\": ";
+  write_number(out, state.camera_zoom);
+  out << "},\n";
+  out << "  \"selected_node\": " << state.selected_node << ",\n  \"selected_line\": " << state.selected_line << ",\n  \"selected_nodes\": ";
+  write_list(out, state.selected_nodes, [&](int id) { out << id; });
+  out << ",\n  \"start\": " << state.start << ",\n  \"end\": " << state.end << ",\n  \"path\": ";
+  write_list(out, state.path, [&](int id) { out << id; });
+  out << ",\n  \"running\": ";
+  write_list(out, state.running, [&](const std::string& name) { write_string(out, name); });
+  out << ",\n  \"graph_version\": " << snapshot.version() << ",\n  \"node_count\": " << snapshot.nodes().size() << ",\n  \"line_count\": " << snapshot.lines().size() << ",\n";
+
+  out << "  \"nodes\": [";
+  for (size_t i = 0; i < snapshot.nodes().size(); i++)
+  {
+    const graph_file::node_record& node = snapshot.nodes()[i];
+    out << (i == 0 ? "\n    [" : ",\n    [") << node.id << ", " << node.x << ", " << node.y << ']';
+  }
+  out << "\n  ],\n  \"lines\": [";
+  for (size_t i = 0; i < snapshot.lines().size(); i++)
+  {
+    const line& line = snapshot.lines()[i];
+    out << (i == 0 ? "\n    [" : ",\n    [") << line.from << ", " << line.to << ", " << line.length << ']';
+  }
+  out << "\n  ],\n";
+
+  // The figures of the app, then what the dump itself took and how much memory the whole process uses
+  uint64_t resident_bytes = 0;
+  uint64_t peak_resident_bytes = 0;
+  platform::process_memory(resident_bytes, peak_resident_bytes);
+  std::vector<std::pair<std::string, double>> figures = state.figures;
+  figures.emplace_back("snapshot_frames", double(snapshot.frames()));
+  figures.emplace_back("snapshot_milliseconds", double(snapshot.milliseconds()));
+  figures.emplace_back("write_milliseconds", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count());
+  figures.emplace_back("resident_bytes", double(resident_bytes));
+  figures.emplace_back("peak_resident_bytes", double(peak_resident_bytes));
+  out << "  \"figures\": {";
+  for (size_t i = 0; i < figures.size(); i++)
+  {
+    out << (i == 0 ? "\n    " : ",\n    ");
+    write_string(out, figures[i].first);
+    out << ": ";
+    write_number(out, figures[i].second);
+  }
+  out << "\n  }\n}\n";
+
+  out.close(failure);
+  snapshot.release();
+  computed_milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - started).count();
+}
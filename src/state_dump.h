@@ -0,0 +1,78 @@
+#pragma once
+
+#include "olcPixelGameEngine.h"
+#include "graph_snapshot.h"
+#include "line.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Dumps everything the app holds into a JSON file for debugging: the app state as of the frame the dump was started in,
+// the graph, and figures about memory use and timing. The graph is copied a little every frame from then on, the way
+// autosave does it (nodes moving don't make it start over), so it is the graph as of a few frames later and no frame is
+// held up by a big one. The file is written on a background thread. Numbers that aren't finite (which JSON has no way to
+// write) become null.
+//
+//   {"time": ..., "mode": ..., "camera": {...}, "selected_node": ..., "selected_line": ..., "selected_nodes": [...],
+//    "start": ..., "end": ..., "path": [...], "running": [...], "graph_version": ..., "node_count": ..., "line_count": ...,
+//    "nodes": [[id, x, y], ...], "lines": [[from, to, length], ...], "figures": {...}}
+class state_dump
+{
+public:
+  // The app state besides the graph
+  struct app_state
+  {
+    std::string mode = {};
+    olc::vf2d camera_offset = {0.0f, 0.0f};
+    float camera_zoom = 1.0f;
+    int selected_node = 0;
+    int selected_line = -1;
+    std::vector<int> selected_nodes = {};
+    int start = 0;
+    int end = 0;
+    std::vector<int> path = {};
+    std::vector<std::string> running = {}; // What is running in the background (layouts, imports and so on)
+    std::vector<std::pair<std::string, double>> figures = {}; // Memory use, timings and the like, by name
+  };
+
+  float copy_budget = 2.0f; // Milliseconds per frame spent on copying the graph, more than autosave as a dump is waited for
+
+  ~state_dump();
+
+  // Starts a dump of the graph and the app state to the file at the path, unless one is under way already
+  void start(const std::map<int, olc::vi2d>& nodes, const std::vector<line>& lines, uint64_t version, uint64_t structure_version, app_state state, const std::string& path);
+  bool is_running() const;
+
+  // Called once per frame with the graph at its current versions (see graph_snapshot). Returns true once the dump is
+  // done, whether or not writing it worked (see error()).
+  bool update(const std::map<int, olc::vi2d>& nodes, const std::vector<line>& lines, uint64_t version, uint64_t structure_version);
+
+  // Has to be called for every node moving
+  void moved(int id, const olc::vi2d& to);
+
+  // As of the last dump handed over by update(): what went wrong (empty if nothing did), where it went and how long
+  // writing it took
+  const std::string& error() const;
+  const std::string& path() const;
+  float milliseconds() const;
+
+private:
+  bool running = false;
+  std::chrono::system_clock::time_point started_at = {};
+  std::thread worker;
+  std::atomic<bool> done = false;
+
+  // Everything below is owned by the worker while the file is being written
+  graph_snapshot snapshot; // Taken a little every frame before that
+  app_state state = {};
+  std::string dump_path = {};
+  std::string failure = {};
+  float computed_milliseconds = 0.0f;
+
+  void write();
+};
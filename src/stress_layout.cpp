@@ -0,0 +1,362 @@
+#include "stress_layout.h"
+#include "parallel.h"
+#include <algorithm>
+#include <numeric>
+#include <queue>
+#include <random>
+
+stress_layout::~stress_layout()
+{
+  if (worker.joinable()) worker.join();
+}
+
+void stress_layout::start()
+{
+  running = true;
+  first_step = true;
+}
+
+void stress_layout::stop()
+{
+  running = false;
+  if (worker.joinable()) stopped_in_flight = true;
+}
+
+bool stress_layout::is_running() const
+{
+  return running;
+}
+
+bool stress_layout::has_same_nodes(const std::map<int, olc::vi2d>& nodes) const
+{
+  if (ids.size() != nodes.size()) return false;
+
+  size_t i = 0;
+  for (const auto& node : nodes)
+    if (ids[i++] != node.first) return false;
+
+  return true;
+}
+
+void stress_layout::gather(const std::map<int, olc::vi2d>& nodes)
+{
+  // Keeping the fractional positions between iterations unless the nodes changed
+  if (has_same_nodes(nodes))
+  {
+    size_t i = 0;
+    for (const auto& node : nodes)
+    {
+      if (olc::vi2d{int(std::round(xs[i])), int(std::round(ys[i]))} != node.second)
+      {
+        xs[i] = float(node.second.x);
+        ys[i] = float(node.second.y);
+      }
+      i++;
+    }
+    return;
+  }
+
+  ids.clear();
+  xs.clear();
+  ys.clear();
+  for (const auto& node : nodes)
+  {
+    ids.push_back(node.first);
+    xs.push_back(float(node.second.x));
+    ys.push_back(float(node.second.y));
+  }
+}
+
+void stress_layout::compute_step(bool restart, bool place)
+{
+  int count = int(ids.size());
+  next_xs = xs;
+  next_ys = ys;
+  if (count == 0)
+  {
+    converged = true;
+    return;
+  }
+
+  if (restart)
+  {
+    build_graph();
+    find_pivot_distances();
+    iteration = 0;
+    converged = false;
+
+    if (place)
+    {
+      place_with_pivot_mds();
+      return;
+    }
+  }
+
+  iterate();
+}
+
+void stress_layout::build_graph()
+{
+  // Lines whose ends aren't both nodes are left out, and the copy of the lines isn't needed anymore after this
+  graph = compressed_lines(ids, lines_snapshot, true, thread_count);
+  std::vector<line>().swap(lines_snapshot);
+}
+
+void stress_layout::find_pivot_distances()
+{
+  int count = int(ids.size());
+
+  // Random pivots (rather than each one as far as possible from the ones before), so their searches can run in parallel
+  std::vector<int> candidates(count);
+  std::iota(candidates.begin(), candidates.end(), 0);
+  std::shuffle(candidates.begin(), candidates.end(), std::mt19937(1));
+  pivots.assign(candidates.begin(), candidates.begin() + std::min(pivot_count, count));
+  int pivot_total = int(pivots.size());
+
+  // Dijkstra from every pivot, one pivot per thread at a time
+  std::vector<float> by_pivot(size_t(pivot_total) * count, INFINITY);
+  parallel_for(thread_count, pivot_total, 1, [&](int first, int last)
+  {
+    using entry = std::pair<float, int>;
+    std::priority_queue<entry, std::vector<entry>, std::greater<entry>> queue;
+
+    for (int pivot = first; pivot < last; pivot++)
+    {
+      float* distances = by_pivot.data() + size_t(pivot) * count;
+      distances[pivots[pivot]] = 0.0f;
+      queue.push({0.0f, pivots[pivot]});
+
+      while (not queue.empty())
+      {
+        auto [distance, node] = queue.top();
+        queue.pop();
+        if (distance > distances[node]) continue;
+
+        graph.for_each_line_of(node, [&](int neighbour, int length)
+        {
+          float through = distance + unit_length * float(length);
+          if (through >= distances[neighbour]) return;
+
+          distances[neighbour] = through;
+          queue.push({through, neighbour});
+        });
+      }
+    }
+  });
+
+  // Every node belongs to the region of its closest pivot; the regions' distances are kept sorted for counting below
+  std::vector<std::vector<float>> regions(pivot_total);
+  for (int i = 0; i < count; i++)
+  {
+    int closest = 0;
+    for (int pivot = 1; pivot < pivot_total; pivot++)
+      if (by_pivot[size_t(pivot) * count + i] < by_pivot[size_t(closest) * count + i]) closest = pivot;
+
+    regions[closest].push_back(by_pivot[size_t(closest) * count + i]);
+  }
+  for (auto& region : regions) std::sort(region.begin(), region.end());
+
+  // The pivot's term for a node stands in for every node of its region that is at most half as far from the pivot
+  pivot_distances.resize(size_t(count) * pivot_total);
+  pivot_weights.resize(size_t(count) * pivot_total);
+  parallel_for(thread_count, count, 1024, [&](int first, int last)
+  {
+    for (int i = first; i < last; i++)
+      for (int pivot = 0; pivot < pivot_total; pivot++)
+      {
+        float distance = by_pivot[size_t(pivot) * count + i];
+        size_t index = size_t(i) * pivot_total + pivot;
+        pivot_distances[index] = distance;
+
+        if (distance == 0.0f or distance == INFINITY)
+        {
+          pivot_weights[index] = 0.0f;
+          continue;
+        }
+
+        const auto& region = regions[pivot];
+        float represented = float(std::upper_bound(region.begin(), region.end(), distance / 2.0f) - region.begin());
+        pivot_weights[index] = represented / (distance * distance);
+      }
+  });
+}
+
+// Classical MDS on the distances to the pivots only: the double centred squared distances C (nodes x pivots) give the
+// coordinates as C v for the two largest eigenvectors v of C^T C, which is only pivots x pivots
+void stress_layout::place_with_pivot_mds()
+{
+  int count = int(ids.size());
+  int pivot_total = int(pivots.size());
+  if (pivot_total < 2) return;
+
+  // Nodes which can't be reached from a pivot are treated as being as far from it as the furthest node which can
+  float longest = 0.0f;
+  for (const float& distance : pivot_distances)
+    if (distance != INFINITY) longest = std::max(longest, distance);
+
+  std::vector<float> centred(pivot_distances.size());
+  for (size_t i = 0; i < centred.size(); i++)
+  {
+    float distance = std::min(pivot_distances[i], longest);
+    centred[i] = distance * distance;
+  }
+
+  std::vector<double> row_means(count, 0.0);
+  std::vector<double> column_means(pivot_total, 0.0);
+  double mean = 0.0;
+  for (int i = 0; i < count; i++)
+    for (int pivot = 0; pivot < pivot_total; pivot++)
+    {
+      double value = centred[size_t(i) * pivot_total + pivot];
+      row_means[i] += value / pivot_total;
+      column_means[pivot] += value / count;
+      mean += value / (double(count) * pivot_total);
+    }
+  for (int i = 0; i < count; i++)
+    for (int pivot = 0; pivot < pivot_total; pivot++)
+    {
+      float& value = centred[size_t(i) * pivot_total + pivot];
+      value = float(-0.5 * (value - row_means[i] - column_means[pivot] + mean));
+    }
+
+  // C^T C as the sum of every node's outer product, every thread summing up its share of the nodes on its own
+  std::vector<std::vector<double>> partial_products(thread_count, std::vector<double>(size_t(pivot_total) * pivot_total, 0.0));
+  on_threads(thread_count, [&](int thread)
+  {
+    std::vector<double>& product = partial_products[thread];
+    int first = int(int64_t(count) * thread / thread_count);
+    int last = int(int64_t(count) * (thread + 1) / thread_count);
+
+    for (int i = first; i < last; i++)
+    {
+      const float* row = centred.data() + size_t(i) * pivot_total;
+      for (int a = 0; a < pivot_total; a++)
+        for (int b = 0; b < pivot_total; b++) product[size_t(a) * pivot_total + b] += double(row[a]) * row[b];
+    }
+  });
+  std::vector<double> product(size_t(pivot_total) * pivot_total, 0.0);
+  for (const auto& partial : partial_products)
+    for (size_t i = 0; i < product.size(); i++) product[i] += partial[i];
+
+  // Power iteration for the two largest eigenvectors, the second one kept orthogonal to the first
+  std::vector<std::vector<double>> eigenvectors(2, std::vector<double>(pivot_total));
+  std::mt19937 random(2);
+  std::uniform_real_distribution<double> start(-1.0, 1.0);
+  for (int k = 0; k < 2; k++)
+  {
+    std::vector<double>& vector = eigenvectors[k];
+    for (double& value : vector) value = start(random);
+
+    for (int round = 0; round < 100; round++)
+    {
+      if (k == 1)
+      {
+        double overlap = std::inner_product(vector.begin(), vector.end(), eigenvectors[0].begin(), 0.0);
+        for (int a = 0; a < pivot_total; a++) vector[a] -= overlap * eigenvectors[0][a];
+      }
+
+      std::vector<double> next(pivot_total, 0.0);
+      for (int a = 0; a < pivot_total; a++)
+        for (int b = 0; b < pivot_total; b++) next[a] += product[size_t(a) * pivot_total + b] * vector[b];
+
+      double length = std::sqrt(std::inner_product(next.begin(), next.end(), next.begin(), 0.0));
+      if (length == 0.0) break;
+      for (int a = 0; a < pivot_total; a++) vector[a] = next[a] / length;
+    }
+  }
+
+  for (int i = 0; i < count; i++)
+  {
+    const float* row = centred.data() + size_t(i) * pivot_total;
+    double x = 0.0;
+    double y = 0.0;
+    for (int pivot = 0; pivot < pivot_total; pivot++)
+    {
+      x += row[pivot] * eigenvectors[0][pivot];
+      y += row[pivot] * eigenvectors[1][pivot];
+    }
+    next_xs[i] = float(x);
+    next_ys[i] = float(y);
+  }
+
+  // The result is only right up to its scale; the one fitting the distances to the pivots best is used
+  double fitted = 0.0;
+  double squared = 0.0;
+  for (int i = 0; i < count; i++)
+    for (int pivot = 0; pivot < pivot_total; pivot++)
+    {
+      float distance = pivot_distances[size_t(i) * pivot_total + pivot];
+      if (distance == 0.0f or distance == INFINITY) continue;
+
+      double on_screen = std::hypot(next_xs[i] - next_xs[pivots[pivot]], next_ys[i] - next_ys[pivots[pivot]]);
+      fitted += on_screen / distance;
+      squared += on_screen * on_screen / (double(distance) * distance);
+    }
+  float scale = (squared > 0.0 ? float(fitted / squared) : 1.0f);
+  for (int i = 0; i < count; i++)
+  {
+    next_xs[i] *= scale;
+    next_ys[i] *= scale;
+  }
+}
+
+// One round of localised stress majorisation: every node moves to the weighted average of where each of its terms (lines
+// and pivots) would like it to be, all of them computed from the positions of the round before
+void stress_layout::iterate()
+{
+  int count = int(ids.size());
+  int pivot_total = int(pivots.size());
+
+  constexpr int chunk_size = 256;
+  std::vector<float> largest_movements((count + chunk_size - 1) / chunk_size, 0.0f);
+
+  parallel_for(thread_count, count, chunk_size, [&](int first, int last)
+  {
+    float largest_movement = 0.0f;
+
+    for (int i = first; i < last; i++)
+    {
+      float sum_x = 0.0f;
+      float sum_y = 0.0f;
+      float sum_weights = 0.0f;
+
+      // Where the term would like the node to be: at the target distance from the other node, in the current direction
+      auto add_term = [&](int other, float distance, float weight)
+      {
+        float dx = xs[i] - xs[other];
+        float dy = ys[i] - ys[other];
+        float current = std::sqrt(dx * dx + dy * dy);
+        float stretch = (current > 0.0f ? distance / current : 0.0f);
+
+        sum_x += weight * (xs[other] + dx * stretch);
+        sum_y += weight * (ys[other] + dy * stretch);
+        sum_weights += weight;
+      };
+
+      graph.for_each_line_of(i, [&](int neighbour, int length)
+      {
+        // Loops pull a node nowhere
+        if (neighbour == i) return;
+        float distance = unit_length * float(length);
+        add_term(neighbour, distance, 1.0f / (distance * distance));
+      });
+
+      const float* distances = pivot_distances.data() + size_t(i) * pivot_total;
+      const float* weights = pivot_weights.data() + size_t(i) * pivot_total;
+      for (int pivot = 0; pivot < pivot_total; pivot++)
+        if (weights[pivot] > 0.0f) add_term(pivots[pivot], distances[pivot], weights[pivot]);
+
+      if (sum_weights == 0.0f) continue;
+
+      next_xs[i] = sum_x / sum_weights;
+      next_ys[i] = sum_y / sum_weights;
+      largest_movement = std::max(largest_movement, std::hypot(next_xs[i] - xs[i], next_ys[i] - ys[i]));
+    }
+
+    largest_movements[first / chunk_size] = largest_movement;
+  });
+
+  iteration++;
+  float largest_movement = *std::max_element(largest_movements.begin(), largest_movements.end());
+  converged = largest_movement < final_movement or iteration >= max_iterations;
+}
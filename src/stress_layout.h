@@ -0,0 +1,130 @@
+#pragma once
+
+#include "olcPixelGameEngine.h"
+#include "compressed_lines.h"
+#include "line.h"
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <thread>
+#include <vector>
+
+// Stress majorisation: places the nodes so that the distance between any two of them on screen matches the length of the
+// shortest path between them, line lengths being the distances. Instead of all pairs (which needs the shortest paths
+// between all of them, O(n^2) memory), the sparse stress model only looks at the lines and at the distances to a few
+// hundred pivots: every pivot stands in for the nodes closest to it, its term weighted by how many of those nodes lie
+// between it and the node in question. The shortest paths from the pivots also give the starting layout (pivot MDS).
+//
+// Like force_layout, it runs on a background thread and only update() on the main thread hands a finished iteration over
+// to the nodes.
+class stress_layout
+{
+public:
+  float unit_length = 40.0f; // World units per unit of line length
+  int pivot_count = 200;
+  int max_iterations = 300;
+  float final_movement = 0.5f; // The layout stops once no node moves further than this in an iteration (in world units)
+  int thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+  ~stress_layout();
+
+  void start();
+  void stop();
+  bool is_running() const;
+
+  // Called once per frame. If the iteration running in the background is done, its positions are written into the nodes
+  // (calling moved(id, from, to) for every node whose position changed) and the next iteration is started. The first one
+  // finds the shortest paths from the pivots and the starting layout, so it takes the longest. Nodes moved by something
+  // else in the meantime (i.e. dragged by the user) continue from where they were put. edit_version works like it does
+  // for force_layout: as long as it stays the same, nothing is compared or copied between iterations.
+  template<typename function_type>
+  void update(std::map<int, olc::vi2d>& nodes, const std::vector<line>& lines, uint64_t edit_version, function_type&& moved)
+  {
+    if (worker.joinable())
+    {
+      if (not step_done) return;
+
+      worker.join();
+      std::swap(xs, next_xs);
+      std::swap(ys, next_ys);
+      if (converged and not first_step) running = false;
+
+      // The nodes might have been added or deleted while the iteration was running, which makes its result useless, and after
+      // stop() (e.g. the graph having been replaced) it isn't wanted anymore even if the nodes look the same
+      bool discarded = stopped_in_flight;
+      stopped_in_flight = false;
+      if (not discarded and (edit_version == gathered_version or has_same_nodes(nodes)))
+      {
+        size_t i = 0;
+        for (auto& node : nodes)
+        {
+          olc::vi2d to = {int(std::round(xs[i])), int(std::round(ys[i]))};
+          if (to != node.second)
+          {
+            moved(node.first, node.second, to);
+            node.second = to;
+          }
+          i++;
+        }
+      }
+    }
+
+    if (not running) return;
+
+    // The distances are found again whenever the graph changed, but only starting the layout places the nodes anew
+    bool edited = first_step or edit_version != gathered_version;
+    uint64_t edited_lines = (edited ? fingerprint(lines) : lines_fingerprint);
+    bool restart = first_step or (edited and (not has_same_nodes(nodes) or edited_lines != lines_fingerprint));
+    bool place = first_step;
+    first_step = false;
+    if (edited) gather(nodes);
+    if (restart)
+    {
+      lines_snapshot = lines;
+      lines_fingerprint = edited_lines;
+    }
+    gathered_version = edit_version;
+
+    step_done = false;
+    worker = std::thread([this, restart, place]()
+    {
+      compute_step(restart, place);
+      step_done = true;
+    });
+  }
+
+private:
+  bool running = false;
+  bool stopped_in_flight = false; // Whether stop() was called while a step was running, whose result is dropped then
+  bool first_step = false; // Whether the next iteration starts over from the pivot MDS layout
+  std::thread worker;
+  std::atomic<bool> step_done = false;
+  uint64_t gathered_version = 0; // The edit version the nodes were last gathered at
+
+  // Everything below is owned by the worker while an iteration is running
+  std::vector<int> ids = {};
+  std::vector<line> lines_snapshot = {}; // Only kept until the iteration after a restart has compressed it into graph
+  uint64_t lines_fingerprint = 0;
+  bool converged = false;
+  int iteration = 0;
+  // Positions as separate x and y arrays; the current ones and the ones being computed
+  std::vector<float> xs = {};
+  std::vector<float> ys = {};
+  std::vector<float> next_xs = {};
+  std::vector<float> next_ys = {};
+  // The lines stored at both ends, so every node's lines lead to all of its neighbours (by index into ids)
+  compressed_lines graph = {};
+  std::vector<int> pivots = {};
+  // Per node and pivot (node i's being [i * pivots.size(), (i + 1) * pivots.size())): shortest path length and weight
+  std::vector<float> pivot_distances = {};
+  std::vector<float> pivot_weights = {};
+
+  bool has_same_nodes(const std::map<int, olc::vi2d>& nodes) const;
+  void gather(const std::map<int, olc::vi2d>& nodes);
+  void compute_step(bool restart, bool place);
+  void build_graph();
+  void find_pivot_distances();
+  void place_with_pivot_mds();
+  void iterate();
+};
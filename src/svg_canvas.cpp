@@ -0,0 +1,99 @@
+#include "svg_canvas.h"
+
+// Everything is drawn shifted by half a pixel, so whole pixel coordinates land on pixel centres the way the engine's
+// primitives use them: lines run from centre to centre (with square caps to cover the end pixels too) and a circle of
+// radius r covers 2r + 1 pixels across
+
+bool svg_canvas::open(const std::string& path, const olc::vi2d& size, olc::Pixel background, std::string& error)
+{
+  if (not out.open(path, error)) return false;
+
+  out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+  out << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << size.x << "\" height=\"" << size.y << "\" viewBox=\"0 0 " << size.x << ' ' << size.y << "\">\n";
+  out << "<rect width=\"" << size.x << "\" height=\"" << size.y << "\" fill=\"";
+  write_colour(background);
+  out << "\"/>\n";
+  out << "<g transform=\"translate(0.5 0.5)\" stroke-linecap=\"square\" font-family=\"monospace\">\n";
+  return true;
+}
+
+bool svg_canvas::close(std::string& error)
+{
+  out << "</g>\n</svg>\n";
+  return out.close(error);
+}
+
+void svg_canvas::draw(int x, int y, olc::Pixel colour)
+{
+  fill_rect(x, y, 1, 1, colour);
+}
+
+void svg_canvas::draw_line(int x1, int y1, int x2, int y2, olc::Pixel colour)
+{
+  out << "<line x1=\"" << x1 << "\" y1=\"" << y1 << "\" x2=\"" << x2 << "\" y2=\"" << y2 << "\" stroke=\"";
+  write_colour(colour);
+  out << "\"/>\n";
+}
+void svg_canvas::draw_line(const olc::vi2d& from, const olc::vi2d& to, olc::Pixel colour)
+{
+  draw_line(from.x, from.y, to.x, to.y, colour);
+}
+
+void svg_canvas::fill_triangle(int x1, int y1, int x2, int y2, int x3, int y3, olc::Pixel colour)
+{
+  out << "<polygon points=\"" << x1 << ',' << y1 << ' ' << x2 << ',' << y2 << ' ' << x3 << ',' << y3 << "\" fill=\"";
+  write_colour(colour);
+  out << "\"/>\n";
+}
+void svg_canvas::fill_triangle(const olc::vi2d& one, const olc::vi2d& two, const olc::vi2d& three, olc::Pixel colour)
+{
+  fill_triangle(one.x, one.y, two.x, two.y, three.x, three.y, colour);
+}
+
+void svg_canvas::draw_circle(int x, int y, int radius, olc::Pixel colour)
+{
+  out << "<circle cx=\"" << x << "\" cy=\"" << y << "\" r=\"" << radius << "\" fill=\"none\" stroke=\"";
+  write_colour(colour);
+  out << "\"/>\n";
+}
+
+void svg_canvas::fill_circle(int x, int y, int radius, olc::Pixel colour)
+{
+  out << "<circle cx=\"" << x << "\" cy=\"" << y << "\" r=\"" << double(radius) + 0.5 << "\" fill=\"";
+  write_colour(colour);
+  out << "\"/>\n";
+}
+
+void svg_canvas::fill_rect(int x, int y, int width, int height, olc::Pixel colour)
+{
+  // Pixels are covered from their left/top edge, half a pixel before their centre
+  out << "<rect x=\"" << double(x) - 0.5 << "\" y=\"" << double(y) - 0.5 << "\" width=\"" << width << "\" height=\"" << height << "\" fill=\"";
+  write_colour(colour);
+  out << "\"/>\n";
+}
+
+void svg_canvas::draw_string_prop(int x, int y, const std::string& text, olc::Pixel colour, int scale)
+{
+  // The engine's glyphs are 8 pixels high with the baseline under the seventh row
+  out << "<text x=\"" << x << "\" y=\"" << y + 7 * scale << "\" font-size=\"" << 8 * scale << "\" fill=\"";
+  write_colour(colour);
+  out << "\">";
+  for (char c : text)
+  {
+    if (c == '<') out << "&lt;";
+    else if (c == '>') out << "&gt;";
+    else if (c == '&') out << "&amp;";
+    else out << c;
+  }
+  out << "</text>\n";
+}
+void svg_canvas::draw_string_prop(const olc::vi2d& position, const std::string& text, olc::Pixel colour, int scale)
+{
+  draw_string_prop(position.x, position.y, text, colour, scale);
+}
+
+void svg_canvas::write_colour(olc::Pixel colour)
+{
+  constexpr char digits[] = "0123456789abcdef";
+  out << '#' << digits[colour.r >> 4] << digits[colour.r & 15] << digits[colour.g >> 4] << digits[colour.g & 15] << digits[colour.b >> 4] << digits[colour.b & 15];
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "olcPixelGameEngine.h"
+#include "buffered_writer.h"
+#include <string>
+
+// Writes the primitives the graph is painted with (the same calls as tiled_canvas) as SVG elements, straight to the file
+// through a buffered_writer, so the document is never built in memory. Coordinates are in pixels like on screen; the text
+// uses a monospace font of the size of the engine's, which is as close as SVG gets to it.
+class svg_canvas
+{
+public:
+  // Creates (or truncates) the file and starts a document of the size, filled with the background colour
+  bool open(const std::string& path, const olc::vi2d& size, olc::Pixel background, std::string& error);
+  // Ends the document and closes the file, returns false if anything went wrong along the way
+  bool close(std::string& error);
+
+  void draw(int x, int y, olc::Pixel colour);
+  void draw_line(int x1, int y1, int x2, int y2, olc::Pixel colour);
+  void draw_line(const olc::vi2d& from, const olc::vi2d& to, olc::Pixel colour);
+  void fill_triangle(int x1, int y1, int x2, int y2, int x3, int y3, olc::Pixel colour);
+  void fill_triangle(const olc::vi2d& one, const olc::vi2d& two, const olc::vi2d& three, olc::Pixel colour);
+  void draw_circle(int x, int y, int radius, olc::Pixel colour);
+  void fill_circle(int x, int y, int radius, olc::Pixel colour);
+  void fill_rect(int x, int y, int width, int height, olc::Pixel colour);
+  void draw_string_prop(int x, int y, const std::string& text, olc::Pixel colour, int scale = 1);
+  void draw_string_prop(const olc::vi2d& position, const std::string& text, olc::Pixel colour, int scale = 1);
+
+private:
+  buffered_writer out;
+
+  void write_colour(olc::Pixel colour);
+};
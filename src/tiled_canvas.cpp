@@ -0,0 +1,553 @@
+#include "tiled_canvas.h"
+#include "parallel.h"
+#include <atomic>
+#include <cmath>
+
+void tiled_canvas::init(olc::PixelGameEngine& engine)
+{
+  // Rendering every character once through the engine is the only way to get at the proportional glyphs
+  olc::Sprite glyph_sprite(8, 8);
+  olc::Sprite* previous_target = engine.GetDrawTarget();
+  engine.SetDrawTarget(&glyph_sprite);
+
+  for (int c = 32; c < 128; c++)
+  {
+    std::fill(glyph_sprite.pColData.begin(), glyph_sprite.pColData.end(), olc::BLANK);
+
+    std::string character(1, char(c));
+    engine.DrawStringProp(0, 0, character, olc::WHITE, 1);
+
+    glyph& glyph = glyphs[c - 32];
+    glyph.width = engine.GetTextSizeProp(character).x;
+    for (int i = 0; i < 8; i++)
+      for (int j = 0; j < 8; j++)
+        if (glyph_sprite.GetPixel(i, j) != olc::BLANK) glyph.columns[i] |= uint8_t(1 << j);
+  }
+
+  engine.SetDrawTarget(previous_target);
+}
+
+void tiled_canvas::draw(int x, int y, olc::Pixel colour)
+{
+  fill_rect(x, y, 1, 1, colour);
+}
+
+void tiled_canvas::draw_line(int x1, int y1, int x2, int y2, olc::Pixel colour)
+{
+  record({LINE, x1, y1, x2, y2, 0, 0, colour}, {std::min(x1, x2), std::min(y1, y2), std::max(x1, x2), std::max(y1, y2)});
+}
+void tiled_canvas::draw_line(const olc::vi2d& from, const olc::vi2d& to, olc::Pixel colour)
+{
+  draw_line(from.x, from.y, to.x, to.y, colour);
+}
+
+void tiled_canvas::fill_triangle(int x1, int y1, int x2, int y2, int x3, int y3, olc::Pixel colour)
+{
+  record(
+    {FILL_TRIANGLE, x1, y1, x2, y2, x3, y3, colour},
+    {std::min({x1, x2, x3}), std::min({y1, y2, y3}), std::max({x1, x2, x3}), std::max({y1, y2, y3})}
+  );
+}
+void tiled_canvas::fill_triangle(const olc::vi2d& one, const olc::vi2d& two, const olc::vi2d& three, olc::Pixel colour)
+{
+  fill_triangle(one.x, one.y, two.x, two.y, three.x, three.y, colour);
+}
+
+void tiled_canvas::draw_circle(int x, int y, int radius, olc::Pixel colour)
+{
+  if (radius < 0) return;
+  record({DRAW_CIRCLE, x, y, radius, 0, 0, 0, colour}, {x - radius, y - radius, x + radius, y + radius});
+}
+
+void tiled_canvas::fill_circle(int x, int y, int radius, olc::Pixel colour)
+{
+  if (radius < 0) return;
+  record({FILL_CIRCLE, x, y, radius, 0, 0, 0, colour}, {x - radius, y - radius, x + radius, y + radius});
+}
+
+void tiled_canvas::fill_rect(int x, int y, int width, int height, olc::Pixel colour)
+{
+  record({FILL_RECT, x, y, x + width, y + height, 0, 0, colour}, {x, y, x + width - 1, y + height - 1});
+}
+
+void tiled_canvas::draw_string_prop(int x, int y, const std::string& text, olc::Pixel colour, int scale)
+{
+  int start = int(text_pool.size());
+  text_pool.insert(text_pool.end(), text.begin(), text.end());
+
+  // Walking the text once up front to know which tiles it can touch
+  int cursor_x = 0, width = 0, height = 8 * scale;
+  for (char c : text)
+  {
+    if (c == '\n') { cursor_x = 0; height += 8 * scale; }
+    else if (c == '\t') cursor_x += 8 * olc::nTabSizeInSpaces * scale;
+    else if (c >= 32 and uint8_t(c) < 128) cursor_x += glyphs[c - 32].width * scale;
+    width = std::max(width, cursor_x);
+  }
+
+  record({TEXT, x, y, scale, start, int(text_pool.size()), 0, colour}, {x, y, x + width - 1, y + height - 1});
+}
+void tiled_canvas::draw_string_prop(const olc::vi2d& position, const std::string& text, olc::Pixel colour, int scale)
+{
+  draw_string_prop(position.x, position.y, text, colour, scale);
+}
+
+void tiled_canvas::record(const command& command, const bounds& bounds)
+{
+  commands.push_back(command);
+  command_bounds.push_back(bounds);
+}
+
+void tiled_canvas::flush(olc::Sprite* target)
+{
+  if (target == nullptr or commands.empty())
+  {
+    commands.clear();
+    command_bounds.clear();
+    text_pool.clear();
+    return;
+  }
+
+  const int tiles_x = (target->width + tile_size - 1) / tile_size;
+  const int tiles_y = (target->height + tile_size - 1) / tile_size;
+
+  tiles.resize(tiles_x * tiles_y);
+  for (auto& tile : tiles) tile.clear();
+
+  // Binning; commands end up in every tile their bounding box overlaps, in recording order
+  for (int i = 0; i < int(commands.size()); i++)
+  {
+    const bounds& bounds = command_bounds[i];
+    if (bounds.right < 0 or bounds.bottom < 0 or bounds.left >= target->width or bounds.top >= target->height) continue;
+    if (bounds.right < bounds.left or bounds.bottom < bounds.top) continue;
+
+    int first_column = std::max(bounds.left, 0) / tile_size;
+    int last_column = std::min(bounds.right, target->width - 1) / tile_size;
+    int first_row = std::max(bounds.top, 0) / tile_size;
+    int last_row = std::min(bounds.bottom, target->height - 1) / tile_size;
+
+    for (int row = first_row; row <= last_row; row++)
+    {
+      int row_first_column = first_column;
+      int row_last_column = last_column;
+
+      // Long diagonal lines would otherwise land in every tile of their bounding box; instead only the columns the
+      // line actually crosses within this row are used (padded by a pixel, the rasteriser clips exactly anyway)
+      const command& command = commands[i];
+      if (command.type == LINE and command.y1 != command.y2)
+      {
+        double slope = double(command.x2 - command.x1) / double(command.y2 - command.y1);
+        double x_top = command.x1 + slope * (row * tile_size - 1 - command.y1);
+        double x_bottom = command.x1 + slope * ((row + 1) * tile_size - command.y1);
+        int left = std::max(bounds.left, int(std::floor(std::min(x_top, x_bottom))) - 1);
+        int right = std::min(bounds.right, int(std::ceil(std::max(x_top, x_bottom))) + 1);
+        row_first_column = std::max(first_column, std::max(left, 0) / tile_size);
+        row_last_column = std::min(last_column, std::min(right, target->width - 1) / tile_size);
+      }
+
+      for (int column = row_first_column; column <= row_last_column; column++) tiles[row * tiles_x + column].push_back(i);
+    }
+  }
+
+  // Every worker grabs the next untouched tile until there are none left
+  std::atomic<int> next_tile = 0;
+  auto work = [&]()
+  {
+    for (int tile = next_tile++; tile < int(tiles.size()); tile = next_tile++)
+    {
+      int left = (tile % tiles_x) * tile_size;
+      int top = (tile / tiles_x) * tile_size;
+      bounds clip = {left, top, std::min(left + tile_size, target->width) - 1, std::min(top + tile_size, target->height) - 1};
+
+      for (int i : tiles[tile]) rasterise(commands[i], target, clip);
+    }
+  };
+
+  on_threads(std::min(thread_count, int(tiles.size())), [&](int) { work(); });
+
+  commands.clear();
+  command_bounds.clear();
+  text_pool.clear();
+}
+
+void tiled_canvas::rasterise(const command& command, olc::Sprite* target, const bounds& clip) const
+{
+  switch (command.type)
+  {
+    case LINE:
+      rasterise_line(target, clip, command.x1, command.y1, command.x2, command.y2, command.colour);
+      break;
+    case FILL_TRIANGLE:
+      rasterise_triangle(target, clip, command.x1, command.y1, command.x2, command.y2, command.x3, command.y3, command.colour);
+      break;
+    case DRAW_CIRCLE:
+      rasterise_circle(target, clip, command.x1, command.y1, command.x2, command.colour);
+      break;
+    case FILL_CIRCLE:
+      rasterise_filled_circle(target, clip, command.x1, command.y1, command.x2, command.colour);
+      break;
+    case FILL_RECT:
+      for (int y = std::max(command.y1, clip.top); y < std::min(command.y2, clip.bottom + 1); y++) span(target, clip, command.x1, command.x2 - 1, y, command.colour);
+      break;
+    case TEXT:
+      rasterise_text(target, clip, command);
+      break;
+  }
+}
+
+void tiled_canvas::span(olc::Sprite* target, const bounds& clip, int start_x, int end_x, int y, olc::Pixel colour) const
+{
+  if (y < clip.top or y > clip.bottom) return;
+  start_x = std::max(start_x, clip.left);
+  end_x = std::min(end_x, clip.right);
+  if (start_x > end_x) return;
+
+  std::fill_n(target->GetData() + y * target->width + start_x, end_x - start_x + 1, colour);
+}
+
+void tiled_canvas::plot(olc::Sprite* target, const bounds& clip, int x, int y, olc::Pixel colour) const
+{
+  if (x < clip.left or x > clip.right or y < clip.top or y > clip.bottom) return;
+  target->GetData()[y * target->width + x] = colour;
+}
+
+// Same walk as PixelGameEngine::DrawLine (solid pattern only), clipped to the tile instead of the draw target
+void tiled_canvas::rasterise_line(olc::Sprite* target, const bounds& clip, int x1, int y1, int x2, int y2, olc::Pixel colour) const
+{
+  int dx = x2 - x1;
+  int dy = y2 - y1;
+
+  if (dx == 0)
+  {
+    for (int y = std::max(std::min(y1, y2), clip.top); y <= std::min(std::max(y1, y2), clip.bottom); y++) plot(target, clip, x1, y, colour);
+    return;
+  }
+
+  if (dy == 0)
+  {
+    span(target, clip, std::min(x1, x2), std::max(x1, x2), y1, colour);
+    return;
+  }
+
+  int dx1 = abs(dx);
+  int dy1 = abs(dy);
+  const bool x_major = dy1 <= dx1;
+  const int64_t n = x_major ? dx1 : dy1;
+  const int64_t m = x_major ? dy1 : dx1;
+  int x, y;
+  if (x_major ? dx >= 0 : dy >= 0) { x = x1; y = y1; } else { x = x2; y = y2; }
+  const int s = ((dx < 0 and dy < 0) or (dx > 0 and dy > 0)) ? 1 : -1;
+  const int step_x = x_major ? 1 : s;
+  const int step_y = x_major ? s : 1;
+
+  // Minor axis steps after j major axis steps, see PixelGameEngine::DrawLine
+  auto minor_steps = [&](int64_t j) { return x_major ? (2 * m * j + n) / (2 * n) : (2 * m * j + n - 1) / (2 * n); };
+  auto x_at = [&](int64_t j) { return x + (x_major ? j : step_x * minor_steps(j)); };
+  auto y_at = [&](int64_t j) { return y + (x_major ? step_y * minor_steps(j) : j); };
+  auto first = [](int low, int high, auto predicate)
+  {
+    high++;
+    while (low < high)
+    {
+      int middle = low + (high - low) / 2;
+      if (predicate(middle)) high = middle;
+      else low = middle + 1;
+    }
+    return low;
+  };
+
+  int j_low = 0;
+  int j_high = int(n);
+  if (x_major) { j_low = std::max(j_low, clip.left - x); j_high = std::min(j_high, clip.right - x); }
+  else { j_low = std::max(j_low, clip.top - y); j_high = std::min(j_high, clip.bottom - y); }
+  if (j_low > j_high) return;
+
+  if (x_major)
+  {
+    if (step_y > 0)
+    {
+      j_low = first(j_low, j_high, [&](int j) { return y_at(j) >= clip.top; });
+      j_high = first(j_low, j_high, [&](int j) { return y_at(j) > clip.bottom; }) - 1;
+    }
+    else
+    {
+      j_low = first(j_low, j_high, [&](int j) { return y_at(j) <= clip.bottom; });
+      j_high = first(j_low, j_high, [&](int j) { return y_at(j) < clip.top; }) - 1;
+    }
+  }
+  else
+  {
+    if (step_x > 0)
+    {
+      j_low = first(j_low, j_high, [&](int j) { return x_at(j) >= clip.left; });
+      j_high = first(j_low, j_high, [&](int j) { return x_at(j) > clip.right; }) - 1;
+    }
+    else
+    {
+      j_low = first(j_low, j_high, [&](int j) { return x_at(j) <= clip.right; });
+      j_high = first(j_low, j_high, [&](int j) { return x_at(j) < clip.left; }) - 1;
+    }
+  }
+  if (j_low > j_high) return;
+
+  int64_t error = 2 * m * (int64_t(j_low) + 1) - n - 2 * n * minor_steps(j_low);
+  x = int(x_at(j_low));
+  y = int(y_at(j_low));
+  olc::Pixel* data = target->GetData();
+  data[y * target->width + x] = colour;
+
+  for (int j = j_low; j < j_high; j++)
+  {
+    if (x_major)
+    {
+      x += step_x;
+      if (error < 0) error += 2 * m;
+      else { y += step_y; error += 2 * (m - n); }
+    }
+    else
+    {
+      y += step_y;
+      if (error <= 0) error += 2 * m;
+      else { x += step_x; error += 2 * (m - n); }
+    }
+    data[y * target->width + x] = colour;
+  }
+}
+
+// Line for line the same algorithm as PixelGameEngine::FillTriangle, only the spans get clipped to the tile
+void tiled_canvas::rasterise_triangle(olc::Sprite* target, const bounds& clip, int x1, int y1, int x2, int y2, int x3, int y3, olc::Pixel colour) const
+{
+  auto drawline = [&](int sx, int ex, int ny) { span(target, clip, sx, ex, ny, colour); };
+
+  int t1x, t2x, y, minx, maxx, t1xp, t2xp;
+  bool changed1 = false;
+  bool changed2 = false;
+  int signx1, signx2, dx1, dy1, dx2, dy2;
+  int e1, e2;
+  // Sort vertices
+  if (y1 > y2) { std::swap(y1, y2); std::swap(x1, x2); }
+  if (y1 > y3) { std::swap(y1, y3); std::swap(x1, x3); }
+  if (y2 > y3) { std::swap(y2, y3); std::swap(x2, x3); }
+
+  t1x = t2x = x1; y = y1; // Starting points
+  dx1 = x2 - x1;
+  if (dx1 < 0) { dx1 = -dx1; signx1 = -1; }
+  else signx1 = 1;
+  dy1 = y2 - y1;
+
+  dx2 = x3 - x1;
+  if (dx2 < 0) { dx2 = -dx2; signx2 = -1; }
+  else signx2 = 1;
+  dy2 = y3 - y1;
+
+  if (dy1 > dx1) { std::swap(dx1, dy1); changed1 = true; }
+  if (dy2 > dx2) { std::swap(dy2, dx2); changed2 = true; }
+
+  e2 = dx2 >> 1;
+  // Flat top, just process the second half
+  if (y1 == y2) goto next;
+  e1 = dx1 >> 1;
+
+  for (int i = 0; i < dx1;)
+  {
+    t1xp = 0; t2xp = 0;
+    if (t1x < t2x) { minx = t1x; maxx = t2x; }
+    else { minx = t2x; maxx = t1x; }
+    // Process first line until y value is about to change
+    while (i < dx1)
+    {
+      i++;
+      e1 += dy1;
+      while (e1 >= dx1)
+      {
+        e1 -= dx1;
+        if (changed1) t1xp = signx1;
+        else goto next1;
+      }
+      if (changed1) break;
+      else t1x += signx1;
+    }
+  next1:
+    // Process second line until y value is about to change
+    while (true)
+    {
+      e2 += dy2;
+      while (e2 >= dx2)
+      {
+        e2 -= dx2;
+        if (changed2) t2xp = signx2;
+        else goto next2;
+      }
+      if (changed2) break;
+      else t2x += signx2;
+    }
+  next2:
+    if (minx > t1x) minx = t1x;
+    if (minx > t2x) minx = t2x;
+    if (maxx < t1x) maxx = t1x;
+    if (maxx < t2x) maxx = t2x;
+    drawline(minx, maxx, y);
+    if (not changed1) t1x += signx1;
+    t1x += t1xp;
+    if (not changed2) t2x += signx2;
+    t2x += t2xp;
+    y += 1;
+    if (y == y2) break;
+  }
+next:
+  // Second half
+  dx1 = x3 - x2;
+  if (dx1 < 0) { dx1 = -dx1; signx1 = -1; }
+  else signx1 = 1;
+  dy1 = y3 - y2;
+  t1x = x2;
+
+  if (dy1 > dx1)
+  {
+    std::swap(dy1, dx1);
+    changed1 = true;
+  }
+  else changed1 = false;
+
+  e1 = dx1 >> 1;
+
+  for (int i = 0; i <= dx1; i++)
+  {
+    t1xp = 0; t2xp = 0;
+    if (t1x < t2x) { minx = t1x; maxx = t2x; }
+    else { minx = t2x; maxx = t1x; }
+    // Process first line until y value is about to change
+    while (i < dx1)
+    {
+      e1 += dy1;
+      while (e1 >= dx1)
+      {
+        e1 -= dx1;
+        if (changed1) { t1xp = signx1; break; }
+        else goto next3;
+      }
+      if (changed1) break;
+      else t1x += signx1;
+      if (i < dx1) i++;
+    }
+  next3:
+    // Process second line until y value is about to change
+    while (t2x != x3)
+    {
+      e2 += dy2;
+      while (e2 >= dx2)
+      {
+        e2 -= dx2;
+        if (changed2) t2xp = signx2;
+        else goto next4;
+      }
+      if (changed2) break;
+      else t2x += signx2;
+    }
+  next4:
+    if (minx > t1x) minx = t1x;
+    if (minx > t2x) minx = t2x;
+    if (maxx < t1x) maxx = t1x;
+    if (maxx < t2x) maxx = t2x;
+    drawline(minx, maxx, y);
+    if (not changed1) t1x += signx1;
+    t1x += t1xp;
+    if (not changed2) t2x += signx2;
+    t2x += t2xp;
+    y += 1;
+    if (y > y3) return;
+  }
+}
+
+// Same midpoint walk as PixelGameEngine::DrawCircle with all octants enabled
+void tiled_canvas::rasterise_circle(olc::Sprite* target, const bounds& clip, int x, int y, int radius, olc::Pixel colour) const
+{
+  if (radius == 0)
+  {
+    plot(target, clip, x, y, colour);
+    return;
+  }
+
+  int x0 = 0;
+  int y0 = radius;
+  int d = 3 - 2 * radius;
+
+  while (y0 >= x0)
+  {
+    plot(target, clip, x + x0, y - y0, colour);
+    plot(target, clip, x + y0, y + x0, colour);
+    plot(target, clip, x - x0, y + y0, colour);
+    plot(target, clip, x - y0, y - x0, colour);
+    if (x0 != 0 and x0 != y0)
+    {
+      plot(target, clip, x + y0, y - x0, colour);
+      plot(target, clip, x + x0, y + y0, colour);
+      plot(target, clip, x - y0, y + x0, colour);
+      plot(target, clip, x - x0, y - y0, colour);
+    }
+
+    if (d < 0) d += 4 * x0++ + 6;
+    else d += 4 * (x0++ - y0--) + 10;
+  }
+}
+
+// Same midpoint walk as PixelGameEngine::FillCircle
+void tiled_canvas::rasterise_filled_circle(olc::Sprite* target, const bounds& clip, int x, int y, int radius, olc::Pixel colour) const
+{
+  if (radius == 0)
+  {
+    plot(target, clip, x, y, colour);
+    return;
+  }
+
+  int x0 = 0;
+  int y0 = radius;
+  int d = 3 - 2 * radius;
+
+  while (y0 >= x0)
+  {
+    span(target, clip, x - y0, x + y0, y - x0, colour);
+    if (x0 > 0) span(target, clip, x - y0, x + y0, y + x0, colour);
+
+    if (d < 0) d += 4 * x0++ + 6;
+    else
+    {
+      if (x0 != y0)
+      {
+        span(target, clip, x - x0, x + x0, y - y0, colour);
+        span(target, clip, x - x0, x + x0, y + y0, colour);
+      }
+      d += 4 * (x0++ - y0--) + 10;
+    }
+  }
+}
+
+// Same layout as PixelGameEngine::DrawStringProp, every set glyph pixel becoming a scale x scale block
+void tiled_canvas::rasterise_text(olc::Sprite* target, const bounds& clip, const command& command) const
+{
+  const int scale = command.x2;
+  int cursor_x = 0;
+  int cursor_y = 0;
+
+  for (int i = command.y2; i < command.x3; i++)
+  {
+    char c = text_pool[i];
+
+    if (c == '\n') { cursor_x = 0; cursor_y += 8 * scale; continue; }
+    if (c == '\t') { cursor_x += 8 * olc::nTabSizeInSpaces * scale; continue; }
+    if (c < 32 or uint8_t(c) >= 128) continue;
+
+    const glyph& glyph = glyphs[c - 32];
+    for (int column = 0; column < glyph.width; column++)
+      for (int row = 0; row < 8; row++)
+      {
+        if (not (glyph.columns[column] & (1 << row))) continue;
+
+        int left = command.x1 + cursor_x + column * scale;
+        int top = command.y1 + cursor_y + row * scale;
+        for (int block_row = 0; block_row < scale; block_row++) span(target, clip, left, left + scale - 1, top + block_row, command.colour);
+      }
+
+    cursor_x += glyph.width * scale;
+  }
+}
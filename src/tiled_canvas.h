@@ -0,0 +1,88 @@
+#pragma once
+
+#include "olcPixelGameEngine.h"
+#include <array>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Records the primitives of a frame and rasterises them afterwards: every primitive is binned into the screen tiles its
+// bounding box touches and the tiles are drawn in parallel, each worker only ever writing to the pixels of its own tile.
+// Within a tile the commands are replayed in the order they were recorded, and every primitive is rasterised exactly like
+// its olc::PixelGameEngine counterpart (in NORMAL pixel mode), so the result matches drawing directly pixel for pixel.
+class tiled_canvas
+{
+public:
+  // Caches the proportional font glyphs; the engine's font sheet has to exist by then (i.e. call this in OnUserCreate)
+  void init(olc::PixelGameEngine& engine);
+
+  void draw(int x, int y, olc::Pixel colour);
+  void draw_line(int x1, int y1, int x2, int y2, olc::Pixel colour);
+  void draw_line(const olc::vi2d& from, const olc::vi2d& to, olc::Pixel colour);
+  void fill_triangle(int x1, int y1, int x2, int y2, int x3, int y3, olc::Pixel colour);
+  void fill_triangle(const olc::vi2d& one, const olc::vi2d& two, const olc::vi2d& three, olc::Pixel colour);
+  void draw_circle(int x, int y, int radius, olc::Pixel colour);
+  void fill_circle(int x, int y, int radius, olc::Pixel colour);
+  void fill_rect(int x, int y, int width, int height, olc::Pixel colour);
+  // Only opaque colours are supported, which is all DrawStringProp draws without blending
+  void draw_string_prop(int x, int y, const std::string& text, olc::Pixel colour, int scale = 1);
+  void draw_string_prop(const olc::vi2d& position, const std::string& text, olc::Pixel colour, int scale = 1);
+
+  // Rasterises everything recorded so far into the target and empties the command list
+  void flush(olc::Sprite* target);
+
+  int tile_size = 128;
+  int thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+private:
+  enum command_type
+  {
+    LINE,
+    FILL_TRIANGLE,
+    DRAW_CIRCLE,
+    FILL_CIRCLE,
+    FILL_RECT,
+    TEXT
+  };
+
+  // The meaning of the coordinates depends on the type:
+  // LINE: x1/y1 to x2/y2; FILL_TRIANGLE: all three points; *_CIRCLE: centre x1/y1, radius x2;
+  // FILL_RECT: x1/y1 to x2/y2 (exclusive); TEXT: position x1/y1, scale x2, characters [y2, x3) in text_pool
+  struct command
+  {
+    command_type type;
+    int x1, y1, x2, y2, x3, y3;
+    olc::Pixel colour;
+  };
+
+  // The inclusive pixel bounds a command may touch, used for binning
+  struct bounds
+  {
+    int left, top, right, bottom;
+  };
+
+  // Columns of an 8 pixel high glyph (bit j of a column is row j) and its proportional advance
+  struct glyph
+  {
+    std::array<uint8_t, 8> columns = {};
+    int width = 0;
+  };
+
+  std::vector<command> commands = {};
+  std::vector<bounds> command_bounds = {};
+  std::vector<char> text_pool = {};
+  std::array<glyph, 96> glyphs = {};
+  // Indices into commands per tile, kept around so their memory gets reused from frame to frame
+  std::vector<std::vector<int>> tiles = {};
+
+  void record(const command& command, const bounds& bounds);
+  void rasterise(const command& command, olc::Sprite* target, const bounds& clip) const;
+
+  void span(olc::Sprite* target, const bounds& clip, int start_x, int end_x, int y, olc::Pixel colour) const;
+  void plot(olc::Sprite* target, const bounds& clip, int x, int y, olc::Pixel colour) const;
+  void rasterise_line(olc::Sprite* target, const bounds& clip, int x1, int y1, int x2, int y2, olc::Pixel colour) const;
+  void rasterise_triangle(olc::Sprite* target, const bounds& clip, int x1, int y1, int x2, int y2, int x3, int y3, olc::Pixel colour) const;
+  void rasterise_circle(olc::Sprite* target, const bounds& clip, int x, int y, int radius, olc::Pixel colour) const;
+  void rasterise_filled_circle(olc::Sprite* target, const bounds& clip, int x, int y, int radius, olc::Pixel colour) const;
+  void rasterise_text(olc::Sprite* target, const bounds& clip, const command& command) const;
+};